@@ -0,0 +1,344 @@
+//线程池和任务队列的基准测试,基于Google Benchmark
+//机器可读输出: bench --benchmark_format=json --benchmark_out=result.json
+//只运行部分测试: bench --benchmark_filter=Throughput
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "threadpool.hpp"
+#include "mpmcqueue.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+/**
+ * @brief spin 忙等待指定的纳秒数,模拟任务大小
+ */
+void spin(int64_t ns) {
+    if (ns <= 0)
+        return;
+    Clock::time_point end = Clock::now() + std::chrono::nanoseconds(ns);
+    while (Clock::now() < end) {}
+}
+
+/**
+ * @brief waitFor 等待计数器到达目标值
+ */
+void waitFor(const std::atomic<int64_t>& counter, int64_t target) {
+    while (counter.load(std::memory_order_acquire) < target)
+        std::this_thread::yield();
+}
+
+/**
+ * @brief threadCounts 线程数从1开始翻倍,直到硬件线程数的两倍(至少到4)
+ */
+std::vector<int64_t> threadCounts() {
+    int64_t max = std::max<int64_t>(4, 2 * static_cast<int64_t>(std::thread::hardware_concurrency()));
+    std::vector<int64_t> res;
+    for (int64_t n = 1; n <= max; n *= 2) {
+        res.push_back(n);
+    }
+    return res;
+}
+
+void threadsArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"threads"})->UseRealTime();
+    for (int64_t n : threadCounts()) {
+        b->Arg(n);
+    }
+}
+
+void threadsAndSizeArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"threads", "task_ns"})->UseRealTime();
+    b->ArgsProduct({threadCounts(), {0, 1000, 10000}});
+}
+
+template<typename Executor>
+void stopPool(Executor& tpe) {
+    tpe.shutdown();
+    tpe.stop();
+}
+
+/**
+ * @brief 提交延迟:只计提交的时间,不等待任务执行
+ */
+template<typename Executor>
+void BM_SubmitLatency(benchmark::State& state) {
+    Executor tpe(static_cast<int>(state.range(0)), static_cast<int>(state.range(0)));
+    tpe.preStartCoreThreads();
+    std::atomic<int64_t> done{0};
+    int64_t submitted = 0;
+    for (auto _ : state) {
+        tpe.execute(Task([&done] { done.fetch_add(1, std::memory_order_release); }));
+        ++submitted;
+    }
+    waitFor(done, submitted);
+    state.SetItemsProcessed(submitted);
+    stopPool(tpe);
+}
+
+/**
+ * @brief 吞吐量:每次迭代提交一批任务并等待全部完成
+ */
+template<typename Executor>
+void BM_Throughput(benchmark::State& state) {
+    const int64_t batch = 1000;
+    int64_t taskNs = state.range(1);
+    Executor tpe(static_cast<int>(state.range(0)), static_cast<int>(state.range(0)));
+    tpe.preStartCoreThreads();
+    std::atomic<int64_t> done{0};
+    int64_t submitted = 0;
+    for (auto _ : state) {
+        for (int64_t i = 0; i < batch; ++i) {
+            tpe.execute(Task([&done, taskNs] {
+                spin(taskNs);
+                done.fetch_add(1, std::memory_order_release);
+            }));
+        }
+        submitted += batch;
+        waitFor(done, submitted);
+    }
+    state.SetItemsProcessed(submitted);
+    stopPool(tpe);
+}
+
+/**
+ * @brief 扇出扇入:submitBulk提交一批有返回值的任务,再通过future汇总结果
+ */
+template<typename Executor>
+void BM_FanOutFanIn(benchmark::State& state) {
+    const int fanOut = 64;
+    int64_t taskNs = state.range(1);
+    Executor tpe(static_cast<int>(state.range(0)), static_cast<int>(state.range(0)));
+    tpe.preStartCoreThreads();
+    for (auto _ : state) {
+        std::vector<std::function<int()>> fs;
+        fs.reserve(fanOut);
+        for (int i = 0; i < fanOut; ++i) {
+            fs.push_back([i, taskNs] {
+                spin(taskNs);
+                return i;
+            });
+        }
+        auto futures = tpe.submitBulk(std::move(fs));
+        int sum = 0;
+        for (auto& e : futures) {
+            sum += e.get();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * fanOut);
+    stopPool(tpe);
+}
+
+/**
+ * @brief std::future往返:提交一个任务并等待结果,线程需要从休眠中被唤醒
+ */
+template<typename Executor>
+void BM_FutureRoundTrip(benchmark::State& state) {
+    Executor tpe(static_cast<int>(state.range(0)), static_cast<int>(state.range(0)));
+    tpe.preStartCoreThreads();
+    int i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tpe.submit([i] { return i + 1; }).get());
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    stopPool(tpe);
+}
+
+/**
+ * @brief 窃取效率:一个线程内递归提交任务,统计其他线程窃取的比例
+ */
+void BM_StealEfficiency(benchmark::State& state) {
+    const int64_t tasks = 4096;
+    int64_t taskNs = state.range(1);
+    WorkStealingThreadPoolExecutor tpe(static_cast<int>(state.range(0)),
+                                       static_cast<int>(state.range(0)));
+    tpe.preStartCoreThreads();
+    std::atomic<int64_t> done{0};
+    int64_t submitted = 0;
+    for (auto _ : state) {
+        //根任务在一个线程内提交所有子任务,其他线程只能通过窃取得到任务
+        tpe.execute(Task([&tpe, &done, taskNs, tasks] {
+            for (int64_t i = 0; i < tasks; ++i) {
+                tpe.execute(Task([&done, taskNs] {
+                    spin(taskNs);
+                    done.fetch_add(1, std::memory_order_release);
+                }));
+            }
+        }));
+        submitted += tasks;
+        waitFor(done, submitted);
+    }
+    ExecutorMetrics metrics = tpe.getMetrics();
+    state.SetItemsProcessed(submitted);
+    state.counters["stolen_ratio"] = submitted == 0 ? 0 :
+                                     static_cast<double>(metrics.stolen()) / static_cast<double>(submitted);
+    stopPool(tpe);
+}
+
+/**
+ * @brief 定时抖动:实际开始时间和计划时间的差,单位微秒
+ *        mode 0 - 小顶堆,1 - 时间轮,2 - 定时线程+工作线程池
+ */
+void BM_TimerJitter(benchmark::State& state) {
+    int mode = static_cast<int>(state.range(0));
+    WorkStealingThreadPoolExecutor workers(2, 2);
+    std::unique_ptr<ScheduledThreadPoolExecutor> tpe;
+    if (mode == 0)
+        tpe.reset(new ScheduledThreadPoolExecutor(2, new HeapTimerQueue()));
+    else if (mode == 1)
+        tpe.reset(new ScheduledThreadPoolExecutor(2, new TimingWheel()));
+    else
+        tpe.reset(new ScheduledThreadPoolExecutor(workers, new HeapTimerQueue()));
+    tpe->preStartCoreThreads();
+
+    const auto delay = std::chrono::microseconds(500);
+    std::vector<double> lateness;
+    for (auto _ : state) {
+        Clock::time_point expected = Clock::now() + delay;
+        int64_t late = tpe->schedule([expected] {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - expected).count();
+        }, delay).get();
+        lateness.push_back(static_cast<double>(late) / 1000.0);
+    }
+    if (!lateness.empty()) {
+        std::sort(lateness.begin(), lateness.end());
+        state.counters["jitter_p50_us"] = lateness[lateness.size() / 2];
+        state.counters["jitter_p99_us"] = lateness[static_cast<size_t>(0.99 * static_cast<double>(lateness.size() - 1))];
+        state.counters["jitter_max_us"] = lateness.back();
+    }
+    stopPool(*tpe);
+    stopPool(workers);
+}
+
+/**
+ * @brief 任务队列:一个生产者和一个消费者通过队列传递元素
+ *        capacity为0时是加锁的无界队列,否则是无锁环形队列
+ */
+void BM_BlockingQueueTransfer(benchmark::State& state) {
+    const int64_t items = 10000;
+    size_t capacity = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        BlockingQueue<Task> queue(capacity);
+        std::thread consumer([&queue, items] {
+            Task task;
+            for (int64_t i = 0; i < items; ++i) {
+                queue.wait_and_pop(task);
+                task();
+            }
+        });
+        for (int64_t i = 0; i < items; ++i) {
+            queue.put(Task([] {}));
+        }
+        consumer.join();
+    }
+    state.SetItemsProcessed(state.iterations() * items);
+}
+
+/**
+ * @brief MPMCQueue:多个线程同时push和pop
+ */
+void BM_MPMCQueue(benchmark::State& state) {
+    static MPMCQueue<int64_t>* queue = nullptr;
+    if (state.thread_index() == 0)
+        queue = new MPMCQueue<int64_t>(1024);
+    int64_t value = 0;
+    for (auto _ : state) {
+        while (!queue->try_push(std::move(value)))
+            std::this_thread::yield();
+        while (!queue->try_pop(value))
+            std::this_thread::yield();
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        //线程0的循环结束时其他线程也都结束了
+        delete queue;
+        queue = nullptr;
+    }
+}
+
+/**
+ * @brief 伪共享:每个线程只修改自己的计数,Packed的计数相邻存放,Padded的每个计数单独占缓存行
+ *        Packed随线程数变慢说明缓存行在核之间来回传递(perf c2c看到的HITM)
+ */
+struct PackedCounter {
+    std::atomic<int64_t> value{0};
+};
+
+struct PaddedCounter {
+    char                 pad0_[64];
+    std::atomic<int64_t> value{0};
+    char                 pad1_[64];
+};
+
+template<typename Counter>
+void BM_FalseSharing(benchmark::State& state) {
+    static Counter counters[64];
+    std::atomic<int64_t>& value = counters[state.thread_index() % 64].value;
+    for (auto _ : state) {
+        value.fetch_add(1, std::memory_order_relaxed);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief 提交和完成路径的竞争:多个外部线程同时向一个线程池提交,线程0同时读取统计
+ *        提交者修改submitters_和pendingTasks_,工作线程完成时修改pendingTasks_,都只读ctl_和配置
+ */
+template<typename Executor>
+void BM_SubmitCompleteContention(benchmark::State& state) {
+    static Executor* tpe = nullptr;
+    static std::atomic<int64_t> done{0};
+    if (state.thread_index() == 0) {
+        tpe = new Executor(4, 4);
+        tpe->preStartCoreThreads();
+        done.store(0);
+    }
+    int64_t submitted = 0;
+    int64_t stats = 0;
+    for (auto _ : state) {
+        tpe->execute(Task([] { done.fetch_add(1, std::memory_order_release); }));
+        ++submitted;
+        if (state.thread_index() == 0 && submitted % 64 == 0)
+            stats += tpe->getTaskCount() + tpe->getActiveCount();
+    }
+    benchmark::DoNotOptimize(stats);
+    state.SetItemsProcessed(submitted);
+    if (state.thread_index() == 0) {
+        //线程0的循环结束时其他线程也都结束了,等待所有任务完成
+        while (tpe->getPendingTaskCount() != 0)
+            std::this_thread::yield();
+        stopPool(*tpe);
+        delete tpe;
+        tpe = nullptr;
+    }
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_SubmitLatency, ThreadPoolExecutor)->Apply(threadsArgs);
+BENCHMARK_TEMPLATE(BM_SubmitLatency, WorkStealingThreadPoolExecutor)->Apply(threadsArgs);
+BENCHMARK_TEMPLATE(BM_Throughput, ThreadPoolExecutor)->Apply(threadsAndSizeArgs);
+BENCHMARK_TEMPLATE(BM_Throughput, WorkStealingThreadPoolExecutor)->Apply(threadsAndSizeArgs);
+BENCHMARK_TEMPLATE(BM_FanOutFanIn, ThreadPoolExecutor)->Apply(threadsAndSizeArgs);
+BENCHMARK_TEMPLATE(BM_FanOutFanIn, WorkStealingThreadPoolExecutor)->Apply(threadsAndSizeArgs);
+BENCHMARK_TEMPLATE(BM_FutureRoundTrip, ThreadPoolExecutor)->Apply(threadsArgs);
+BENCHMARK_TEMPLATE(BM_FutureRoundTrip, WorkStealingThreadPoolExecutor)->Apply(threadsArgs);
+BENCHMARK(BM_StealEfficiency)->Apply(threadsAndSizeArgs);
+BENCHMARK(BM_TimerJitter)->ArgName("mode")->DenseRange(0, 2)->UseRealTime()->Iterations(200);
+BENCHMARK(BM_BlockingQueueTransfer)->ArgName("capacity")->Arg(0)->Arg(1024)->UseRealTime();
+BENCHMARK(BM_MPMCQueue)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_FalseSharing, PackedCounter)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_FalseSharing, PaddedCounter)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SubmitCompleteContention, ThreadPoolExecutor)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SubmitCompleteContention, WorkStealingThreadPoolExecutor)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
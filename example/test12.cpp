@@ -0,0 +1,93 @@
+//测试核心线程数扩展性:CPU密集型任务,N个核心线程的吞吐量应接近单线程的N倍
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "threadpool.hpp"
+
+static volatile uint64_t sink;
+
+static uint64_t spin(uint64_t n) {
+    uint64_t x = n;
+    for (uint64_t i = 0; i < 200000; ++i) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return x;
+}
+
+static double run(int threads, int tasks) {
+    ThreadPoolExecutor tpe(threads, threads);
+    tpe.preStartCoreThreads();
+    std::vector<std::future<uint64_t>> futures;
+    futures.reserve(tasks);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < tasks; ++i) {
+        futures.push_back(tpe.submit(std::bind(&spin, static_cast<uint64_t>(i))));
+    }
+    uint64_t sum = 0;
+    for (auto& f : futures) {
+        sum += f.get();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    tpe.shutdown();
+    tpe.stop();
+    sink = sum;
+    return tasks / std::chrono::duration<double>(end - begin).count();
+}
+
+/**
+ * @brief resize 多个线程提交任务的同时调整最大线程数,队列位置在构造时分配,不会被移动
+ */
+static bool resize() {
+    ThreadPoolExecutor tpe(2, 4);
+    tpe.keepNonCoreThreadAlive(true);
+    std::atomic<int> ran{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 3; ++i) {
+        producers.emplace_back([&tpe, &ran] {
+            for (int n = 0; n < 2000; ++n) {
+                tpe.execute(Task([&ran] { ++ran; }), n % 2 == 0);
+            }
+        });
+    }
+    std::thread resizer([&tpe, &done] {
+        for (int n = 0; !done.load(); ++n) {
+            tpe.setMaxPoolSize(n % 2 == 0 ? 2 : 16);
+            std::this_thread::yield();
+        }
+    });
+    for (auto& e : producers) {
+        e.join();
+    }
+    done = true;
+    resizer.join();
+    tpe.setMaxPoolSize(16);
+    tpe.shutdown();
+    bool ok = tpe.awaitTermination(std::chrono::seconds(5)) && ran.load() == 6000;
+    tpe.stop();
+    return ok;
+}
+
+int main(void)
+{
+    int maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    int tasks = 400;
+    double base = 0;
+    std::cout << "threads  tasks/s   speedup" << std::endl;
+    for (int n = 1; n <= maxThreads; n *= 2) {
+        double tput = run(n, tasks);
+        if (n == 1)
+            base = tput;
+        std::cout << std::setw(7) << n
+                  << std::setw(10) << std::fixed << std::setprecision(1) << tput
+                  << std::setw(9) << std::setprecision(2) << tput / base << std::endl;
+    }
+    bool ok = resize();
+    std::cout << "resize " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+//测试WorkStealingThreadPoolExecutor的fork/join扩展性:
+//递归计算fib,子任务压入当前线程的双端队列,等待时帮忙执行其他任务
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include "workstealingthreadpoolexecutor.hpp"
+
+static WorkStealingThreadPoolExecutor* pool = nullptr;
+
+static long serialFib(int n) {
+    return n < 2 ? n : serialFib(n - 1) + serialFib(n - 2);
+}
+
+static long fib(int n) {
+    if (n < 18)
+        return serialFib(n);
+    std::future<long> f = pool->submit(std::bind(&fib, n - 1));
+    long b = fib(n - 2);
+    while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!pool->tryExecuteOne())
+            std::this_thread::yield();
+    }
+    return f.get() + b;
+}
+
+int main(void)
+{
+    int maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    double base = 0;
+    std::cout << "threads  result     seconds  speedup" << std::endl;
+    for (int n = 1; n <= maxThreads; n *= 2) {
+        WorkStealingThreadPoolExecutor wsThreadPool(n, n);
+        wsThreadPool.preStartCoreThreads();
+        pool = &wsThreadPool;
+
+        auto begin = std::chrono::steady_clock::now();
+        long result = fib(35);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        if (n == 1)
+            base = seconds;
+
+        std::cout << std::setw(7) << n
+                  << std::setw(10) << result
+                  << std::setw(12) << std::fixed << std::setprecision(3) << seconds
+                  << std::setw(9) << std::setprecision(2) << base / seconds << std::endl;
+        wsThreadPool.shutdown();
+        wsThreadPool.stop();
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+//测试Task:小对象直接存放在Task内部,统计每次submit的内存分配次数
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "threadpool.hpp"
+
+static std::atomic<long> allocations{0};
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = std::malloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main(void)
+{
+    std::cout << "sizeof(Task) = " << sizeof(Task) << std::endl;
+
+    //小于Task::INLINE_SIZE的lambda不分配内存
+    int x = 0;
+    long before = allocations;
+    Task small([&x]() {
+        x++;
+    });
+    Task moved(std::move(small));
+    moved();
+    std::cout << "small task allocations = " << allocations - before
+              << " x = " << x << std::endl;
+
+    //超过Task::INLINE_SIZE的lambda放在堆上
+    char big[128] = {};
+    before = allocations;
+    Task large([big, &x]() {
+        x += big[0] + 1;
+    });
+    large();
+    std::cout << "large task allocations = " << allocations - before
+              << " x = " << x << std::endl;
+
+    ThreadPoolExecutor tpe(2, 2);
+    tpe.preStartCoreThreads();
+    const int tasks = 10000;
+    std::vector<std::future<int>> futures;
+    futures.reserve(tasks);
+    before = allocations;
+    for (int i = 0; i < tasks; ++i) {
+        futures.push_back(tpe.submit([i]() {
+            return i;
+        }));
+    }
+    double perSubmit = static_cast<double>(allocations - before) / tasks;
+    long sum = 0;
+    for (auto& f : futures) {
+        sum += f.get();
+    }
+    std::cout << "allocations per submit = " << perSubmit
+              << " sum = " << sum << std::endl;
+
+    //execute不需要future,只有任务队列本身的分配
+    std::atomic<long> counter{0};
+    before = allocations;
+    for (int i = 0; i < tasks; ++i) {
+        tpe.execute([&counter]() {
+            counter++;
+        });
+    }
+    double perExecute = static_cast<double>(allocations - before) / tasks;
+    while (counter.load() != tasks) {
+        std::this_thread::yield();
+    }
+    std::cout << "allocations per execute = " << perExecute
+              << " counter = " << counter.load() << std::endl;
+
+    tpe.shutdown();
+    tpe.stop();
+    return 0;
+}
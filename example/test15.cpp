@@ -0,0 +1,73 @@
+//测试有界无锁BlockingQueue:和std::queue加锁的无界队列比较多生产者多消费者吞吐量,
+//以及使用有界任务队列的ThreadPoolExecutor
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include "threadpool.hpp"
+
+static double throughput(BlockingQueue<long>& queue, int producers, int consumers, long items) {
+    std::vector<std::unique_ptr<Thread>> threads;
+    std::atomic<long> sum{0};
+    long perProducer = items / producers;
+    long perConsumer = perProducer * producers / consumers;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back(new Thread([&queue, perProducer]() {
+            for (long i = 0; i < perProducer; ++i) {
+                queue.put(i);
+            }
+        }, "producer"));
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back(new Thread([&queue, &sum, perConsumer]() {
+            long local = 0;
+            for (long i = 0; i < perConsumer; ++i) {
+                local += queue.take();
+            }
+            sum += local;
+        }, "consumer"));
+    }
+    for (auto& t : threads) {
+        t->start();
+    }
+    for (auto& t : threads) {
+        t->join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return perConsumer * consumers / seconds;
+}
+
+int main(void)
+{
+    const long items = 1 << 20;
+    std::cout << "producers consumers  unbounded(ops/s)  bounded(ops/s)" << std::endl;
+    for (int n = 1; n <= 4; n *= 2) {
+        BlockingQueue<long> unbounded;
+        BlockingQueue<long> bounded(1024);
+        double u = throughput(unbounded, n, n, items);
+        double b = throughput(bounded, n, n, items);
+        std::cout << std::setw(9) << n << std::setw(10) << n
+                  << std::setw(18) << std::fixed << std::setprecision(0) << u
+                  << std::setw(16) << b << std::endl;
+    }
+
+    //每个线程的任务队列容量为64,提交速度超过执行速度时submit会阻塞,内存不会无限增长
+    ThreadPoolExecutor tpe(2, 2, 64);
+    tpe.preStartCoreThreads();
+    std::atomic<int> done{0};
+    for (int i = 0; i < 10000; ++i) {
+        tpe.execute([&done]() {
+            done++;
+        });
+    }
+    while (done.load() != 10000) {
+        std::this_thread::yield();
+    }
+    std::cout << "queue capacity = " << tpe.getQueueCapacity()
+              << " done = " << done.load() << std::endl;
+    tpe.shutdown();
+    tpe.stop();
+    return 0;
+}
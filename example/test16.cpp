@@ -0,0 +1,70 @@
+//测试批量提交:submitBulk和逐个submit的对比,以及execute(BlockingQueue&)执行全部任务
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include "threadpool.hpp"
+
+static std::atomic<int> counter{0};
+
+static double one_by_one(ThreadPoolExecutor& tpe, int tasks) {
+    std::vector<std::future<int>> futures;
+    futures.reserve(tasks);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < tasks; ++i) {
+        futures.push_back(tpe.submit([i] { return i; }));
+    }
+    long sum = 0;
+    for (auto& f : futures) {
+        sum += f.get();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (sum != static_cast<long>(tasks) * (tasks - 1) / 2)
+        std::cout << "wrong sum " << sum << std::endl;
+    return tasks / std::chrono::duration<double>(end - begin).count();
+}
+
+static double bulk(ThreadPoolExecutor& tpe, int tasks) {
+    std::vector<std::function<int()>> fs;
+    fs.reserve(tasks);
+    for (int i = 0; i < tasks; ++i) {
+        fs.push_back([i] { return i; });
+    }
+    auto begin = std::chrono::steady_clock::now();
+    auto futures = tpe.submitBulk(std::move(fs));
+    long sum = 0;
+    for (auto& f : futures) {
+        sum += f.get();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (sum != static_cast<long>(tasks) * (tasks - 1) / 2)
+        std::cout << "wrong sum " << sum << std::endl;
+    return tasks / std::chrono::duration<double>(end - begin).count();
+}
+
+int main(void)
+{
+    ThreadPoolExecutor tpe(4, 4);
+    tpe.preStartCoreThreads();
+    int tasks = 100000;
+    std::cout << "submit     tasks/s: " << std::fixed << std::setprecision(0) << one_by_one(tpe, tasks) << std::endl;
+    std::cout << "submitBulk tasks/s: " << std::fixed << std::setprecision(0) << bulk(tpe, tasks) << std::endl;
+
+    //execute(BlockingQueue&)应该执行队列中的全部任务
+    BlockingQueue<Runnable::sptr> queue;
+    for (int i = 0; i < 100; ++i) {
+        queue.put(std::make_shared<Runnable>([] { counter++; }));
+    }
+    tpe.execute(queue);
+    std::vector<std::function<void()>> fs(100, [] { counter++; });
+    tpe.executeBatch(fs.begin(), fs.end());
+    while (counter.load() < 200) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cout << "executed " << counter.load() << " tasks" << std::endl;
+
+    tpe.shutdown();
+    tpe.stop();
+    return 0;
+}
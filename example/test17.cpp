@@ -0,0 +1,49 @@
+//测试定向唤醒:每次提交只唤醒一个线程,统计每个任务引起的上下文切换次数
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <sys/resource.h>
+#include "threadpool.hpp"
+
+static long contextSwitches() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+template<typename Executor>
+static void run(const std::string& name, int threads, int tasks) {
+    Executor tpe(threads, threads);
+    tpe.preStartCoreThreads();
+    //等待所有线程进入休眠
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    long before = contextSwitches();
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < tasks; ++i) {
+        //逐个提交并等待,每次提交时所有线程都在休眠
+        tpe.submit([i] { return i; }).get();
+    }
+    auto end = std::chrono::steady_clock::now();
+    long after = contextSwitches();
+
+    std::cout << std::left << std::setw(32) << name
+              << " threads=" << threads
+              << " switches/task=" << std::fixed << std::setprecision(2)
+              << static_cast<double>(after - before) / tasks
+              << " us/task=" << std::chrono::duration<double, std::micro>(end - begin).count() / tasks
+              << std::endl;
+    tpe.shutdown();
+    tpe.stop();
+}
+
+int main(void)
+{
+    int tasks = 20000;
+    for (int n = 1; n <= 8; n *= 2) {
+        run<ThreadPoolExecutor>("ThreadPoolExecutor", n, tasks);
+        run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor", n, tasks);
+    }
+    return 0;
+}
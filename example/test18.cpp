@@ -0,0 +1,75 @@
+//测试定时任务队列:小顶堆和分层时间轮在大量等待中的定时任务下的插入,取消和CPU开销
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <atomic>
+#include <sys/resource.h>
+#include "scheduledthreadpoolexecutor.hpp"
+
+static double cpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static void queueBench(const std::string& name, TimerQueue& queue, int tasks, int cancels) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> delay(1, 60000);
+    std::vector<std::shared_ptr<TimerTask>> timers;
+    timers.reserve(tasks);
+    for (int i = 0; i < tasks; ++i) {
+        timers.push_back(std::make_shared<TimerTask>(std::chrono::milliseconds(delay(rng)),
+                         std::chrono::nanoseconds(0), false, [] {}));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    for (auto& e : timers) {
+        queue.push(e);
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int i = 0; i < cancels; ++i) {
+        timers[i]->state_.store(TimerTask::CANCELLED);
+        queue.remove(timers[i]);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << std::left << std::setw(16) << name
+              << " insert ns/op=" << std::setw(8) << std::chrono::duration<double, std::nano>(mid - begin).count() / tasks
+              << " cancel ns/op=" << std::chrono::duration<double, std::nano>(end - mid).count() / cancels
+              << std::endl;
+}
+
+static void executorBench(const std::string& name, ScheduledThreadPoolExecutor& tpe, int pending) {
+    //大量等待中的超时任务,例如每个连接的空闲超时
+    for (int i = 0; i < pending; ++i) {
+        tpe.schedule([] {}, std::chrono::seconds(60 + i % 60));
+    }
+    std::atomic<int> fired{0};
+    double cpu = cpuSeconds();
+    tpe.scheduleAtFixedRate([&fired] { fired++; }, std::chrono::milliseconds(10), std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    std::cout << std::left << std::setw(16) << name
+              << " pending=" << pending
+              << " fired=" << fired.load()
+              << " cpu ms=" << (cpuSeconds() - cpu) * 1000
+              << std::endl;
+    tpe.stop();
+}
+
+int main(void)
+{
+    int tasks = 200000;
+    HeapTimerQueue heap;
+    TimingWheel wheel;
+    queueBench("HeapTimerQueue", heap, tasks, tasks);
+    queueBench("TimingWheel", wheel, tasks, tasks);
+
+    ScheduledThreadPoolExecutor heapExecutor(2, "heap");
+    executorBench("HeapTimerQueue", heapExecutor, tasks);
+    ScheduledThreadPoolExecutor wheelExecutor(2, new TimingWheel(std::chrono::milliseconds(1)), "wheel");
+    executorBench("TimingWheel", wheelExecutor, tasks);
+    return 0;
+}
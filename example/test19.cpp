@@ -0,0 +1,58 @@
+//测试ScheduledFuture:取消一次性任务和周期任务,查询状态,剩余延迟和结果
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include "scheduledthreadpoolexecutor.hpp"
+
+template<typename Executor>
+static void run(const std::string& name, Executor& tpe) {
+    //一次性任务得到结果
+    auto answer = tpe.schedule([] { return 42; }, std::chrono::milliseconds(20));
+    assert(!answer.isDone());
+    assert(answer.getDelay() > std::chrono::nanoseconds(0));
+    assert(answer.get() == 42);
+    assert(answer.isDone() && !answer.isCancelled());
+    assert(!answer.cancel());
+
+    //取消还没有执行的一次性任务
+    std::atomic<int> late{0};
+    auto never = tpe.schedule([&late] { late++; }, std::chrono::seconds(10));
+    assert(never.cancel());
+    assert(never.isDone() && never.isCancelled());
+    try {
+        never.get();
+        assert(false);
+    } catch (const std::future_error& e) {
+        assert(e.code() == std::future_errc::broken_promise);
+    }
+
+    //取消周期任务,之后不再执行
+    std::atomic<int> ticks{0};
+    auto periodic = tpe.scheduleAtFixedRate([&ticks] { ticks++; },
+                                            std::chrono::milliseconds(0), std::chrono::milliseconds(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(periodic.cancel());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int count = ticks.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(ticks.load() == count);
+    assert(periodic.isDone());
+
+    //大量取消的任务不会留在队列中
+    for (int i = 0; i < 10000; ++i) {
+        tpe.schedule([] {}, std::chrono::seconds(60)).cancel();
+    }
+    std::cout << name << " ticks=" << count
+              << " pending=" << tpe.getTaskCount()
+              << " late=" << late.load() << std::endl;
+    tpe.stop();
+}
+
+int main(void)
+{
+    ScheduledThreadPoolExecutor heap(2, "heap");
+    run("HeapTimerQueue", heap);
+    ScheduledThreadPoolExecutor wheel(2, new TimingWheel(std::chrono::milliseconds(1)), "wheel");
+    run("TimingWheel", wheel);
+    return 0;
+}
@@ -0,0 +1,71 @@
+//测试定时线程分发模式:长任务占用线程时,定时任务的触发延迟(实际开始时间-计划时间)
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "threadpool.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static void report(const std::string& name, std::vector<double>& lateness) {
+    std::sort(lateness.begin(), lateness.end());
+    auto at = [&lateness](double p) {
+        return lateness[static_cast<size_t>(p * (lateness.size() - 1))];
+    };
+    std::cout << std::left << std::setw(24) << name
+              << " samples=" << lateness.size()
+              << std::fixed << std::setprecision(3)
+              << " p50 ms=" << at(0.5)
+              << " p99 ms=" << at(0.99)
+              << " max ms=" << lateness.back() << std::endl;
+}
+
+static void run(const std::string& name, ScheduledThreadPoolExecutor& tpe) {
+    std::mutex mutex;
+    std::vector<double> lateness;
+    //两个周期性的长任务(例如阻塞IO),会占用执行它们的线程
+    auto slow1 = tpe.scheduleAtFixedDelay([] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    }, std::chrono::milliseconds(0), std::chrono::milliseconds(1));
+    auto slow2 = tpe.scheduleAtFixedDelay([] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    }, std::chrono::milliseconds(0), std::chrono::milliseconds(1));
+
+    std::vector<ScheduledFuture<void>> futures;
+    for (int i = 0; i < 200; ++i) {
+        auto delay = std::chrono::milliseconds(5 + i * 5);
+        Clock::time_point expected = Clock::now() + delay;
+        futures.push_back(tpe.schedule([&mutex, &lateness, expected] {
+            double late = std::chrono::duration<double, std::milli>(Clock::now() - expected).count();
+            std::lock_guard<std::mutex> lock(mutex);
+            lateness.push_back(late);
+        }, delay));
+    }
+    for (auto& e : futures) {
+        e.get();
+    }
+    slow1.cancel();
+    slow2.cancel();
+    tpe.stop();
+    report(name, lateness);
+}
+
+int main(void)
+{
+    {
+        //定时线程自己执行任务,长任务会让后面的定时任务等待
+        ScheduledThreadPoolExecutor tpe(2, "STPE");
+        run("worker threads", tpe);
+    }
+    {
+        //一个定时线程,到期的任务交给线程池,空闲线程可以窃取排在长任务后面的任务
+        WorkStealingThreadPoolExecutor workers(4, 4, "workers");
+        ScheduledThreadPoolExecutor tpe(workers, "timer");
+        run("timer thread + pool", tpe);
+        workers.shutdown();
+        workers.stop();
+    }
+    return 0;
+}
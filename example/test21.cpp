@@ -0,0 +1,99 @@
+//测试线程池统计:完成数,窃取数,拒绝数,排队时间和执行时间直方图,以及开启统计的开销
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "threadpool.hpp"
+
+template<typename Executor>
+static double run(const std::string& name, bool enabled, int tasks) {
+    Executor tpe(4, 4);
+    tpe.setMetricsEnabled(enabled);
+    tpe.preStartCoreThreads();
+    std::vector<std::future<int>> res;
+    res.reserve(tasks);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < tasks; ++i) {
+        res.push_back(tpe.submit([i] { return i; }));
+    }
+    for (auto& e : res) {
+        e.get();
+    }
+    auto end = std::chrono::steady_clock::now();
+    //future就绪时线程可能还没有更新完成数
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    ExecutorMetrics metrics = tpe.getMetrics();
+    assert(metrics.completed() == static_cast<uint64_t>(tasks));
+    assert(metrics.queueWait().count == (enabled ? static_cast<uint64_t>(tasks) : 0));
+    assert(metrics.execution().count == metrics.queueWait().count);
+    double ns = std::chrono::duration<double, std::nano>(end - begin).count() / tasks;
+    std::cout << std::left << std::setw(32) << name
+              << " metrics=" << (enabled ? "on " : "off")
+              << " ns/task=" << std::fixed << std::setprecision(1) << ns
+              << " " << metrics.toString() << std::endl;
+    tpe.shutdown();
+    tpe.stop();
+    return ns;
+}
+
+int main(void)
+{
+    //直方图桶的边界
+    for (uint64_t v : {0ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull}) {
+        size_t i = LatencyHistogram::bucketOf(v);
+        assert(LatencyHistogram::lowerBound(i) <= v && v < LatencyHistogram::lowerBound(i + 1));
+    }
+
+    int tasks = 200000;
+    run<ThreadPoolExecutor>("ThreadPoolExecutor", false, tasks);
+    run<ThreadPoolExecutor>("ThreadPoolExecutor", true, tasks);
+    run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor", false, tasks);
+    run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor", true, tasks);
+
+    //线程内提交的任务被其他线程窃取
+    {
+        WorkStealingThreadPoolExecutor tpe(4, 4);
+        tpe.setMetricsEnabled(true);
+        //线程内提交不会启动新线程,先启动所有核心线程
+        tpe.preStartCoreThreads();
+        tpe.submit([&tpe] {
+            std::vector<std::future<void>> res;
+            for (int i = 0; i < 1000; ++i) {
+                res.push_back(tpe.submit([] {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }));
+            }
+            for (auto& e : res) {
+                e.get();
+            }
+        }).get();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ExecutorMetrics metrics = tpe.getMetrics();
+        std::cout << "nested submit: " << metrics.toString() << std::endl;
+        assert(metrics.completed() == 1001);
+        for (size_t i = 0; i < metrics.workers.size(); ++i) {
+            std::cout << "  worker " << i
+                      << " completed=" << metrics.workers[i].completed
+                      << " stolen=" << metrics.workers[i].stolen << std::endl;
+        }
+        tpe.shutdown();
+        tpe.stop();
+    }
+
+    //拒绝计数
+    {
+        ThreadPoolExecutor tpe(1, 1);
+        tpe.shutdown();
+        try {
+            tpe.execute(Task([] {}));
+        } catch (...) {
+        }
+        assert(tpe.getMetrics().rejected == 1);
+        tpe.stop();
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
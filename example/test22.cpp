@@ -0,0 +1,85 @@
+//测试优先级调度:高优先级任务超过排队的普通和低优先级任务,老化保证低优先级任务不会饿死
+#include <iostream>
+#include <cassert>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "threadpool.hpp"
+
+template<typename Executor>
+static std::string run(unsigned aging) {
+    Executor tpe(1, 1);
+    tpe.setPriorityAging(aging);
+    //先用一个任务占住唯一的线程,让后面的任务都排队
+    std::promise<void> gate;
+    std::shared_future<void> opened(gate.get_future());
+    auto blocker = tpe.submit([opened] { opened.wait(); });
+
+    std::mutex mutex;
+    std::string order;
+    std::vector<std::future<void>> res;
+    auto record = [&mutex, &order](char c) {
+        return [&mutex, &order, c] {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(c);
+        };
+    };
+    for (int i = 0; i < 6; ++i) {
+        res.push_back(tpe.submit(record('L'), TaskPriority::LOW));
+        res.push_back(tpe.submit(record('N')));
+        res.push_back(tpe.submit(record('H'), TaskPriority::HIGH));
+    }
+    gate.set_value();
+    blocker.get();
+    for (auto& e : res) {
+        e.get();
+    }
+    tpe.shutdown();
+    tpe.stop();
+    return order;
+}
+
+int main(void)
+{
+    //老化阈值很大时严格按优先级执行
+    std::string strict = run<ThreadPoolExecutor>(100);
+    std::cout << "aging=100: " << strict << std::endl;
+    assert(strict == "HHHHHHNNNNNNLLLLLL");
+
+    //老化阈值为2时,低优先级任务被跳过两次后插队执行
+    std::string aged = run<ThreadPoolExecutor>(2);
+    std::cout << "aging=2:   " << aged << std::endl;
+    assert(aged.size() == 18 && aged[0] == 'H');
+    assert(aged.find('L') < aged.rfind('H'));
+
+    std::string ws = run<WorkStealingThreadPoolExecutor>(100);
+    std::cout << "work stealing aging=100: " << ws << std::endl;
+    assert(ws == "HHHHHHNNNNNNLLLLLL");
+
+    //高优先级任务持续提交时低优先级任务仍然可以执行
+    {
+        ThreadPoolExecutor tpe(2, 2);
+        tpe.preStartCoreThreads();
+        std::atomic<bool> lowDone{false};
+        std::vector<std::future<void>> res;
+        for (int i = 0; i < 20; ++i) {
+            res.push_back(tpe.submit([&lowDone] { lowDone = true; }, TaskPriority::LOW));
+        }
+        int high = 0;
+        while (!lowDone) {
+            tpe.execute(Task([] {
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+            }), TaskPriority::HIGH);
+            ++high;
+        }
+        std::cout << "low priority task ran after " << high << " high priority submissions" << std::endl;
+        for (auto& e : res) {
+            e.get();
+        }
+        tpe.shutdown();
+        tpe.stop();
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+//测试CPU绑定和NUMA分组:读取拓扑,线程绑定CPU,按节点提交任务
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "threadpool.hpp"
+
+int main(void)
+{
+    assert((CpuTopology::parseCpuList("0-3,8,10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    assert(CpuTopology::parseCpuList("").empty());
+    {
+        //手动指定的节点可以无序和重复
+        CpuTopology unsorted(std::vector<std::vector<int>>{{3, 1, 3}, {2, 0}});
+        assert((unsorted.cpusOfNode(0) == std::vector<int>{1, 3}));
+        assert(unsorted.nodeOfCpu(1) == 0 && unsorted.nodeOfCpu(3) == 0);
+        assert(unsorted.nodeOfCpu(0) == 1 && unsorted.nodeOfCpu(2) == 1);
+    }
+
+    CpuTopology topology;
+    std::cout << "numa nodes: " << topology.nodeCount() << std::endl;
+    for (int i = 0; i < topology.nodeCount(); ++i) {
+        std::cout << "  node " << i << " cpus:";
+        for (int cpu : topology.cpusOfNode(i)) {
+            std::cout << " " << cpu;
+        }
+        std::cout << std::endl;
+    }
+
+    //每个线程绑定一个CPU,任务只会在绑定的CPU上运行
+    {
+        std::vector<int> cpus = CpuTopology::availableCpus();
+        ThreadPoolExecutor tpe(4, 4);
+        tpe.setCpuAffinity(cpus);
+        std::vector<std::future<int>> res;
+        for (int i = 0; i < 100; ++i) {
+            res.push_back(tpe.submit([] { return sched_getcpu(); }));
+        }
+        for (auto& e : res) {
+            int cpu = e.get();
+            assert(std::find(cpus.begin(), cpus.end(), cpu) != cpus.end());
+        }
+        for (size_t i = 0; i < 4; ++i) {
+            assert(tpe.getWorkerCpus(i).size() == 1);
+            assert(tpe.getWorkerCpus(i)[0] == cpus[i % cpus.size()]);
+        }
+        tpe.shutdown();
+        tpe.stop();
+    }
+
+    //两个节点的拓扑:偶数线程在节点0,奇数线程在节点1,按节点提交的任务只由该节点的线程执行
+    {
+        CpuTopology twoNodes(std::vector<std::vector<int>>{{0}, {1}});
+        ThreadPoolExecutor tpe(4, 4);
+        tpe.setNumaAware(true, twoNodes);
+        for (size_t i = 0; i < 4; ++i) {
+            assert(tpe.getWorkerNode(i) == static_cast<int>(i % 2));
+        }
+        tpe.setMetricsEnabled(true);
+        std::vector<std::future<void>> res;
+        for (int i = 0; i < 100; ++i) {
+            res.push_back(tpe.submitOnNode([] {}, 1));
+        }
+        for (auto& e : res) {
+            e.get();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ExecutorMetrics metrics = tpe.getMetrics();
+        assert(metrics.workers[0].completed == 0 && metrics.workers[2].completed == 0);
+        assert(metrics.workers[1].completed + metrics.workers[3].completed == 100);
+        std::cout << "node 1 workers completed " << metrics.workers[1].completed
+                  << " + " << metrics.workers[3].completed << std::endl;
+        tpe.shutdown();
+        tpe.stop();
+    }
+
+    //窃取线程池先从同一节点窃取
+    {
+        CpuTopology twoNodes(std::vector<std::vector<int>>{{0}, {1}});
+        WorkStealingThreadPoolExecutor tpe(4, 4);
+        tpe.setNumaAware(true, twoNodes);
+        tpe.preStartCoreThreads();
+        std::vector<std::future<int>> res;
+        for (int i = 0; i < 1000; ++i) {
+            res.push_back(tpe.submitOnNode([i] { return i; }, 0));
+        }
+        long sum = 0;
+        for (auto& e : res) {
+            sum += e.get();
+        }
+        assert(sum == 999 * 1000 / 2);
+        //线程已经启动,窃取时不加锁读取节点信息,不能再修改
+        bool thrown = false;
+        try {
+            tpe.setNumaAware(false);
+        } catch (const std::logic_error&) {
+            thrown = true;
+        }
+        assert(thrown && tpe.getWorkerNode(1) == 1);
+        tpe.shutdown();
+        tpe.stop();
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
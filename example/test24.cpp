@@ -0,0 +1,53 @@
+//测试空闲等待策略:请求应答模式下直接休眠和先自旋再休眠的往返延迟
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "threadpool.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+template<typename Executor>
+static void run(const std::string& name, const IdleStrategy& strategy, int rounds) {
+    Executor tpe(2, 2);
+    tpe.setIdleStrategy(strategy);
+    tpe.preStartCoreThreads();
+    std::vector<double> latency;
+    latency.reserve(rounds);
+    for (int i = 0; i < rounds; ++i) {
+        //请求之间间隔一段时间,模拟突发到达
+        Clock::time_point next = Clock::now() + std::chrono::microseconds(20);
+        while (Clock::now() < next) {}
+        Clock::time_point begin = Clock::now();
+        tpe.submit([i] { return i; }).get();
+        latency.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+    }
+    std::sort(latency.begin(), latency.end());
+    std::cout << std::left << std::setw(48) << name
+              << std::fixed << std::setprecision(2)
+              << " p50 us=" << latency[latency.size() / 2]
+              << " p99 us=" << latency[latency.size() * 99 / 100] << std::endl;
+    tpe.shutdown();
+    tpe.stop();
+}
+
+int main(void)
+{
+    int rounds = 5000;
+    IdleStrategy park;
+    IdleStrategy spin;
+    spin.maxSpin = std::chrono::microseconds(50);
+    spin.yields = 4;
+    IdleStrategy fixedSpin = spin;
+    fixedSpin.adaptive = false;
+
+    run<ThreadPoolExecutor>("ThreadPoolExecutor park", park, rounds);
+    run<ThreadPoolExecutor>("ThreadPoolExecutor adaptive spin", spin, rounds);
+    run<ThreadPoolExecutor>("ThreadPoolExecutor fixed spin", fixedSpin, rounds);
+    run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor park", park, rounds);
+    run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor adaptive spin", spin, rounds);
+    std::cout << "ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,81 @@
+//测试PoolFuture:then流水线,whenAll,whenAny,异常传递,单线程线程池内多级流水线不会死锁
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include "threadpool.hpp"
+
+template<typename Executor>
+static bool run(const std::string& name) {
+    bool ok = true;
+    Executor tpe(1, 1);
+    tpe.preStartCoreThreads();
+
+    //多级流水线,只有一个线程,回调不阻塞线程
+    PoolFuture<std::string> f = submitAsync(tpe, [] { return 1; })
+                                .then([](const int& v) { return v + 1; })
+                                .then([](const int& v) { return v * 10; })
+                                .then([](const int& v) { return std::to_string(v); });
+    ok &= f.get() == "20";
+
+    //扇出扇入
+    std::vector<PoolFuture<int>> parts;
+    for (int i = 0; i < 100; ++i) {
+        parts.push_back(submitAsync(tpe, [i] { return i; }));
+    }
+    PoolFuture<int> sum = whenAll(parts).then([](const std::vector<int>& v) {
+        int s = 0;
+        for (int e : v) {
+            s += e;
+        }
+        return s;
+    });
+    ok &= sum.get() == 4950;
+
+    //void和异常传递,异常后的回调不执行
+    std::atomic<int> skipped{0};
+    PoolFuture<void> failed = submitAsync(tpe, [] { throw std::runtime_error("boom"); })
+                              .then([&skipped] { ++skipped; });
+    try {
+        failed.get();
+        ok = false;
+    } catch (const std::runtime_error& e) {
+        ok &= std::string(e.what()) == "boom";
+    }
+    ok &= skipped.load() == 0;
+
+    //whenAny:手动完成的promise先完成
+    PoolPromise<int> never(&tpe);
+    PoolPromise<int> first(&tpe);
+    std::vector<PoolFuture<int>> any = {never.getFuture(), first.getFuture()};
+    PoolFuture<size_t> index = whenAny(any);
+    first.setValue(7);
+    ok &= index.get() == 1 && any[1].get() == 7;
+    never.setValue(0);
+
+    //promise没有设置结果就析构
+    PoolFuture<int> broken;
+    {
+        PoolPromise<int> p(&tpe);
+        broken = p.getFuture();
+    }
+    try {
+        broken.get();
+        ok = false;
+    } catch (const std::future_error&) {}
+
+    tpe.shutdown();
+    tpe.stop();
+
+    //线程池关闭后then回调在当前线程执行
+    ok &= f.then([](const std::string& s) { return s.size(); }).get() == 2;
+
+    std::cout << name << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = run<ThreadPoolExecutor>("ThreadPoolExecutor");
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor");
+    return ok ? 0 : 1;
+}
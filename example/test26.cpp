@@ -0,0 +1,95 @@
+//测试parallelFor,parallelReduce,parallelSort:结果正确,异常传递,嵌套调用,以及随线程数的加速比
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "threadpool.hpp"
+
+static bool check(WorkStealingThreadPoolExecutor& pool) {
+    bool ok = true;
+
+    std::vector<int> v(100000, 0);
+    parallelFor(pool, 0, static_cast<int>(v.size()), 1000, [&v](int i) { v[i] = i; });
+    for (int i = 0; i < static_cast<int>(v.size()); ++i) {
+        ok &= v[i] == i;
+    }
+
+    long sum = parallelReduce(pool, 0L, 100000L, 0L, 0L,
+                              [](long i) { return i; },
+                              [](long a, long b) { return a + b; });
+    ok &= sum == 4999950000L;
+
+    //只满足结合律的归约按顺序合并
+    std::string s = parallelReduce(pool, 0, 26, 3, std::string(),
+                                   [](int i) { return std::string(1, static_cast<char>('a' + i)); },
+                                   [](const std::string& a, const std::string& b) { return a + b; });
+    ok &= s == "abcdefghijklmnopqrstuvwxyz";
+
+    //嵌套:外层的任务在线程池的线程内再调用parallelReduce
+    std::vector<long> rows(64, 0);
+    parallelFor(pool, 0, 64, 1, [&pool, &rows](int r) {
+        rows[r] = parallelReduce(pool, 0, 1000, 100, 0L,
+                                 [r](int i) { return static_cast<long>(r * i); },
+                                 [](long a, long b) { return a + b; });
+    });
+    for (int r = 0; r < 64; ++r) {
+        ok &= rows[r] == r * 499500L;
+    }
+
+    std::mt19937 gen(42);
+    std::vector<int> data(1000000);
+    for (auto& e : data) {
+        e = static_cast<int>(gen() % 1000);
+    }
+    parallelSort(pool, data.begin(), data.end());
+    ok &= std::is_sorted(data.begin(), data.end());
+    parallelSort(pool, data.begin(), data.end(), [](int a, int b) { return a > b; });
+    ok &= std::is_sorted(data.rbegin(), data.rend());
+
+    try {
+        parallelFor(pool, 0, 10000, 10, [](int i) {
+            if (i == 5000)
+                throw std::runtime_error("boom");
+        });
+        ok = false;
+    } catch (const std::runtime_error& e) {
+        ok &= std::string(e.what()) == "boom";
+    }
+    return ok;
+}
+
+int main(void)
+{
+    int maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    bool ok = true;
+    double base = 0;
+    std::vector<double> x(1 << 22);
+    std::cout << "threads  check    seconds  speedup" << std::endl;
+    for (int n = 1; n <= maxThreads; n *= 2) {
+        WorkStealingThreadPoolExecutor pool(n, n);
+        pool.preStartCoreThreads();
+        bool passed = check(pool);
+        ok &= passed;
+
+        auto begin = std::chrono::steady_clock::now();
+        for (int round = 0; round < 10; ++round) {
+            parallelFor(pool, 0, static_cast<int>(x.size()), 0, [&x](int i) {
+                x[i] = std::sqrt(static_cast<double>(i)) * std::sin(static_cast<double>(i));
+            });
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        if (n == 1)
+            base = seconds;
+
+        std::cout << std::setw(7) << n
+                  << std::setw(7) << (passed ? "ok" : "FAILED")
+                  << std::setw(12) << std::fixed << std::setprecision(3) << seconds
+                  << std::setw(9) << std::setprecision(2) << base / seconds << std::endl;
+        pool.shutdown();
+        pool.stop();
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+//测试C++20协程:co_await pool.schedule()切换到线程池,CoTask嵌套和异常,
+//co_await scheduler.sleepFor()不占用线程,大量并发协程共享两个线程,线程池拒绝时协程在当前线程继续执行
+//需要-std=c++20,C++11编译时cotask.hpp为空
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "threadpool.hpp"
+#include "cotask.hpp"
+
+#ifdef THREADPOOL_HAS_COROUTINE
+
+static CoTask<int> square(ThreadPoolExecutor& pool, int v, std::thread::id caller, bool& onPool) {
+    co_await pool.schedule();
+    onPool = std::this_thread::get_id() != caller;
+    co_return v * v;
+}
+
+static CoTask<int> sumOfSquares(ThreadPoolExecutor& pool, int n) {
+    int sum = 0;
+    for (int i = 0; i < n; ++i) {
+        bool onPool = false;
+        sum += co_await square(pool, i, std::this_thread::get_id(), onPool);
+    }
+    co_return sum;
+}
+
+static CoTask<std::string> failing(ThreadPoolExecutor& pool) {
+    co_await pool.schedule();
+    throw std::runtime_error("boom");
+}
+
+static CoTask<void> flow(ThreadPoolExecutor& pool, ScheduledThreadPoolExecutor& timer,
+                         std::atomic<int>& finished) {
+    co_await pool.schedule();
+    //模拟IO等待,等待期间不占用线程池的线程
+    co_await timer.sleepFor(std::chrono::milliseconds(50));
+    co_await pool.schedule();
+    finished.fetch_add(1);
+}
+
+static CoTask<bool> resumedInline(ThreadPoolExecutor& pool, std::thread::id caller) {
+    co_await pool.schedule();
+    co_return std::this_thread::get_id() == caller;
+}
+
+static CoTask<bool> sleepRejected(ScheduledThreadPoolExecutor& timer, std::thread::id caller) {
+    co_await timer.sleepFor(std::chrono::milliseconds(50));
+    co_return std::this_thread::get_id() == caller;
+}
+
+/**
+ * @brief IgnorePolicy 线程池关闭后提交的定时任务直接丢弃,不抛出异常
+ */
+class IgnorePolicy : public RejectedExecutionHandler {
+    public:
+        using RejectedExecutionHandler::rejectedExecution;
+
+        virtual void rejectedExecution(const Runnable&) override {}
+
+        virtual RejectedExecutionHandler* clone() const override {
+            return new IgnorePolicy(*this);
+        }
+};
+
+template<typename Executor>
+static bool run(const std::string& name) {
+    bool ok = true;
+    Executor pool(2, 2);
+    pool.preStartCoreThreads();
+
+    bool onPool = false;
+    ok &= syncWait(square(pool, 7, std::this_thread::get_id(), onPool)) == 49;
+    ok &= onPool;
+    ok &= syncWait(sumOfSquares(pool, 100)) == 328350;
+
+    try {
+        syncWait(failing(pool));
+        ok = false;
+    } catch (const std::runtime_error& e) {
+        ok &= std::string(e.what()) == "boom";
+    }
+
+    //10000个协程各等待50ms,只用两个线程和一个定时线程
+    const int flows = 10000;
+    ScheduledThreadPoolExecutor timer(pool);
+    std::atomic<int> finished{0};
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < flows; ++i) {
+        spawnDetached(flow(pool, timer, finished));
+    }
+    while (finished.load() < flows) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    ok &= seconds < 5;
+    std::cout << name << " " << flows << " flows in " << seconds << "s" << (ok ? " ok" : " FAILED") << std::endl;
+
+    //定时线程池已经关闭:默认的拒绝策略在co_await处抛出异常,不抛出异常的策略让协程立即继续
+    timer.shutdown();
+    try {
+        syncWait(sleepRejected(timer, std::this_thread::get_id()));
+        ok = false;
+    } catch (const std::logic_error&) {
+    }
+    timer.setRejectedExecutionHandler(IgnorePolicy());
+    ok &= syncWait(sleepRejected(timer, std::this_thread::get_id()));
+    timer.stop();
+
+    //线程池丢弃恢复协程的任务时协程不会挂起不动,在co_await的线程继续执行
+    pool.setRejectedExecutionHandler(DiscardPolicy());
+    pool.shutdown();
+    ok &= syncWait(resumedInline(pool, std::this_thread::get_id()));
+    pool.stop();
+    std::cout << name << " rejected" << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = run<ThreadPoolExecutor>("ThreadPoolExecutor");
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor");
+    return ok ? 0 : 1;
+}
+
+#else
+
+int main() {
+    std::cout << "coroutines are not enabled, compile with -std=c++20" << std::endl;
+    return 0;
+}
+
+#endif
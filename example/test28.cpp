@@ -0,0 +1,200 @@
+//测试拒绝策略和任务总数上限:默认抛出异常,CallerRuns,Discard,DiscardOldest,Block,LoadShedding,
+//没有重写clone的策略不会被切割成基类
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "threadpool.hpp"
+#include "rejectionpolicy.hpp"
+#include "testutil.hpp"
+
+/**
+ * @brief 阻塞唯一线程的任务,open后继续
+ *        block等到任务开始执行才返回,之后提交的任务一定在队列中排队
+ */
+struct Gate {
+    std::promise<void>       promise;
+    std::shared_future<void> future{promise.get_future().share()};
+
+    void block(ThreadPoolExecutor& tpe) {
+        std::shared_future<void> f = future;
+        std::shared_ptr<std::promise<void>> started = std::make_shared<std::promise<void>>();
+        std::future<void> running = started->get_future();
+        tpe.execute(Task([f, started] {
+            started->set_value();
+            f.wait();
+        }));
+        running.wait();
+    }
+
+    void open() {
+        promise.set_value();
+    }
+};
+
+/**
+ * @brief CountingPolicy 丢弃被拒绝的任务并计数,没有重写clone
+ */
+class CountingPolicy : public RejectedExecutionHandler {
+    public:
+        using RejectedExecutionHandler::rejectedExecution;
+
+        virtual bool rejectedExecution(Task& task, ThreadPoolExecutor&) override {
+            ++count;
+            task.reset();
+            return false;
+        }
+
+        std::atomic<int> count{0};
+};
+
+template<typename Executor>
+static bool run(const std::string& name) {
+    bool ok = true;
+    Executor tpe(1, 1);
+    tpe.preStartCoreThreads();
+    tpe.setTaskCapacity(2);
+
+    //默认策略:达到上限抛出异常
+    {
+        Gate gate;
+        gate.block(tpe);
+        auto queued = tpe.submit([] { return 1; });
+        try {
+            tpe.submit([] { return 2; });
+            ok = false;
+        } catch (const std::runtime_error&) {}
+        gate.open();
+        ok &= queued.get() == 1;
+        ok &= drain(tpe);
+    }
+
+    //CallerRuns:在提交线程执行
+    tpe.setRejectedExecutionHandler(CallerRunsPolicy());
+    {
+        Gate gate;
+        gate.block(tpe);
+        tpe.submit([] {});
+        auto f = tpe.submit([] { return std::this_thread::get_id(); });
+        ok &= f.get() == std::this_thread::get_id();
+        gate.open();
+        ok &= drain(tpe);
+    }
+
+    //Discard:future得到broken_promise
+    tpe.setRejectedExecutionHandler(new DiscardPolicy());
+    {
+        Gate gate;
+        gate.block(tpe);
+        tpe.submit([] {});
+        auto dropped = tpe.submit([] { return 3; });
+        try {
+            dropped.get();
+            ok = false;
+        } catch (const std::future_error&) {}
+        gate.open();
+        ok &= drain(tpe);
+    }
+
+    //DiscardOldest:丢弃排队最久的任务,新任务执行
+    tpe.setRejectedExecutionHandler(DiscardOldestPolicy());
+    {
+        Gate gate;
+        gate.block(tpe);
+        auto oldest = tpe.submit([] { return 4; });
+        auto newest = tpe.submit([] { return 5; });
+        gate.open();
+        ok &= newest.get() == 5;
+        try {
+            oldest.get();
+            ok = false;
+        } catch (const std::future_error&) {}
+        ok &= drain(tpe);
+    }
+
+    //Block:等到有空位,超时抛出异常
+    tpe.setRejectedExecutionHandler(BlockPolicy(std::chrono::seconds(5)));
+    {
+        Gate gate;
+        gate.block(tpe);
+        tpe.submit([] {});
+        std::thread opener([&gate] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            gate.open();
+        });
+        auto begin = std::chrono::steady_clock::now();
+        auto f = tpe.submit([] { return 6; });
+        ok &= std::chrono::steady_clock::now() - begin >= std::chrono::milliseconds(10);
+        ok &= f.get() == 6;
+        opener.join();
+        ok &= drain(tpe);
+    }
+    tpe.setRejectedExecutionHandler(BlockPolicy(std::chrono::milliseconds(10)));
+    {
+        Gate gate;
+        gate.block(tpe);
+        tpe.submit([] {});
+        try {
+            tpe.submit([] {});
+            ok = false;
+        } catch (const std::runtime_error&) {}
+        gate.open();
+        ok &= drain(tpe);
+    }
+
+    //没有重写clone的策略不能复制,通过shared_ptr设置时保留实际类型
+    {
+        try {
+            tpe.setRejectedExecutionHandler(CountingPolicy());
+            ok = false;
+        } catch (const std::logic_error&) {}
+        std::shared_ptr<CountingPolicy> counting = std::make_shared<CountingPolicy>();
+        tpe.setRejectedExecutionHandler(counting);
+        Gate gate;
+        gate.block(tpe);
+        tpe.submit([] {});
+        auto dropped = tpe.submit([] { return 7; });
+        ok &= counting->count.load() == 1;
+        try {
+            dropped.get();
+            ok = false;
+        } catch (const std::future_error&) {}
+        gate.open();
+        ok &= drain(tpe);
+    }
+
+    //LoadShedding:排队时间超过1ms后丢弃新任务,不需要达到上限
+    tpe.setTaskCapacity(0);
+    tpe.setRejectedExecutionHandler(LoadSheddingPolicy(std::chrono::milliseconds(1)));
+    {
+        uint64_t rejectedBefore = tpe.getMetrics().rejected;
+        std::atomic<int> ran{0};
+        //到达速度是处理速度的5倍,排队时间不断增长
+        for (int i = 0; i < 200; ++i) {
+            tpe.execute(Task([&ran] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ++ran;
+            }));
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        ok &= drain(tpe);
+        uint64_t shed = tpe.getMetrics().rejected - rejectedBefore;
+        ok &= shed > 0 && ran.load() + static_cast<int>(shed) == 200;
+    }
+    ok &= tpe.getPendingTaskCount() == 0;
+
+    tpe.shutdown();
+    tpe.stop();
+    std::cout << name << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = run<ThreadPoolExecutor>("ThreadPoolExecutor");
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor");
+    return ok ? 0 : 1;
+}
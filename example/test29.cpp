@@ -0,0 +1,94 @@
+//测试弹性伸缩:排队时间超过阈值时增加线程,空闲keepAlive后非核心线程退出,退出的位置可以复用
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "threadpool.hpp"
+#include "testutil.hpp"
+
+/**
+ * @brief burst 提交count个1ms的任务,返回执行过程中的最大线程数
+ */
+static int burst(ThreadPoolExecutor& tpe, int count, std::atomic<int>& ran) {
+    for (int i = 0; i < count; ++i) {
+        tpe.execute(Task([&ran] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ++ran;
+        }), i % 2 == 0);
+    }
+    int peak = tpe.getPoolSize();
+    while (tpe.getPendingTaskCount() != 0) {
+        peak = std::max(peak, tpe.getPoolSize());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return peak;
+}
+
+static bool waitShrink(ThreadPoolExecutor& tpe, int size) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (tpe.getPoolSize() != size && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return tpe.getPoolSize() == size;
+}
+
+template<typename Executor>
+static bool run(const std::string& name) {
+    bool ok = true;
+    Executor tpe(2, 6);
+    tpe.preStartCoreThreads();
+    ElasticPolicy policy;
+    policy.growThreshold = std::chrono::milliseconds(5);
+    policy.keepAlive = std::chrono::milliseconds(100);
+    policy.growInterval = std::chrono::milliseconds(2);
+    tpe.setElastic(true, policy);
+    ok &= tpe.isElastic() && tpe.isMetricsEnabled();
+
+    //两个核心线程每毫秒只能执行两个任务,排队时间增长后增加线程,不超过maxPoolSize
+    std::atomic<int> ran{0};
+    int peak = burst(tpe, 600, ran);
+    ok &= ran.load() == 600;
+    ok &= peak > 2 && peak <= 6;
+    ok &= tpe.getGrowCount() > 0;
+
+    //空闲100ms后非核心线程全部退出,核心线程保留
+    ok &= waitShrink(tpe, 2);
+    ok &= tpe.getShrinkCount() == tpe.getGrowCount();
+
+    //再次突发时复用退出的线程留下的队列位置
+    uint64_t grown = tpe.getGrowCount();
+    peak = burst(tpe, 600, ran);
+    ok &= ran.load() == 1200;
+    ok &= peak > 2 && peak <= 6 && tpe.getGrowCount() > grown;
+    ok &= waitShrink(tpe, 2);
+
+    //排队时间很短时不增加线程
+    grown = tpe.getGrowCount();
+    for (int i = 0; i < 50; ++i) {
+        tpe.execute(Task([&ran] { ++ran; }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ok &= drain(tpe);
+    ok &= tpe.getGrowCount() == grown;
+
+    ExecutorMetrics metrics = tpe.getMetrics();
+    ok &= metrics.grown == tpe.getGrowCount() && metrics.shrunk == tpe.getShrinkCount();
+    std::cout << name << " grown=" << metrics.grown << " shrunk=" << metrics.shrunk << std::endl;
+
+    //关闭后非核心线程退出,core=false的任务重新使用非核心线程自己的队列
+    tpe.setElastic(false);
+    ok &= !tpe.isElastic();
+
+    tpe.shutdown();
+    tpe.stop();
+    std::cout << name << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = run<ThreadPoolExecutor>("ThreadPoolExecutor");
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor");
+    return ok ? 0 : 1;
+}
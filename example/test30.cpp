@@ -0,0 +1,169 @@
+//测试线程池的线程内提交:任务压入自己的本地队列,由提交线程优先执行,空闲线程窃取,递归任务不受任务总数上限限制
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "threadpool.hpp"
+#include "testutil.hpp"
+
+/**
+ * @brief spawnTree 每个节点提交两个子节点,直到depth为0
+ */
+static void spawnTree(ThreadPoolExecutor& tpe, int depth, std::atomic<int>& nodes) {
+    ++nodes;
+    if (depth == 0)
+        return;
+    for (int i = 0; i < 2; ++i) {
+        tpe.execute(Task([&tpe, depth, &nodes] {
+            spawnTree(tpe, depth - 1, nodes);
+        }));
+    }
+}
+
+int main() {
+    bool ok = true;
+
+    //另一个线程被阻塞时,子任务全部由提交它们的线程执行,没有窃取
+    {
+        ThreadPoolExecutor tpe(2, 2);
+        tpe.preStartCoreThreads();
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        std::promise<void> started;
+        tpe.execute(Task([open, &started] {
+            started.set_value();
+            open.wait();
+        }));
+        started.get_future().wait();
+
+        std::mutex mutex;
+        std::vector<std::thread::id> ids;
+        std::promise<std::thread::id> parent;
+        tpe.execute(Task([&tpe, &mutex, &ids, &parent] {
+            for (int i = 0; i < 100; ++i) {
+                tpe.execute(Task([&mutex, &ids] {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ids.push_back(std::this_thread::get_id());
+                }));
+            }
+            parent.set_value(std::this_thread::get_id());
+        }));
+        std::thread::id id = parent.get_future().get();
+        while (tpe.getPendingTaskCount() > 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ok &= ids.size() == 100;
+        for (auto& e : ids) {
+            ok &= e == id;
+        }
+        ok &= tpe.getMetrics().stolen() == 0;
+        gate.set_value();
+        ok &= drain(tpe);
+        tpe.shutdown();
+        tpe.stop();
+    }
+
+    //提交线程忙时空闲线程窃取子任务
+    {
+        ThreadPoolExecutor tpe(4, 4);
+        tpe.preStartCoreThreads();
+        std::atomic<int> ran{0};
+        tpe.execute(Task([&tpe, &ran] {
+            for (int i = 0; i < 400; ++i) {
+                tpe.execute(Task([&ran] {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    ++ran;
+                }));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }));
+        ok &= drain(tpe);
+        ok &= ran.load() == 400;
+        ok &= tpe.getMetrics().stolen() > 0;
+        tpe.shutdown();
+        tpe.stop();
+    }
+
+    //递归任务树,批量提交,在线程内等待子任务,任务总数上限不限制线程内提交
+    {
+        ThreadPoolExecutor tpe(2, 2);
+        tpe.preStartCoreThreads();
+        std::atomic<int> nodes{0};
+        tpe.execute(Task([&tpe, &nodes] {
+            spawnTree(tpe, 14, nodes);
+        }));
+        ok &= drain(tpe);
+        ok &= nodes.load() == (1 << 15) - 1;
+
+        std::atomic<int> batched{0};
+        tpe.execute(Task([&tpe, &batched] {
+            std::vector<Task> tasks;
+            for (int i = 0; i < 50; ++i) {
+                tasks.emplace_back([&batched] { ++batched; });
+            }
+            tpe.executeBatch(tasks);
+        }));
+        ok &= drain(tpe);
+        ok &= batched.load() == 50;
+
+        //子任务在本地队列中,另一个线程窃取后父任务的等待才能结束
+        auto nested = tpe.submit([&tpe] {
+            return tpe.submit([] { return 7; }).get() + 1;
+        });
+        ok &= nested.get() == 8;
+        //get返回时执行任务的线程可能还没有释放任务数,等待计数归零后再限制任务总数
+        ok &= drain(tpe);
+
+        tpe.setTaskCapacity(1);
+        std::atomic<int> children{0};
+        tpe.execute(Task([&tpe, &children] {
+            for (int i = 0; i < 10; ++i) {
+                tpe.execute(Task([&children] { ++children; }));
+            }
+        }));
+        ok &= drain(tpe);
+        ok &= children.load() == 10;
+        ok &= tpe.getPendingTaskCount() == 0 && tpe.getTaskCount() == 0;
+        tpe.shutdown();
+        tpe.stop();
+    }
+
+    //线程内提交的任务记在各自线程的计数中,求和后计入任务数,外部提交检查上限时也算上它们
+    {
+        ThreadPoolExecutor tpe(2, 2);
+        tpe.preStartCoreThreads();
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        std::promise<void> started;
+        tpe.execute(Task([open, &started] {
+            started.set_value();
+            open.wait();
+        }));
+        started.get_future().wait();
+        std::promise<void> pushed;
+        std::atomic<int> children{0};
+        tpe.execute(Task([&tpe, open, &pushed, &children] {
+            for (int i = 0; i < 10; ++i) {
+                tpe.execute(Task([&children] { ++children; }));
+            }
+            pushed.set_value();
+            open.wait();
+        }));
+        pushed.get_future().wait();
+        ok &= tpe.getPendingTaskCount() == 12;
+        tpe.setTaskCapacity(12);
+        ok &= !tpe.offer(Task([] {}));
+        gate.set_value();
+        ok &= drain(tpe);
+        ok &= children.load() == 10 && tpe.offer(Task([] {})) && drain(tpe);
+        tpe.shutdown();
+        tpe.stop();
+    }
+
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
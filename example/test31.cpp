@@ -0,0 +1,281 @@
+//测试关闭流程:shutdown后并行排空剩下的任务,定时线程池取消周期任务后终止,awaitTermination限时等待,shutdownNow返回没有执行的任务,任务不丢失也不重复执行
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "threadpool.hpp"
+#include "rejectionpolicy.hpp"
+
+/**
+ * @brief Gate 阻塞线程池的一个线程,直到open
+ */
+struct Gate {
+    Gate() : open_(promise_.get_future().share()) {}
+
+    void block(ThreadPoolExecutor& tpe) {
+        std::shared_ptr<std::promise<void>> started = std::make_shared<std::promise<void>>();
+        std::shared_future<void> open = open_;
+        tpe.execute(Task([started, open] {
+            started->set_value();
+            open.wait();
+        }));
+        started->get_future().wait();
+    }
+
+    void open() {
+        promise_.set_value();
+    }
+
+    std::promise<void>       promise_;
+    std::shared_future<void> open_;
+};
+
+template<typename Executor>
+static bool run(const std::string& name) {
+    bool ok = true;
+    const auto second = std::chrono::seconds(5);
+
+    //一个线程被阻塞,其他线程在shutdown后排空所有队列,包括被阻塞线程的队列
+    {
+        Executor tpe(4, 4);
+        tpe.preStartCoreThreads();
+        Gate gate;
+        gate.block(tpe);
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 400; ++i) {
+            tpe.execute(Task([&ran] {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                ++ran;
+            }));
+        }
+        tpe.shutdown();
+        ok &= tpe.isShutDown() && !tpe.isRunning();
+        auto deadline = std::chrono::steady_clock::now() + second;
+        while (ran.load() != 400 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ok &= ran.load() == 400;
+        //阻塞的任务还在执行,限时等待超时
+        ok &= !tpe.awaitTermination(std::chrono::milliseconds(20)) && !tpe.isTerminated();
+        gate.open();
+        ok &= tpe.awaitTermination(second) && tpe.isTerminated();
+        ok &= tpe.getPoolSize() == 0 && tpe.getPendingTaskCount() == 0;
+        tpe.stop();
+    }
+
+    //所有线程都在休眠时shutdown唤醒它们,线程池很快终止;shutdown后线程提交的子任务也会执行
+    {
+        Executor tpe(4, 4);
+        tpe.preStartCoreThreads();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        tpe.shutdown();
+        ok &= tpe.awaitTermination(second) && tpe.getPoolSize() == 0;
+
+        Executor nested(2, 2);
+        nested.preStartCoreThreads();
+        std::promise<void> down;
+        std::shared_future<void> closed = down.get_future().share();
+        std::atomic<int> children{0};
+        nested.execute(Task([&nested, closed, &children] {
+            closed.wait();
+            for (int i = 0; i < 10; ++i) {
+                nested.execute(Task([&children] { ++children; }));
+            }
+        }));
+        nested.shutdown();
+        down.set_value();
+        ok &= nested.awaitTermination(second) && children.load() == 10;
+        nested.stop();
+    }
+
+    //shutdownNow返回没有开始执行的任务,返回的任务仍然可以执行
+    {
+        Executor tpe(2, 2);
+        tpe.preStartCoreThreads();
+        Gate gate;
+        gate.block(tpe);
+        gate.block(tpe);
+        std::atomic<int> ran{0};
+        std::vector<std::future<int>> results;
+        for (int i = 0; i < 100; ++i) {
+            results.push_back(tpe.submit([&ran, i] {
+                ++ran;
+                return i;
+            }));
+        }
+        std::vector<Task> abandoned = tpe.shutdownNow();
+        ok &= abandoned.size() == 100 && ran.load() == 0;
+        //只剩两个阻塞的任务
+        ok &= tpe.getPendingTaskCount() == 2 && tpe.getTaskCount() == 0;
+        gate.open();
+        ok &= tpe.awaitTermination(second);
+        for (auto& e : abandoned) {
+            e();
+        }
+        ok &= ran.load() == 100;
+        for (int i = 0; i < 100; ++i) {
+            ok &= results[i].get() == i;
+        }
+        tpe.stop();
+    }
+
+    //排空时间内完成不返回任务,超时后返回剩下的任务
+    {
+        Executor tpe(2, 2);
+        tpe.preStartCoreThreads();
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 20; ++i) {
+            tpe.execute(Task([&ran] { ++ran; }));
+        }
+        ok &= tpe.shutdownGracefully(second).empty() && ran.load() == 20 && tpe.isTerminated();
+
+        Executor slow(1, 1);
+        slow.preStartCoreThreads();
+        Gate gate;
+        gate.block(slow);
+        for (int i = 0; i < 20; ++i) {
+            slow.execute(Task([&ran] { ++ran; }));
+        }
+        std::vector<Task> abandoned = slow.shutdownGracefully(std::chrono::milliseconds(20));
+        ok &= abandoned.size() == 20;
+        gate.open();
+        ok &= slow.awaitTermination(second);
+        slow.stop();
+    }
+
+    //提交和shutdownNow同时进行,每个被接受的任务恰好执行或返回一次
+    {
+        Executor tpe(4, 4);
+        tpe.setRejectedExecutionHandler(DiscardPolicy());
+        const int count = 20000;
+        std::unique_ptr<std::atomic<int>[]> hits(new std::atomic<int>[count]);
+        std::unique_ptr<std::atomic<bool>[]> accepted(new std::atomic<bool>[count]);
+        for (int i = 0; i < count; ++i) {
+            hits[i] = 0;
+            accepted[i] = false;
+        }
+        std::atomic<int> submitted{0};
+        std::thread producer([&] {
+            for (int i = 0; i < count; ++i) {
+                accepted[i] = tpe.execute(Task([&hits, i] { ++hits[i]; }));
+                ++submitted;
+            }
+        });
+        while (submitted.load() < count / 4) {
+            std::this_thread::yield();
+        }
+        std::vector<Task> abandoned = tpe.shutdownNow();
+        producer.join();
+        ok &= tpe.awaitTermination(second);
+        for (auto& e : abandoned) {
+            e();
+        }
+        for (int i = 0; i < count; ++i) {
+            ok &= hits[i].load() == (accepted[i].load() ? 1 : 0);
+        }
+        ok &= tpe.getPendingTaskCount() == 0;
+        tpe.stop();
+    }
+
+    std::cout << name << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+/**
+ * @brief 定时线程池没有execute,单独测试:shutdown取消周期任务,执行完剩下的一次性任务后终止
+ */
+template<>
+bool run<ScheduledThreadPoolExecutor>(const std::string& name) {
+    bool ok = true;
+    const auto second = std::chrono::seconds(5);
+    auto broken = [](std::future<void>& future) {
+        try {
+            future.get();
+        } catch (const std::future_error&) {
+            return true;
+        }
+        return false;
+    };
+
+    //定时线程都在等待时shutdown唤醒它们,线程池很快终止
+    {
+        ScheduledThreadPoolExecutor tpe(2);
+        tpe.preStartCoreThreads();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        tpe.shutdown();
+        ok &= tpe.awaitTermination(second) && tpe.getPoolSize() == 0;
+    }
+
+    //周期任务在shutdown后不再执行,到期的一次性任务照常执行,之后线程池终止
+    for (int mode = 0; mode < 3; ++mode) {
+        ThreadPoolExecutor workers(2, 2);
+        std::unique_ptr<ScheduledThreadPoolExecutor> tpe;
+        if (mode == 0)
+            tpe.reset(new ScheduledThreadPoolExecutor(2));
+        else if (mode == 1)
+            tpe.reset(new ScheduledThreadPoolExecutor(2, new TimingWheel()));
+        else
+            tpe.reset(new ScheduledThreadPoolExecutor(workers));
+        std::atomic<int> ticks{0};
+        auto rate = tpe->scheduleAtFixedRate([&ticks] { ++ticks; },
+                                             std::chrono::milliseconds(0), std::chrono::milliseconds(1));
+        auto hourly = tpe->scheduleAtFixedDelay([] {}, std::chrono::hours(1), std::chrono::hours(1));
+        auto delayed = tpe->schedule([] { return 7; }, std::chrono::milliseconds(30));
+        while (ticks.load() < 3) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        tpe->shutdown();
+        ok &= tpe->awaitTermination(second) && tpe->getPoolSize() == 0 && tpe->getTaskCount() == 0;
+        ok &= delayed.get() == 7 && broken(rate.future()) && broken(hourly.future());
+        int stopped = ticks.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ok &= ticks.load() == stopped;
+        //关闭后提交的任务被拒绝
+        bool rejected = false;
+        try {
+            tpe->schedule([] {}, std::chrono::milliseconds(0));
+        } catch (const std::logic_error&) {
+            rejected = true;
+        }
+        ok &= rejected;
+        tpe.reset();
+        workers.stop();
+    }
+
+    //shutdownNow取消还没有到期的一次性任务
+    {
+        ScheduledThreadPoolExecutor tpe(1);
+        auto delayed = tpe.schedule([] {}, std::chrono::hours(1));
+        tpe.shutdownNow();
+        ok &= tpe.awaitTermination(second) && broken(delayed.future());
+    }
+
+    std::cout << name << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = run<ThreadPoolExecutor>("ThreadPoolExecutor");
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor");
+    ok &= run<ScheduledThreadPoolExecutor>("ScheduledThreadPoolExecutor");
+
+    //非核心线程的队列也在shutdown后排空
+    {
+        ThreadPoolExecutor tpe(1, 3);
+        tpe.keepNonCoreThreadAlive(true);
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 300; ++i) {
+            tpe.execute(Task([&ran] { ++ran; }), i % 2 == 0);
+        }
+        tpe.shutdown();
+        ok &= tpe.awaitTermination(std::chrono::seconds(5)) && ran.load() == 300;
+        tpe.stop();
+        std::cout << "non-core " << (ok ? "ok" : "FAILED") << std::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+//测试任务跟踪:提交,开始,结束,窃取和休眠事件记录在每个线程的环形缓冲区,导出为Chrome trace JSON
+//这个测试和线程池的源文件一起用-DTHREADPOOL_TRACE编译
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "threadpool.hpp"
+#include "trace.hpp"
+
+static size_t countOf(const std::string& s, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t pos = s.find(pattern); pos != std::string::npos; pos = s.find(pattern, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+template<typename Executor>
+static bool run(const std::string& name) {
+    bool ok = true;
+    Tracer::clear();
+    Tracer::setEnabled(true);
+    {
+        Executor tpe(4, 4);
+        tpe.preStartCoreThreads();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        //一个任务提交100个子任务后忙一段时间,其他线程窃取子任务
+        std::atomic<int> ran{0};
+        tpe.execute(Task([&tpe, &ran] {
+            for (int i = 0; i < 100; ++i) {
+                tpe.execute(Task([&ran] {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    ++ran;
+                }));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }));
+        for (int i = 0; i < 99; ++i) {
+            tpe.execute(Task([&ran] { ++ran; }));
+        }
+        tpe.shutdown();
+        ok &= tpe.awaitTermination(std::chrono::seconds(5)) && ran.load() == 199;
+        tpe.stop();
+    }
+    Tracer::setEnabled(false);
+
+    std::ostringstream out;
+    Tracer::writeChromeTrace(out);
+    std::string json = out.str();
+    ok &= json.compare(0, 18, "{\"displayTimeUnit\"") == 0;
+    ok &= json.find("\n]}") != std::string::npos;
+    //每个任务一次提交,一个区间和一个flow箭头
+    ok &= countOf(json, "{\"name\":\"submit\"") == 200;
+    ok &= countOf(json, "{\"name\":\"task\",\"ph\":\"B\"") == 200;
+    ok &= countOf(json, "{\"name\":\"task\",\"ph\":\"E\"") == 200;
+    ok &= countOf(json, "{\"name\":\"task\",\"ph\":\"f\"") == 200;
+    ok &= countOf(json, "{\"name\":\"steal\"") > 0;
+    ok &= countOf(json, "{\"name\":\"park\",\"ph\":\"B\"") > 0;
+    ok &= countOf(json, "\"thread_name\"") >= 5;
+    std::cout << name << " events=" << Tracer::eventCount() << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = run<ThreadPoolExecutor>("ThreadPoolExecutor");
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor");
+
+    //写满后覆盖最早的事件,导出最近的capacity个
+    TraceBuffer buffer(64);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        buffer.push(TraceEventType::SUBMIT, i, 0);
+    }
+    std::vector<TraceEvent> events = buffer.snapshot();
+    ok &= events.size() == 64 && events.front().id == 936 && events.back().id == 999;
+    for (size_t i = 1; i < events.size(); ++i) {
+        ok &= events[i].ticks >= events[i - 1].ticks;
+    }
+
+    //关闭时只读一次开关;开启时的开销是读时间戳加上写入槽位,分开报告,
+    //时间戳的开销取决于平台(虚拟机上rdtsc可能要几十纳秒),写入槽位只有几纳秒
+    const int count = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        Tracer::record(TraceEventType::STEAL, static_cast<uint64_t>(i));
+    }
+    auto off = std::chrono::steady_clock::now() - start;
+    Tracer::setEnabled(true);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        Tracer::record(TraceEventType::STEAL, static_cast<uint64_t>(i));
+    }
+    auto on = std::chrono::steady_clock::now() - start;
+    Tracer::setEnabled(false);
+    volatile uint64_t sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        sink = traceTicks();
+    }
+    auto ticks = std::chrono::steady_clock::now() - start;
+    (void)sink;
+    long onNs = std::chrono::duration_cast<std::chrono::nanoseconds>(on).count() / count;
+    long ticksNs = std::chrono::duration_cast<std::chrono::nanoseconds>(ticks).count() / count;
+    std::cout << "record off=" << std::chrono::duration_cast<std::chrono::nanoseconds>(off).count() / count
+              << "ns on=" << onNs << "ns timestamp=" << ticksNs
+              << "ns record=" << std::max(0L, onNs - ticksNs) << "ns" << std::endl;
+
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+//测试TaskGroup:run提交一组任务,wait等待全部结束并在等待时执行组内任务,线程池线程很少时嵌套等待不会死锁,cancel和异常取消没有开始的任务
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "threadpool.hpp"
+
+/**
+ * @brief fib 每一层在一个TaskGroup中计算两个子问题,线程池的线程嵌套等待
+ */
+static long fib(ThreadPoolExecutor& tpe, int n) {
+    if (n < 2)
+        return n;
+    long x = 0, y = 0;
+    TaskGroup group(tpe);
+    group.run([&tpe, &x, n] { x = fib(tpe, n - 1); });
+    group.run([&tpe, &y, n] { y = fib(tpe, n - 2); });
+    group.wait();
+    return x + y;
+}
+
+template<typename Executor>
+static bool run(const std::string& name, int threads) {
+    bool ok = true;
+    Executor tpe(threads, threads);
+    tpe.preStartCoreThreads();
+
+    //调用线程不是线程池的线程
+    {
+        std::atomic<int> ran{0};
+        TaskGroup group(tpe);
+        for (int i = 0; i < 1000; ++i) {
+            group.run([&ran] { ++ran; });
+        }
+        group.wait();
+        ok &= ran.load() == 1000 && group.getPendingCount() == 0;
+    }
+
+    //线程池的所有线程都在等待各自的组,组内任务由等待的线程执行
+    {
+        std::future<long> result = tpe.submit([&tpe] { return fib(tpe, 20); });
+        ok &= result.wait_for(std::chrono::seconds(10)) == std::future_status::ready &&
+              result.get() == 6765;
+    }
+
+    //第一个异常由wait重新抛出,之后的任务不再执行,组可以继续使用
+    {
+        std::atomic<int> ran{0};
+        TaskGroup group(tpe);
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        group.run([open] {
+            open.wait();
+            throw std::runtime_error("failed");
+        });
+        for (int i = 0; i < 100; ++i) {
+            group.run([&group, &ran] {
+                if (!group.isCancelled())
+                    ++ran;
+            });
+        }
+        gate.set_value();
+        bool thrown = false;
+        try {
+            group.wait();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        ok &= thrown && ran.load() <= 100;
+        ok &= !group.isCancelled();
+        group.run([&ran] { ran = -1; });
+        group.wait();
+        ok &= ran.load() == -1;
+    }
+
+    //cancel丢弃没有开始的任务,正在执行的任务结束后wait返回
+    {
+        std::atomic<int> ran{0};
+        TaskGroup group(tpe);
+        std::promise<void> started;
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        group.run([&started, open] {
+            started.set_value();
+            open.wait();
+        });
+        started.get_future().wait();
+        //只有一个线程时,后面的任务排在被阻塞的线程后面,一个也不会开始
+        for (int i = 0; i < 100; ++i) {
+            group.run([&ran] {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                ++ran;
+            });
+        }
+        group.cancel();
+        ok &= group.isCancelled();
+        group.run([&ran] { ran += 1000; });
+        gate.set_value();
+        group.wait();
+        ok &= ran.load() < 100 && group.getPendingCount() == 0;
+        if (threads == 1)
+            ok &= ran.load() == 0;
+    }
+
+    tpe.shutdown();
+    ok &= tpe.awaitTermination(std::chrono::seconds(5));
+    tpe.stop();
+    std::cout << name << "(" << threads << ")" << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = run<ThreadPoolExecutor>("ThreadPoolExecutor", 1);
+    ok &= run<ThreadPoolExecutor>("ThreadPoolExecutor", 2);
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor", 1);
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor", 4);
+
+    //线程池拒绝任务时由wait的线程执行
+    {
+        ThreadPoolExecutor tpe(1, 1);
+        tpe.shutdown();
+        std::atomic<int> ran{0};
+        TaskGroup group(tpe);
+        for (int i = 0; i < 10; ++i) {
+            group.run([&ran] { ++ran; });
+        }
+        group.wait();
+        ok &= ran.load() == 10;
+        tpe.stop();
+        std::cout << "rejected " << (ok ? "ok" : "FAILED") << std::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+//测试队列统计:getTaskCount和getActiveCount读取每个队列和每个线程的原子计数,不加锁,队列很长时也不阻塞线程池
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "threadpool.hpp"
+
+template<typename Executor>
+static bool run(const std::string& name) {
+    bool ok = true;
+    const int threads = 4;
+    Executor tpe(threads, threads);
+    tpe.preStartCoreThreads();
+    ok &= tpe.getTaskCount() == 0 && tpe.getActiveCount() == 0;
+
+    //所有线程都被阻塞,之后提交的任务全部排队
+    std::promise<void> gate;
+    std::shared_future<void> open = gate.get_future().share();
+    std::vector<std::shared_ptr<std::promise<void>>> started;
+    for (int i = 0; i < threads; ++i) {
+        started.push_back(std::make_shared<std::promise<void>>());
+        std::shared_ptr<std::promise<void>> s = started.back();
+        tpe.execute(Task([s, open] {
+            s->set_value();
+            open.wait();
+        }));
+    }
+    for (auto& e : started) {
+        e->get_future().wait();
+    }
+    ok &= tpe.getActiveCount() == threads && tpe.getTaskCount() == 0;
+
+    //提交的同时另一个线程不停地读取统计
+    const long backlog = 200000;
+    std::atomic<bool> done{false};
+    std::atomic<long> reads{0};
+    std::atomic<bool> monotonic{true};
+    std::thread monitor([&] {
+        long last = 0;
+        while (!done.load()) {
+            long count = tpe.getTaskCount();
+            if (count < last)
+                monotonic = false;
+            last = count;
+            ++reads;
+        }
+    });
+    std::atomic<long> ran{0};
+    for (long i = 0; i < backlog; ++i) {
+        tpe.execute(Task([&ran] { ++ran; }));
+    }
+    done = true;
+    monitor.join();
+    ok &= monotonic.load() && reads.load() > 0;
+    ok &= tpe.getTaskCount() == backlog && tpe.getActiveCount() == threads;
+
+    //队列很长时读取统计的时间和队列长度无关
+    const int calls = 100000;
+    auto start = std::chrono::steady_clock::now();
+    long sum = 0;
+    for (int i = 0; i < calls; ++i) {
+        sum += tpe.getTaskCount() + tpe.getActiveCount();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    ok &= sum == static_cast<long>(calls) * (backlog + threads);
+
+    gate.set_value();
+    while (tpe.getPendingTaskCount() != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ok &= ran.load() == backlog && tpe.getTaskCount() == 0 && tpe.getActiveCount() == 0;
+
+    //线程池的线程提交到本地队列的任务也被统计
+    std::promise<long> nested;
+    std::promise<void> release;
+    std::shared_future<void> resume = release.get_future().share();
+    tpe.execute(Task([&tpe, &nested, resume] {
+        for (int i = 0; i < 100; ++i) {
+            tpe.execute(Task([resume] { resume.wait(); }));
+        }
+        nested.set_value(tpe.getTaskCount());
+    }));
+    long local = nested.get_future().get();
+    ok &= local > 0 && local <= 100;
+    release.set_value();
+
+    tpe.shutdown();
+    ok &= tpe.awaitTermination(std::chrono::seconds(5));
+    ok &= tpe.getTaskCount() == 0 && tpe.getActiveCount() == 0;
+    tpe.stop();
+    std::cout << name << " reads=" << reads.load() << " stats="
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / calls
+              << "ns" << (ok ? " ok" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = run<ThreadPoolExecutor>("ThreadPoolExecutor");
+    ok &= run<WorkStealingThreadPoolExecutor>("WorkStealingThreadPoolExecutor");
+    return ok ? 0 : 1;
+}
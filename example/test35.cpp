@@ -0,0 +1,76 @@
+//测试控制状态的缓存行布局:提交和完成时修改的变量之间,以及和只读配置之间至少隔一个缓存行,Thread的控制标志和自身状态分开
+#include <iostream>
+#include <cstddef>
+#include "threadpool.hpp"
+
+const std::ptrdiff_t CACHE_LINE = 64;
+
+/**
+ * @brief apart 两个变量之间的空隙至少一个缓存行,不论对象从哪里开始都不会落在同一个缓存行
+ */
+template<typename A, typename B>
+static bool apart(const A& a, const B& b) {
+    const char* pa = reinterpret_cast<const char*>(&a);
+    const char* pb = reinterpret_cast<const char*>(&b);
+    if (pa < pb)
+        return pb - (pa + sizeof(A)) >= CACHE_LINE;
+    return pa - (pb + sizeof(B)) >= CACHE_LINE;
+}
+
+struct ExecutorProbe : public ThreadPoolExecutor {
+    ExecutorProbe() : ThreadPoolExecutor(2, 4) {}
+
+    bool padded() const {
+        bool ok = true;
+        ok &= apart(ctl_, pendingTasks_) && apart(ctl_, submitters_) && apart(ctl_, parkedWorkers_);
+        ok &= apart(pendingTasks_, submitters_) && apart(pendingTasks_, parkedWorkers_);
+        ok &= apart(submitters_, parkedWorkers_);
+        ok &= apart(submitId_, ctl_) && apart(submitId_, pendingTasks_) && apart(submitId_, mutex_);
+        ok &= apart(mutex_, ctl_) && apart(mutex_, pendingTasks_) && apart(mutex_, parkedWorkers_);
+        //只读为主的配置和每个线程的记录不和控制变量共享缓存行
+        ok &= apart(taskCapacity_, ctl_) && apart(checksAdmission_, pendingTasks_);
+        ok &= apart(slotCount_, ctl_) && apart(priorityQueues_, ctl_);
+        ok &= apart(retiredThreads_, rejected_);
+        return ok;
+    }
+
+    bool workerRecordsPadded() const {
+        bool ok = true;
+        //相邻队列的计数和锁不共享缓存行
+        for (size_t i = 1; i < workQueues_.size(); ++i) {
+            ok &= reinterpret_cast<const char*>(&workQueues_[i]) -
+                  reinterpret_cast<const char*>(&workQueues_[i - 1]) >= 2 * CACHE_LINE;
+        }
+        ok &= sizeof(Parker) >= 2 * CACHE_LINE;
+        ok &= sizeof(WorkStealingQueue<Task*>) >= 3 * CACHE_LINE;
+        ok &= sizeof(WorkerMetrics) >= 2 * CACHE_LINE;
+        ok &= sizeof(PriorityQueues) >= 2 * sizeof(BlockingQueue<Task>) + 2 * CACHE_LINE;
+        return ok;
+    }
+};
+
+struct ThreadProbe : public Thread {
+    bool padded() const {
+        return apart(stop_, idle_) && apart(yield_, idle_) && apart(yield_, lastActiveTime_) &&
+               apart(prio_, stop_);
+    }
+};
+
+int main() {
+    bool ok = true;
+    {
+        ExecutorProbe tpe;
+        ok &= tpe.padded() && tpe.workerRecordsPadded();
+        std::cout << "executor layout " << (ok ? "ok" : "FAILED") << std::endl;
+        tpe.shutdown();
+        tpe.stop();
+    }
+    {
+        ThreadProbe thread;
+        ok &= thread.padded();
+        std::cout << "thread layout " << (ok ? "ok" : "FAILED") << std::endl;
+    }
+
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#ifndef TESTUTIL_HPP
+#define TESTUTIL_HPP
+
+#include <chrono>
+#include <thread>
+
+#include "threadpool.hpp"
+
+/**
+ * @brief drain 等待线程池已经接受的任务全部执行完,线程池继续运行
+ *
+ * @param tpe 线程池
+ * @param timeout 最长等待时间
+ *
+ * @return false - 超时
+ */
+inline bool drain(ThreadPoolExecutor& tpe, std::chrono::nanoseconds timeout = std::chrono::seconds(10)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (tpe.getPendingTaskCount() != 0) {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+#endif /* TESTUTIL_HPP */
@@ -1,16 +1,24 @@
 #ifndef BLOCKINGQUEUE_HPP
 #define BLOCKINGQUEUE_HPP
 
+#include <atomic>
 #include <mutex>
 #include <queue>
 #include <condition_variable>
 #include <iostream>
 #include <cassert>
+#include <memory>
+#include <stdexcept>
 
 #include "runnable.hpp"
+#include "mpmcqueue.hpp"
 
 template <typename T>
 /// @brief BlockingQueue 阻塞队列(FIFO)
+///        默认是std::queue加锁的无界队列,
+///        指定容量时使用有界无锁环形队列MPMCQueue,
+///        只有队列真正为空或满时才会使用锁和条件变量等待;
+///        无界队列的元素个数另外保存在单独缓存行的原子计数中,size和is_empty不加锁
 class BlockingQueue {
     public:
         /**
@@ -21,6 +29,17 @@ class BlockingQueue {
               _notEmpty(),
               _queue() {}
 
+        /**
+         * @brief BlockingQueue 有界队列构造函数
+         *
+         * @param capacity 容量,会向上取整为2的幂,0表示无界队列
+         */
+        explicit BlockingQueue(size_t capacity)
+            : _mutex(),
+              _notEmpty(),
+              _queue(),
+              _ring(capacity > 0 ? new MPMCQueue<T>(capacity) : nullptr) {}
+
         /**
          *  @brief BlockingQueue 初始化列表构造函数
          *
@@ -29,7 +48,8 @@ class BlockingQueue {
         BlockingQueue(std::initializer_list<T>& args)
             : _mutex(),
               _notEmpty(),
-              _queue{args} {}
+              _queue{args},
+              _size(_queue.size()) {}
 
         /**
          * @brief BlockingQueue 拷贝构造
@@ -39,11 +59,11 @@ class BlockingQueue {
         BlockingQueue(const BlockingQueue&);
 
         /**
-         * @brief BlockingQueue 复制构造函数
+         * @brief BlockingQueue 移动构造函数
          *
          * @param rh BlockingQueue 阻塞队列
          */
-        BlockingQueue(const BlockingQueue&& rh);
+        BlockingQueue(BlockingQueue&& rh) noexcept;
 
         /**
          * @brief operator= 赋值运算符
@@ -53,13 +73,13 @@ class BlockingQueue {
         BlockingQueue& operator=(const BlockingQueue &);
 
         /**
-         * @brief operator= 赋值运算符
+         * @brief operator= 移动赋值运算符
          *
          * @param rh BlockingQueue 阻塞队列
          *
          * @return BlockingQueue 阻塞队列的引用
          */
-        BlockingQueue& operator=(const BlockingQueue&&);
+        BlockingQueue& operator=(BlockingQueue&&);
 
         /**
          * @brief back 得到最后一个元素
@@ -67,6 +87,8 @@ class BlockingQueue {
          * @return 最后一个元素
          */
         T back() {
+            if (_ring)
+                throw std::logic_error("back() is not supported by bounded BlockingQueue");
             std::lock_guard<std::mutex> lk(_mutex);
             return _queue.back();
         }
@@ -77,6 +99,8 @@ class BlockingQueue {
          * @return 第一个元素
          */
         T front() {
+            if (_ring)
+                throw std::logic_error("front() is not supported by bounded BlockingQueue");
             std::lock_guard<std::mutex> lk(_mutex);
             return _queue.front();
         }
@@ -87,34 +111,101 @@ class BlockingQueue {
          * @param x
          */
         void put(const T &x) {
+            if (_ring) {
+                T copy(x);
+                putRing(std::move(copy));
+                return;
+            }
             std::lock_guard<std::mutex> lk(_mutex);
             _queue.push(x);
+            _size.fetch_add(1);
             _notEmpty.notify_one();
         }
 
         /**
-         * @brief put 插入
+         * @brief put 插入,有界队列满时阻塞
          *
          * @param x
          */
-        void put(const T&& x) {
+        void put(T&& x) {
+            if (_ring) {
+                putRing(std::move(x));
+                return;
+            }
             std::lock_guard<std::mutex> lk(_mutex);
             _queue.push(std::move(x));
+            _size.fetch_add(1);
             _notEmpty.notify_one();
         }
 
+        /**
+         * @brief put_all 批量插入,无界队列只加一次锁,最后只唤醒一次
+         *
+         * @param first 起始迭代器,元素会被移动
+         * @param last 结束迭代器
+         */
+        template<typename Iterator>
+        void put_all(Iterator first, Iterator last) {
+            if (first == last)
+                return;
+            if (_ring) {
+                for (; first != last; ++first) {
+                    T x(std::move(*first));
+                    if (!_ring->try_push(std::move(x)))
+                        putRing(std::move(x));
+                }
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (_takeWaiters.load(std::memory_order_relaxed) > 0) {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    _notEmpty.notify_all();
+                }
+                return;
+            }
+            std::lock_guard<std::mutex> lk(_mutex);
+            size_t count = 0;
+            for (; first != last; ++first, ++count) {
+                _queue.push(std::move(*first));
+            }
+            _size.fetch_add(count);
+            _notEmpty.notify_all();
+        }
+
+        /**
+         * @brief try_put 插入,有界队列满时立即返回
+         *
+         * @param x 元素,失败时不会被移动
+         *
+         * @return true - 成功
+         */
+        bool try_put(T&& x) {
+            if (_ring) {
+                if (!_ring->try_push(std::move(x)))
+                    return false;
+                wakeTaker();
+                return true;
+            }
+            put(std::move(x));
+            return true;
+        }
+
         /**
          * @brief take 弹出队列元素
          *
          * @return 队列元素
          */
         T take() {
+            if (_ring) {
+                T front;
+                wait_and_pop(front);
+                return front;
+            }
             std::unique_lock<std::mutex> lk(_mutex);
             _notEmpty.wait(lk, [this] {  return !this->_queue.empty(); });
             assert(!_queue.empty());
 
             T front(std::move(_queue.front()));
             _queue.pop();
+            _size.fetch_sub(1);
 
             return  front;
         }
@@ -125,34 +216,56 @@ class BlockingQueue {
          * @param value 弹出元素赋值对象
          */
         void wait_and_pop(T& value) {
+            if (_ring) {
+                if (!_ring->try_pop(value)) {
+                    std::unique_lock<std::mutex> lk(_mutex);
+                    _takeWaiters.fetch_add(1);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    _notEmpty.wait(lk, [this, &value] { return _ring->try_pop(value); });
+                    _takeWaiters.fetch_sub(1);
+                }
+                wakePutter();
+                return;
+            }
             std::unique_lock<std::mutex> lk(_mutex);
             _notEmpty.wait(lk, [this] {return !_queue.empty();});
-            value = _queue.front();
+            value = std::move(_queue.front());
             _queue.pop();
+            _size.fetch_sub(1);
         }
 
         /**
-         * @brief wait_and_pop 弹出队列元素
+         * @brief try_pop 弹出队列元素,队列为空时立即返回
          *
          * @param value 弹出元素赋值对象
+         *
+         * @return true - 成功
          */
         bool try_pop(T& value) {
+            if (_ring) {
+                if (!_ring->try_pop(value))
+                    return false;
+                wakePutter();
+                return true;
+            }
             std::lock_guard<std::mutex> lk(_mutex);
             if(_queue.empty())
                 return false;
             value = std::move(_queue.front());
             _queue.pop();
+            _size.fetch_sub(1);
             return true;
         }
 
         /**
-         * @brief size 返回元素个数
+         * @brief size 返回元素个数,不加锁,并发修改时是近似值
          *
          * @return 元素个数
          */
         size_t size() const {
-            std::lock_guard<std::mutex> lk(_mutex);
-            return _queue.size();
+            if (_ring)
+                return _ring->size();
+            return _size.load();
         }
 
         /**
@@ -161,14 +274,70 @@ class BlockingQueue {
          * @return true - 队列为空
          */
         bool is_empty() const {
-            std::lock_guard<std::mutex> lk(_mutex);
-            return _queue.empty();
+            if (_ring)
+                return _ring->size() == 0;
+            return _size.load() == 0;
+        }
+
+        /**
+         * @brief capacity 返回容量
+         *
+         * @return 容量,0表示无界队列
+         */
+        size_t capacity() const {
+            return _ring ? _ring->capacity() : 0;
+        }
+
+    private:
+        /**
+         * @brief putRing 插入有界队列,队列满时在_notFull上等待
+         */
+        void putRing(T&& x) {
+            if (!_ring->try_push(std::move(x))) {
+                std::unique_lock<std::mutex> lk(_mutex);
+                _putWaiters.fetch_add(1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                _notFull.wait(lk, [this, &x] { return _ring->try_push(std::move(x)); });
+                _putWaiters.fetch_sub(1);
+            }
+            wakeTaker();
+        }
+
+        /**
+         * @brief wakeTaker 有线程在等待时才获取锁并唤醒一个取元素的线程
+         */
+        void wakeTaker() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_takeWaiters.load(std::memory_order_relaxed) > 0) {
+                std::lock_guard<std::mutex> lk(_mutex);
+                _notEmpty.notify_one();
+            }
+        }
+
+        /**
+         * @brief wakePutter 有线程在等待时才获取锁并唤醒一个插入元素的线程
+         */
+        void wakePutter() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_putWaiters.load(std::memory_order_relaxed) > 0) {
+                std::lock_guard<std::mutex> lk(_mutex);
+                _notFull.notify_one();
+            }
         }
 
     private:
         mutable std::mutex _mutex;
         std::condition_variable _notEmpty;
         std::queue<T> _queue;
+        ///有界队列,为nullptr时使用_queue
+        std::unique_ptr<MPMCQueue<T>> _ring;
+        std::condition_variable _notFull;
+        std::atomic<int> _takeWaiters{0};
+        std::atomic<int> _putWaiters{0};
+        ///无界队列的元素个数,在锁内修改;前后填充,vector中相邻队列不共享缓存行
+        char _pad0[64];
+        std::atomic<size_t> _size{0};
+        char _pad1[64];
 };
 
 
@@ -176,27 +345,49 @@ template <typename T>
 BlockingQueue<T>::BlockingQueue(const BlockingQueue<T>& rh)
     : _mutex(),
       _notEmpty() {
-    std::lock_guard<std::mutex> lk(_mutex);
+    std::lock_guard<std::mutex> lk(rh._mutex);
     this->_queue = rh._queue;
+    this->_size.store(this->_queue.size());
+    if (rh._ring)
+        this->_ring.reset(new MPMCQueue<T>(*rh._ring));
 }
 
 template <typename T>
-BlockingQueue<T>::BlockingQueue(const BlockingQueue<T>&& rh)
+BlockingQueue<T>::BlockingQueue(BlockingQueue<T>&& rh) noexcept
     : _mutex(),
       _notEmpty() {
-    std::lock_guard<std::mutex> lk(_mutex);
-    this->_queue = rh._queue;
+    std::lock_guard<std::mutex> lk(rh._mutex);
+    this->_queue = std::move(rh._queue);
+    this->_size.store(this->_queue.size());
+    rh._size.store(rh._queue.size());
+    this->_ring = std::move(rh._ring);
 }
+
 template <typename T>
-BlockingQueue<T>& BlockingQueue<T>::operator=(const BlockingQueue<T>&& rh) {
-    std::lock_guard<std::mutex> lk(_mutex);
-    this->_queue = rh._queue;
+BlockingQueue<T>& BlockingQueue<T>::operator=(BlockingQueue<T>&& rh) {
+    if (this != &rh) {
+        std::lock(_mutex, rh._mutex);
+        std::lock_guard<std::mutex> lk(_mutex, std::adopt_lock);
+        std::lock_guard<std::mutex> rlk(rh._mutex, std::adopt_lock);
+        this->_queue = std::move(rh._queue);
+        this->_size.store(this->_queue.size());
+        rh._size.store(rh._queue.size());
+        this->_ring = std::move(rh._ring);
+    }
+    return *this;
 }
 
 template <typename T>
 BlockingQueue<T>& BlockingQueue<T>::operator=(const BlockingQueue<T> & rh) {
-    std::lock_guard<std::mutex> lk(_mutex);
-    this->_queue = rh._queue;
+    if (this != &rh) {
+        std::lock(_mutex, rh._mutex);
+        std::lock_guard<std::mutex> lk(_mutex, std::adopt_lock);
+        std::lock_guard<std::mutex> rlk(rh._mutex, std::adopt_lock);
+        this->_queue = rh._queue;
+        this->_size.store(this->_queue.size());
+        this->_ring.reset(rh._ring ? new MPMCQueue<T>(*rh._ring) : nullptr);
+    }
+    return *this;
 }
 
 #endif /* BLOCKINGQUEUE_HPP */
@@ -0,0 +1,313 @@
+#ifndef COTASK_HPP
+#define COTASK_HPP
+
+//C++20协程支持,需要-std=c++20;C++11编译时这个头文件为空,其他头文件不受影响
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define THREADPOOL_HAS_COROUTINE 1
+#endif
+#endif
+
+#ifdef THREADPOOL_HAS_COROUTINE
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "threadpoolexecutor.hpp"
+#include "scheduledthreadpoolexecutor.hpp"
+
+template<typename T> class CoTask;
+
+/**
+ * @brief CoTaskPromiseBase CoTask的promise公共部分,
+ *                          结束时直接切换到co_await它的协程(对称转移),不经过线程池
+ */
+struct CoTaskPromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> next = handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    ///CoTask是惰性的,co_await时才开始执行
+    std::suspend_always initial_suspend() const noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept {
+        return {};
+    }
+
+    void unhandled_exception() noexcept {
+        error = std::current_exception();
+    }
+
+    ///co_await这个CoTask的协程
+    std::coroutine_handle<> continuation;
+    std::exception_ptr      error;
+};
+
+template<typename T>
+struct CoTaskPromise : CoTaskPromiseBase {
+    CoTask<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& value) {
+        result.emplace(std::forward<U>(value));
+    }
+
+    T take() {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+template<>
+struct CoTaskPromise<void> : CoTaskPromiseBase {
+    CoTask<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void take() {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+template<typename T = void>
+/**
+ * @brief CoTask 惰性的协程任务,只能移动,析构时销毁协程帧
+ *               co_await时开始执行,结束后直接恢复co_await它的协程,异常在co_await处重新抛出
+ *               在哪个线程执行由协程内部的co_await pool.schedule()决定
+ */
+class CoTask {
+    public:
+        using promise_type = CoTaskPromise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        CoTask() noexcept = default;
+
+        explicit CoTask(handle_type handle) noexcept
+            : handle_(handle) {}
+
+        CoTask(CoTask&& rh) noexcept
+            : handle_(std::exchange(rh.handle_, nullptr)) {}
+
+        CoTask& operator=(CoTask&& rh) noexcept {
+            if (this != &rh) {
+                if (handle_)
+                    handle_.destroy();
+                handle_ = std::exchange(rh.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        ~CoTask() {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        /**
+         * @brief valid 是否关联了协程
+         */
+        bool valid() const noexcept {
+            return static_cast<bool>(handle_);
+        }
+
+        /**
+         * @brief isDone 协程是否已经结束
+         */
+        bool isDone() const noexcept {
+            return !handle_ || handle_.done();
+        }
+
+        struct Awaiter {
+            bool await_ready() const noexcept {
+                return !handle || handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                handle.promise().continuation = caller;
+                return handle;
+            }
+
+            T await_resume() {
+                return handle.promise().take();
+            }
+
+            handle_type handle;
+        };
+
+        /**
+         * @brief operator co_await 开始执行并等待结果
+         */
+        Awaiter operator co_await() && noexcept {
+            return Awaiter{handle_};
+        }
+
+    private:
+        handle_type handle_;
+
+    public:
+        CoTask(const CoTask&) = delete;
+        CoTask& operator=(const CoTask&) = delete;
+};
+
+template<typename T>
+CoTask<T> CoTaskPromise<T>::get_return_object() noexcept {
+    return CoTask<T>(std::coroutine_handle<CoTaskPromise<T>>::from_promise(*this));
+}
+
+inline CoTask<void> CoTaskPromise<void>::get_return_object() noexcept {
+    return CoTask<void>(std::coroutine_handle<CoTaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * @brief DetachedCoroutine 立即开始执行,结束后自己销毁的协程,用于syncWait和spawnDetached
+ */
+struct DetachedCoroutine {
+    struct promise_type {
+        DetachedCoroutine get_return_object() const noexcept {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept {
+            return {};
+        }
+
+        void return_void() const noexcept {}
+
+        void unhandled_exception() const noexcept {
+            std::terminate();
+        }
+    };
+};
+
+/**
+ * @brief SyncWaitState syncWait等待的结果
+ */
+template<typename T>
+struct SyncWaitState {
+    template<typename... U>
+    void finish(U&&... value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        result.emplace(std::forward<U>(value)...);
+        //在锁内通知,等待的线程返回并析构这个对象时协程已经不再访问它
+        cond.notify_all();
+    }
+
+    void fail(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = e;
+        cond.notify_all();
+    }
+
+    T wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return result.has_value() || error != nullptr; });
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*result);
+    }
+
+    std::mutex              mutex;
+    std::condition_variable cond;
+    std::optional<T>        result;
+    std::exception_ptr      error;
+};
+
+template<>
+struct SyncWaitState<void> {
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        cond.notify_all();
+    }
+
+    void fail(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = e;
+        done = true;
+        cond.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return done; });
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    std::mutex              mutex;
+    std::condition_variable cond;
+    bool                    done{false};
+    std::exception_ptr      error;
+};
+
+template<typename T>
+DetachedCoroutine syncWaitStart(CoTask<T> task, SyncWaitState<T>& state) {
+    std::exception_ptr error;
+    try {
+        if constexpr (std::is_void<T>::value) {
+            co_await std::move(task);
+            state.finish();
+        } else {
+            state.finish(co_await std::move(task));
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (error)
+        state.fail(error);
+}
+
+template<typename T>
+/**
+ * @brief syncWait 在普通函数中执行CoTask并阻塞等待结果,不要在线程池的线程内调用
+ *
+ * @param task 要执行的CoTask
+ *
+ * @return 结果,异常时重新抛出
+ */
+T syncWait(CoTask<T> task) {
+    SyncWaitState<T> state;
+    syncWaitStart(std::move(task), state);
+    return state.wait();
+}
+
+inline DetachedCoroutine spawnStart(CoTask<void> task) {
+    co_await std::move(task);
+}
+
+/**
+ * @brief spawnDetached 立即开始执行CoTask,不等待结果,结束后自动销毁协程帧
+ *                      task抛出异常时调用std::terminate
+ *
+ * @param task 要执行的CoTask
+ */
+inline void spawnDetached(CoTask<void> task) {
+    spawnStart(std::move(task));
+}
+
+#endif /* THREADPOOL_HAS_COROUTINE */
+
+#endif /* COTASK_HPP */
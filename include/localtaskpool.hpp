@@ -0,0 +1,109 @@
+#ifndef LOCALTASKPOOL_HPP
+#define LOCALTASKPOOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "task.hpp"
+
+class LocalTaskPool;
+
+/**
+ * @brief LocalTask 本地队列中的任务节点,从压入任务的线程的LocalTaskPool分配
+ */
+struct LocalTask {
+    Task           task;
+    LocalTask*     next{nullptr};
+    ///分配这个节点的池,取走任务后归还到这里
+    LocalTaskPool* pool{nullptr};
+};
+
+/**
+ * @brief LocalTaskPool 每个线程的任务节点缓存,线程内提交的任务压入本地队列时不再分配内存
+ *                      只有所属线程分配节点,所属线程自己取走任务时节点直接放回free_,
+ *                      其他线程窃取后通过returned_无锁栈归还,free_用完时所属线程一次取回整个栈,
+ *                      栈只有所属线程一个弹出者,没有ABA问题
+ *                      节点按块分配,池析构时连同还在队列中的任务一起释放
+ */
+class LocalTaskPool {
+    public:
+        ///每次分配的节点数
+        static constexpr size_t CHUNK_SIZE = 64;
+
+        LocalTaskPool() = default;
+
+        /**
+         * @brief acquire 分配节点并移入任务,只能由所属线程调用
+         *
+         * @param task 任务
+         *
+         * @return 节点
+         */
+        LocalTask* acquire(Task&& task) {
+            LocalTask* node = free_;
+            if (node == nullptr) {
+                node = returned_.exchange(nullptr, std::memory_order_acquire);
+                if (node == nullptr)
+                    node = grow();
+            }
+            free_ = node->next;
+            node->task = std::move(task);
+            return node;
+        }
+
+        /**
+         * @brief take 取出节点中的任务并把节点还给分配它的池
+         *
+         * @param node 从本地队列取出的节点
+         * @param task 任务赋值对象
+         * @param owner 调用者是否是节点所属的线程(从自己的本地队列取出)
+         */
+        static void take(LocalTask* node, Task& task, bool owner) {
+            task = std::move(node->task);
+            LocalTaskPool* pool = node->pool;
+            if (owner) {
+                node->next = pool->free_;
+                pool->free_ = node;
+                return;
+            }
+            LocalTask* head = pool->returned_.load(std::memory_order_relaxed);
+            do {
+                node->next = head;
+            } while (!pool->returned_.compare_exchange_weak(head, node,
+                     std::memory_order_release,
+                     std::memory_order_relaxed));
+        }
+
+    private:
+        /**
+         * @brief grow 分配一块节点,返回链表头
+         */
+        LocalTask* grow() {
+            std::unique_ptr<LocalTask[]> chunk(new LocalTask[CHUNK_SIZE]);
+            for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+                chunk[i].pool = this;
+                chunk[i].next = i + 1 < CHUNK_SIZE ? &chunk[i + 1] : nullptr;
+            }
+            LocalTask* head = chunk.get();
+            chunks_.push_back(std::move(chunk));
+            return head;
+        }
+
+    private:
+        ///所属线程的空闲节点
+        LocalTask*                                free_{nullptr};
+        ///所有分配过的节点块,只有所属线程会修改
+        std::vector<std::unique_ptr<LocalTask[]>> chunks_;
+        ///其他线程归还节点时修改,和所属线程使用的成员放在不同的缓存行
+        char                                      pad0_[64];
+        std::atomic<LocalTask*>                   returned_{nullptr};
+        char                                      pad1_[64];
+
+    public:
+        LocalTaskPool(const LocalTaskPool&) = delete;
+        LocalTaskPool& operator=(const LocalTaskPool&) = delete;
+};
+
+#endif /* LOCALTASKPOOL_HPP */
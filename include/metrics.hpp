@@ -0,0 +1,311 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief metricsNow 统计用的时间戳,steady_clock纳秒
+ */
+inline int64_t metricsNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief HistogramSnapshot LatencyHistogram某一时刻的拷贝,可以合并和计算百分位数
+ */
+struct HistogramSnapshot {
+    ///每个桶的计数,下标含义和LatencyHistogram相同
+    std::vector<uint64_t> counts;
+    ///记录个数
+    uint64_t              count{0};
+    ///所有记录之和(纳秒)
+    uint64_t              sum{0};
+    ///最大值(纳秒)
+    uint64_t              max{0};
+
+    /**
+     * @brief merge 合并另一个快照
+     *
+     * @param rh 另一个快照
+     */
+    void merge(const HistogramSnapshot& rh);
+
+    /**
+     * @brief percentile 百分位数,返回所在桶的上界,误差不超过12.5%
+     *
+     * @param p 0到100
+     *
+     * @return 纳秒
+     */
+    uint64_t percentile(double p) const;
+
+    /**
+     * @brief mean 平均值(纳秒)
+     */
+    double mean() const {
+        return count == 0 ? 0 : static_cast<double>(sum) / count;
+    }
+};
+
+/**
+ * @brief LatencyHistogram HDR风格的对数线性直方图
+ *                         每个2的幂区间分成SUB_BUCKETS个桶,相对误差不超过1/SUB_BUCKETS,
+ *                         只能有一个线程写,写操作只有relaxed的load和store,
+ *                         其他线程可以随时无锁读取快照
+ */
+class LatencyHistogram {
+    public:
+        ///每个2的幂区间的桶数的位数
+        static constexpr int    SUB_BITS    = 3;
+        static constexpr size_t SUB_BUCKETS = 1 << SUB_BITS;
+        ///可以区分的最大值的位数,2^40纳秒约18分钟,更大的值记在最后一个桶
+        static constexpr int    MAX_BITS    = 40;
+        ///桶数
+        static constexpr size_t BUCKETS     = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+        LatencyHistogram() {
+            for (auto& e : counts_) {
+                e.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief bucketOf 值所在的桶
+         */
+        static size_t bucketOf(uint64_t value) {
+            if (value < SUB_BUCKETS)
+                return static_cast<size_t>(value);
+            int msb = 63 - __builtin_clzll(value);
+            size_t sub = static_cast<size_t>(value >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1);
+            size_t index = static_cast<size_t>(msb - SUB_BITS + 1) * SUB_BUCKETS + sub;
+            return index < BUCKETS ? index : BUCKETS - 1;
+        }
+
+        /**
+         * @brief lowerBound 桶的下界
+         */
+        static uint64_t lowerBound(size_t index) {
+            if (index < SUB_BUCKETS)
+                return index;
+            int msb = static_cast<int>(index / SUB_BUCKETS) + SUB_BITS - 1;
+            uint64_t sub = index % SUB_BUCKETS;
+            return (SUB_BUCKETS + sub) << (msb - SUB_BITS);
+        }
+
+        /**
+         * @brief record 记录一个值,只能由所属线程调用
+         *
+         * @param value 纳秒,负数按0记录
+         */
+        void record(int64_t value) {
+            uint64_t v = value > 0 ? static_cast<uint64_t>(value) : 0;
+            increment(counts_[bucketOf(v)], 1);
+            increment(count_, 1);
+            increment(sum_, v);
+            if (v > max_.load(std::memory_order_relaxed))
+                max_.store(v, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief snapshot 无锁读取,和写线程并发时各字段之间可能相差几个记录
+         */
+        HistogramSnapshot snapshot() const {
+            HistogramSnapshot s;
+            s.counts.resize(BUCKETS);
+            for (size_t i = 0; i < BUCKETS; ++i) {
+                s.counts[i] = counts_[i].load(std::memory_order_relaxed);
+            }
+            s.count = count_.load(std::memory_order_relaxed);
+            s.sum = sum_.load(std::memory_order_relaxed);
+            s.max = max_.load(std::memory_order_relaxed);
+            return s;
+        }
+
+    private:
+        /**
+         * @brief increment 单写者计数,不需要原子读改写
+         */
+        static void increment(std::atomic<uint64_t>& counter, uint64_t n) {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> counts_[BUCKETS];
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_{0};
+        std::atomic<uint64_t> max_{0};
+
+    public:
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+};
+
+inline void HistogramSnapshot::merge(const HistogramSnapshot& rh) {
+    if (counts.size() < rh.counts.size())
+        counts.resize(rh.counts.size());
+    for (size_t i = 0; i < rh.counts.size(); ++i) {
+        counts[i] += rh.counts[i];
+    }
+    count += rh.count;
+    sum += rh.sum;
+    if (rh.max > max)
+        max = rh.max;
+}
+
+inline uint64_t HistogramSnapshot::percentile(double p) const {
+    uint64_t total = 0;
+    for (auto e : counts) {
+        total += e;
+    }
+    if (total == 0)
+        return 0;
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t upper = LatencyHistogram::lowerBound(i + 1) - 1;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+/**
+ * @brief WorkerMetrics 每个线程的统计,只由所属线程更新
+ *                      单独分配并在前后填充,不和其他线程的数据共享缓存行
+ */
+struct WorkerMetrics {
+    char                    pad0_[64];
+    ///执行完成的任务数
+    std::atomic<uint64_t>   completed{0};
+    ///压入自己本地队列的任务数,和completed一起计算还没有执行完的任务数
+    std::atomic<uint64_t>   submitted{0};
+    ///从其他线程窃取的任务数
+    std::atomic<uint64_t>   stolen{0};
+    ///任务从提交到开始执行的时间
+    LatencyHistogram        queueWait;
+    ///任务执行时间
+    LatencyHistogram        execution;
+    ///最近排队时间的指数移动平均(纳秒)和最后一次更新的时间,用于准入控制
+    std::atomic<int64_t>    queueDelay{0};
+    std::atomic<int64_t>    queueDelayTime{0};
+    ///正在执行的任务层数,任务内帮忙执行其他任务时大于1,getActiveCount不加锁读取
+    std::atomic<uint32_t>   active{0};
+    char                    pad1_[64];
+
+    /**
+     * @brief increment 单写者计数,其他线程acquire读到新值时也能看到之前的修改
+     */
+    static void increment(std::atomic<uint64_t>& counter, uint64_t count = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    /**
+     * @brief recordQueueDelay 更新排队时间的移动平均,新样本权重1/8
+     *
+     * @param delay 排队时间
+     * @param now 当前时间
+     */
+    void recordQueueDelay(int64_t delay, int64_t now) {
+        int64_t avg = queueDelay.load(std::memory_order_relaxed);
+        queueDelay.store(avg + (delay - avg) / 8, std::memory_order_relaxed);
+        queueDelayTime.store(now, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief WorkerMetricsSnapshot 一个线程的统计快照
+ */
+struct WorkerMetricsSnapshot {
+    uint64_t          completed{0};
+    uint64_t          stolen{0};
+    HistogramSnapshot queueWait;
+    HistogramSnapshot execution;
+};
+
+/**
+ * @brief ExecutorMetrics 线程池的统计快照
+ */
+struct ExecutorMetrics {
+    ///每个线程的统计,下标是线程的队列位置
+    std::vector<WorkerMetricsSnapshot> workers;
+    ///被拒绝的任务数,整个线程池一个计数,不按线程统计:
+    ///被拒绝的任务大多来自线程池外的线程,它们没有自己的位置,而且拒绝时本来就要执行拒绝策略
+    uint64_t                           rejected{0};
+    ///弹性伸缩增加线程和线程空闲退出的次数
+    uint64_t                           grown{0};
+    uint64_t                           shrunk{0};
+
+    /**
+     * @brief completed 所有线程完成的任务数
+     */
+    uint64_t completed() const {
+        uint64_t n = 0;
+        for (auto& e : workers) {
+            n += e.completed;
+        }
+        return n;
+    }
+
+    /**
+     * @brief stolen 所有线程窃取的任务数
+     */
+    uint64_t stolen() const {
+        uint64_t n = 0;
+        for (auto& e : workers) {
+            n += e.stolen;
+        }
+        return n;
+    }
+
+    /**
+     * @brief queueWait 合并所有线程的提交到开始执行时间
+     */
+    HistogramSnapshot queueWait() const {
+        HistogramSnapshot s;
+        for (auto& e : workers) {
+            s.merge(e.queueWait);
+        }
+        return s;
+    }
+
+    /**
+     * @brief execution 合并所有线程的执行时间
+     */
+    HistogramSnapshot execution() const {
+        HistogramSnapshot s;
+        for (auto& e : workers) {
+            s.merge(e.execution);
+        }
+        return s;
+    }
+
+    /**
+     * @brief toString 汇总信息
+     */
+    std::string toString() const {
+        HistogramSnapshot wait = queueWait();
+        HistogramSnapshot exec = execution();
+        std::stringstream ss;
+        ss << "COMPLETED="           << completed()
+           << " STOLEN="             << stolen()
+           << " REJECTED="           << rejected
+           << " GROWN="              << grown
+           << " SHRUNK="             << shrunk
+           << " QUEUE_WAIT_P50_NS="  << wait.percentile(50)
+           << " QUEUE_WAIT_P99_NS="  << wait.percentile(99)
+           << " EXECUTION_P50_NS="   << exec.percentile(50)
+           << " EXECUTION_P99_NS="   << exec.percentile(99);
+        return ss.str();
+    }
+};
+
+#endif /* METRICS_HPP */
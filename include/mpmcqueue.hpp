@@ -0,0 +1,173 @@
+#ifndef MPMCQUEUE_HPP
+#define MPMCQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+template <typename T>
+/**
+ * @brief MPMCQueue 有界无锁多生产者多消费者环形队列
+ *                  容量是2的幂,每个槽位有一个序号,
+ *                  生产者和消费者分别CAS自己的位置,不会互相阻塞
+ *                  所有操作都不会阻塞,队列满或空时返回false
+ */
+class MPMCQueue {
+    private:
+        /**
+         * @brief 槽位,sequence表示槽位当前可以被哪个位置的生产者或消费者使用
+         */
+        struct Cell {
+            std::atomic<size_t>                                               sequence;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type        storage;
+
+            T* value() {
+                return reinterpret_cast<T*>(&storage);
+            }
+        };
+
+    public:
+        /**
+         * @brief MPMCQueue 构造函数
+         *
+         * @param capacity 容量,会向上取整为2的幂
+         */
+        explicit MPMCQueue(size_t capacity) {
+            if (capacity == 0)
+                throw std::logic_error("MPMCQueue capacity must be greater than 0");
+            size_t c = 1;
+            while (c < capacity)
+                c <<= 1;
+            capacity_ = c;
+            mask_ = c - 1;
+            cells_.reset(new Cell[c]);
+            for (size_t i = 0; i < c; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief MPMCQueue 拷贝构造,只能在没有其他线程访问rh时使用
+         *
+         * @param rh 另一个MPMCQueue
+         */
+        MPMCQueue(const MPMCQueue& rh)
+            : MPMCQueue(rh.capacity_) {
+            size_t head = rh.dequeuePos_.load(std::memory_order_relaxed);
+            size_t tail = rh.enqueuePos_.load(std::memory_order_relaxed);
+            for (size_t pos = head; pos != tail; ++pos) {
+                T copy(*rh.cells_[pos & rh.mask_].value());
+                try_push(std::move(copy));
+            }
+        }
+
+        /**
+         * @brief ~MPMCQueue 析构函数,销毁还在队列中的元素
+         */
+        ~MPMCQueue() {
+            size_t head = dequeuePos_.load(std::memory_order_relaxed);
+            size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+            for (size_t pos = head; pos != tail; ++pos) {
+                cells_[pos & mask_].value()->~T();
+            }
+        }
+
+        /**
+         * @brief try_push 插入元素
+         *
+         * @param x 元素,失败时不会被移动
+         *
+         * @return true - 成功,false - 队列满
+         */
+        bool try_push(T&& x) {
+            Cell* cell;
+            size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+            }
+            ::new (static_cast<void*>(&cell->storage)) T(std::move(x));
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief try_pop 弹出元素
+         *
+         * @param x 弹出元素赋值对象
+         *
+         * @return true - 成功,false - 队列空
+         */
+        bool try_pop(T& x) {
+            Cell* cell;
+            size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeuePos_.load(std::memory_order_relaxed);
+                }
+            }
+            T* value = cell->value();
+            x = std::move(*value);
+            value->~T();
+            cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief size 返回元素个数(估计值)
+         *
+         * @return 元素个数
+         */
+        size_t size() const {
+            size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+            size_t head = dequeuePos_.load(std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+
+        /**
+         * @brief capacity 返回容量
+         *
+         * @return 容量
+         */
+        size_t capacity() const {
+            return capacity_;
+        }
+
+    private:
+        size_t                                capacity_;
+        size_t                                mask_;
+        std::unique_ptr<Cell[]>               cells_;
+        ///生产者和消费者的位置放在不同的缓存行,避免伪共享
+        char                                  pad0_[64];
+        std::atomic<size_t>                   enqueuePos_{0};
+        char                                  pad1_[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t>                   dequeuePos_{0};
+        char                                  pad2_[64 - sizeof(std::atomic<size_t>)];
+
+    public:
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+};
+
+#endif /* MPMCQUEUE_HPP */
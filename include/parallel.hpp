@@ -0,0 +1,325 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "workstealingthreadpoolexecutor.hpp"
+
+/**
+ * @brief ForkJoinScope 一次fork/join计算,记录还没有完成的子任务数和第一个异常
+ *                      join时调用线程帮忙执行线程池中的任务,不阻塞
+ */
+class ForkJoinScope {
+    public:
+        explicit ForkJoinScope(WorkStealingThreadPoolExecutor& pool)
+            : pool_(pool) {}
+
+        /**
+         * @brief ~ForkJoinScope 等待所有子任务结束,子任务引用了这个对象
+         */
+        ~ForkJoinScope() {
+            wait();
+        }
+
+        template<typename F>
+        /**
+         * @brief fork 把f交给线程池,在线程池的线程内调用时压入当前线程的双端队列
+         *             线程池不再接受任务时在当前线程执行
+         *
+         * @param f 可以复制的可调用对象,复制的代价应该很小
+         */
+        void fork(const F& f) {
+            pending_.fetch_add(1, std::memory_order_relaxed);
+            ForkJoinScope* self = this;
+            auto job = [self, f] {
+                self->run(f);
+                self->pending_.fetch_sub(1, std::memory_order_release);
+            };
+            bool accepted = false;
+            if (!pool_.isShutDown() && !pool_.isTerminated()) {
+                try {
+                    accepted = pool_.execute(Task(job));
+                } catch (...) {
+                    accepted = false;
+                }
+            }
+            if (!accepted)
+                job();
+        }
+
+        template<typename F>
+        /**
+         * @brief run 在当前线程执行f,异常被记录,之后的子任务不再执行
+         */
+        void run(const F& f) {
+            if (isCancelled())
+                return;
+            try {
+                f();
+            } catch (...) {
+                fail(std::current_exception());
+            }
+        }
+
+        /**
+         * @brief join 等待所有子任务结束,等待时执行线程池中的任务,有异常时重新抛出第一个异常
+         */
+        void join() {
+            wait();
+            if (error_)
+                std::rethrow_exception(error_);
+        }
+
+        /**
+         * @brief isCancelled 是否已经有子任务抛出异常
+         */
+        bool isCancelled() const {
+            return cancelled_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief getPool 执行子任务的线程池
+         */
+        WorkStealingThreadPoolExecutor& getPool() const {
+            return pool_;
+        }
+
+    private:
+        void fail(std::exception_ptr error) {
+            if (!failed_.test_and_set())
+                error_ = error;
+            cancelled_.store(true, std::memory_order_relaxed);
+        }
+
+        void wait() {
+            while (pending_.load(std::memory_order_acquire) != 0) {
+                if (!pool_.tryExecuteOne())
+                    std::this_thread::yield();
+            }
+        }
+
+    private:
+        WorkStealingThreadPoolExecutor& pool_;
+        ///还没有完成的子任务数
+        std::atomic<size_t>             pending_{0};
+        std::atomic<bool>               cancelled_{false};
+        std::atomic_flag                failed_ = ATOMIC_FLAG_INIT;
+        ///第一个异常,failed_设置后只写一次,join时读取
+        std::exception_ptr              error_;
+};
+
+/**
+ * @brief ChunkSplitter 把块区间[first, last)对半分开,右半部分交给线程池,
+ *                      自己继续分左半部分,直到只剩一个块时执行leaf(块下标)
+ *                      线程自己的双端队列后进先出,空闲线程窃取到的是最早分出的较大的一半
+ */
+template<typename Leaf>
+struct ChunkSplitter {
+    void operator()(size_t first, size_t last) const {
+        while (last - first > 1 && !scope->isCancelled()) {
+            size_t mid = first + (last - first) / 2;
+            ChunkSplitter self = *this;
+            scope->fork([self, mid, last] { self(mid, last); });
+            last = mid;
+        }
+        if (!scope->isCancelled())
+            (*leaf)(first);
+    }
+
+    ForkJoinScope* scope;
+    const Leaf*    leaf;
+};
+
+/**
+ * @brief forkJoinChunks 对块[0, chunks)执行leaf,调用线程执行第一个块并帮忙执行其他任务
+ */
+template<typename Leaf>
+void forkJoinChunks(WorkStealingThreadPoolExecutor& pool, size_t chunks, const Leaf& leaf) {
+    if (chunks == 0)
+        return;
+    ForkJoinScope scope(pool);
+    ChunkSplitter<Leaf> splitter{&scope, &leaf};
+    scope.run([&splitter, chunks] { splitter(0, chunks); });
+    scope.join();
+}
+
+/**
+ * @brief chunkGrain 每块的元素个数,grain不大于0时每个核心线程大约分到8块
+ */
+template<typename Index>
+size_t chunkGrain(const WorkStealingThreadPoolExecutor& pool, size_t count, Index grain) {
+    if (grain > 0)
+        return static_cast<size_t>(grain);
+    size_t workers = static_cast<size_t>(std::max(1, pool.getCorePoolSize()));
+    return std::max<size_t>(1, count / (workers * 8));
+}
+
+template<typename Index, typename F>
+/**
+ * @brief parallelFor 对[begin, end)中的每个i执行f(i),
+ *                    区间按grain分块后递归对半拆分,空闲线程窃取一半区间,
+ *                    每块只有一个任务,调用线程也参与计算
+ *                    f抛出异常时剩下的块不再执行,所有已经开始的块结束后重新抛出第一个异常
+ *
+ * @param pool 线程池
+ * @param begin 起始下标
+ * @param end 结束下标(不包含)
+ * @param grain 每块的元素个数,不大于0时自动选择
+ * @param f 参数是下标,不同的i可能同时在不同线程执行
+ */
+void parallelFor(WorkStealingThreadPoolExecutor& pool, Index begin, Index end, Index grain, F f) {
+    static_assert(std::is_integral<Index>::value, "parallelFor needs an integral index");
+    if (!(begin < end))
+        return;
+    size_t count = static_cast<size_t>(end - begin);
+    size_t step = chunkGrain(pool, count, grain);
+    auto leaf = [&f, begin, count, step](size_t chunk) {
+        Index first = static_cast<Index>(begin + static_cast<Index>(chunk * step));
+        Index last = static_cast<Index>(begin + static_cast<Index>(std::min(count, (chunk + 1) * step)));
+        for (Index i = first; i < last; ++i) {
+            f(i);
+        }
+    };
+    forkJoinChunks(pool, (count + step - 1) / step, leaf);
+}
+
+/**
+ * @brief ReduceSlot 每块的部分结果,避免std::vector<bool>相邻元素共享存储
+ */
+template<typename T>
+struct ReduceSlot {
+    T value;
+};
+
+template<typename Index, typename T, typename Map, typename Reduce>
+/**
+ * @brief parallelReduce 计算reduce(...reduce(reduce(identity, map(begin)), map(begin + 1))..., map(end - 1)),
+ *                       分块方式和parallelFor相同,每块先在块内归约,
+ *                       最后调用线程按块的顺序归约,reduce只需要满足结合律
+ *
+ * @param pool 线程池
+ * @param begin 起始下标
+ * @param end 结束下标(不包含)
+ * @param grain 每块的元素个数,不大于0时自动选择
+ * @param identity reduce的单位元,每块从它开始归约
+ * @param map 参数是下标,返回值可以转换为T
+ * @param reduce 参数是两个T,返回T
+ *
+ * @return 归约结果,区间为空时返回identity
+ */
+T parallelReduce(WorkStealingThreadPoolExecutor& pool, Index begin, Index end, Index grain,
+                 T identity, Map map, Reduce reduce) {
+    static_assert(std::is_integral<Index>::value, "parallelReduce needs an integral index");
+    if (!(begin < end))
+        return identity;
+    size_t count = static_cast<size_t>(end - begin);
+    size_t step = chunkGrain(pool, count, grain);
+    size_t chunks = (count + step - 1) / step;
+    std::vector<ReduceSlot<T>> partial(chunks, ReduceSlot<T> {identity});
+    auto leaf = [&](size_t chunk) {
+        Index first = static_cast<Index>(begin + static_cast<Index>(chunk * step));
+        Index last = static_cast<Index>(begin + static_cast<Index>(std::min(count, (chunk + 1) * step)));
+        T acc = identity;
+        for (Index i = first; i < last; ++i) {
+            acc = reduce(std::move(acc), map(i));
+        }
+        partial[chunk].value = std::move(acc);
+    };
+    forkJoinChunks(pool, chunks, leaf);
+    T res = std::move(identity);
+    for (auto& e : partial) {
+        res = reduce(std::move(res), std::move(e.value));
+    }
+    return res;
+}
+
+/**
+ * @brief SortSplitter 并行快速排序,三数取中后三路划分,大于基准的部分交给线程池,
+ *                     自己继续排序小于基准的部分,不超过cutoff个元素或递归过深时使用std::sort
+ */
+template<typename RandomIt, typename Compare>
+struct SortSplitter {
+    void operator()(RandomIt first, RandomIt last, int depth) const {
+        using value_type = typename std::iterator_traits<RandomIt>::value_type;
+        while (last - first > cutoff && depth > 0 && !scope->isCancelled()) {
+            --depth;
+            RandomIt mid = first + (last - first) / 2;
+            RandomIt back = last - 1;
+            //三数取中,基准放在first,划分时不需要复制基准
+            if ((*comp)(*mid, *first))
+                std::iter_swap(mid, first);
+            if ((*comp)(*back, *mid))
+                std::iter_swap(back, mid);
+            if ((*comp)(*mid, *first))
+                std::iter_swap(mid, first);
+            std::iter_swap(first, mid);
+            const Compare& c = *comp;
+            RandomIt lt = std::partition(first + 1, last, [&c, first](const value_type& x) {
+                return c(x, *first);
+            });
+            std::iter_swap(first, lt - 1);
+            RandomIt pivot = lt - 1;
+            RandomIt gt = std::partition(lt, last, [&c, pivot](const value_type& x) {
+                return !c(*pivot, x);
+            });
+            //[first, pivot)小于基准,[pivot, gt)等于基准,[gt, last)大于基准
+            SortSplitter self = *this;
+            if (last - gt > 1)
+                scope->fork([self, gt, last, depth] { self(gt, last, depth); });
+            last = pivot;
+        }
+        if (!scope->isCancelled() && last - first > 1)
+            std::sort(first, last, *comp);
+    }
+
+    ForkJoinScope*                                              scope;
+    const Compare*                                              comp;
+    typename std::iterator_traits<RandomIt>::difference_type    cutoff;
+};
+
+template<typename RandomIt, typename Compare>
+/**
+ * @brief parallelSort 并行排序,不稳定,调用线程也参与排序
+ *                     comp抛出异常时重新抛出第一个异常,区间内元素的顺序不确定
+ *
+ * @param pool 线程池
+ * @param first 起始迭代器
+ * @param last 结束迭代器
+ * @param comp 比较函数,可能同时在不同线程调用
+ */
+void parallelSort(WorkStealingThreadPoolExecutor& pool, RandomIt first, RandomIt last, Compare comp) {
+    using difference_type = typename std::iterator_traits<RandomIt>::difference_type;
+    difference_type count = last - first;
+    size_t workers = static_cast<size_t>(std::max(1, pool.getCorePoolSize()));
+    difference_type cutoff = std::max<difference_type>(2048, count / static_cast<difference_type>(workers * 16));
+    if (count <= cutoff) {
+        std::sort(first, last, comp);
+        return;
+    }
+    int depth = 0;
+    for (difference_type n = count; n > 1; n >>= 1) {
+        depth += 2;
+    }
+    ForkJoinScope scope(pool);
+    SortSplitter<RandomIt, Compare> splitter{&scope, &comp, cutoff};
+    scope.run([&splitter, first, last, depth] { splitter(first, last, depth); });
+    scope.join();
+}
+
+template<typename RandomIt>
+/**
+ * @brief parallelSort 按operator<并行排序
+ */
+void parallelSort(WorkStealingThreadPoolExecutor& pool, RandomIt first, RandomIt last) {
+    parallelSort(pool, first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+#endif /* PARALLEL_HPP */
@@ -0,0 +1,197 @@
+#ifndef PARKER_HPP
+#define PARKER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "semaphore.hpp"
+
+/**
+ * @brief cpuRelax 自旋等待时提示CPU,降低功耗并让出超线程的执行资源
+ */
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief IdleStrategy 线程没有任务时的等待策略:先自旋,再yield,最后休眠
+ *                     默认不自旋也不yield,直接休眠
+ */
+struct IdleStrategy {
+    ///最长自旋时间,0表示不自旋
+    std::chrono::nanoseconds maxSpin{0};
+    ///自旋之后sched_yield的次数
+    unsigned                 yields{0};
+    ///是否根据最近的任务到达间隔调整自旋时间:
+    ///间隔比maxSpin长时不自旋,否则自旋两倍的平均间隔
+    bool                     adaptive{true};
+};
+
+/**
+ * @brief Parker 单个线程的休眠和唤醒,基于Semaphore
+ *               线程休眠前先标记自己,再检查一次条件;
+ *               unpark只在线程确实标记了休眠时post,每次休眠最多被post一次,
+ *               不会丢失唤醒,也不会唤醒没有休眠的线程
+ */
+class Parker {
+    public:
+        Parker() = default;
+
+        template<typename Predicate>
+        /**
+         * @brief spinWait 休眠前按IdleStrategy自旋和yield等待条件满足,只能由所属线程调用
+         *                 返回false后应该调用park,park会记录这次空闲的时间
+         *
+         * @param ready 等待的条件
+         * @param strategy 等待策略
+         *
+         * @return true - 条件已经满足
+         */
+        bool spinWait(Predicate ready, const IdleStrategy& strategy) {
+            if (strategy.maxSpin.count() <= 0 && strategy.yields == 0)
+                return false;
+            idleStart_ = now();
+            int64_t budget = strategy.maxSpin.count();
+            if (strategy.adaptive && avgIdle_ >= 0)
+                budget = avgIdle_ > budget ? 0 : std::min(budget, 2 * avgIdle_);
+            for (unsigned i = 0; budget > 0; ++i) {
+                if (ready()) {
+                    recordIdle();
+                    return true;
+                }
+                cpuRelax();
+                //每64次检查一次时间,减少读时钟的开销
+                if ((i & 63) == 63 && now() - idleStart_ >= budget)
+                    break;
+            }
+            for (unsigned i = 0; i < strategy.yields; ++i) {
+                if (ready()) {
+                    recordIdle();
+                    return true;
+                }
+                std::this_thread::yield();
+            }
+            return false;
+        }
+
+        template<typename Predicate>
+        /**
+         * @brief park 条件不满足时休眠,直到被unpark
+         *             被唤醒后条件不一定满足,调用者需要重新检查
+         *
+         * @param ready 休眠前检查的条件,返回true时不休眠
+         */
+        void park(Predicate ready) {
+            parked_.store(true, std::memory_order_relaxed);
+            //和unpark中的fence配对,要么这里看到新任务,要么unpark看到parked_
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                if (parked_.exchange(false))
+                    return;
+                //unpark已经取走了标记并且会post,需要消耗掉这次post
+            }
+            while (sem_.wait() != 0 && errno == EINTR) {}
+            if (idleStart_ != 0)
+                recordIdle();
+        }
+
+        template<typename Predicate>
+        /**
+         * @brief parkFor 和park相同,但最多休眠timeout
+         *
+         * @param ready 休眠前检查的条件,返回true时不休眠
+         * @param timeout 最长休眠时间
+         *
+         * @return false - 超时,没有被unpark
+         */
+        bool parkFor(Predicate ready, const std::chrono::nanoseconds& timeout) {
+            parked_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool woken = true;
+            if (ready()) {
+                if (parked_.exchange(false))
+                    return true;
+                while (sem_.wait() != 0 && errno == EINTR) {}
+            } else if (sem_.waitFor(timeout) != 0) {
+                //超时后自己取走标记;取不到说明unpark已经取走并且会post,需要消耗掉这次post
+                woken = !parked_.exchange(false);
+                if (woken) {
+                    while (sem_.wait() != 0 && errno == EINTR) {}
+                }
+            }
+            if (idleStart_ != 0)
+                recordIdle();
+            return woken;
+        }
+
+        /**
+         * @brief unpark 唤醒休眠的线程
+         *
+         * @return true - 线程正在休眠并被唤醒
+         */
+        bool unpark() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!parked_.load(std::memory_order_relaxed))
+                return false;
+            if (!parked_.exchange(false))
+                return false;
+            sem_.post();
+            return true;
+        }
+
+        /**
+         * @brief isParked 线程是否正在休眠(估计值)
+         *
+         * @return true - 正在休眠
+         */
+        bool isParked() const {
+            return parked_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief averageIdle 最近空闲时间的平均值(纳秒),-1表示还没有记录
+         */
+        int64_t averageIdle() const {
+            return avgIdle_;
+        }
+
+    private:
+        static int64_t now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * @brief recordIdle 用指数移动平均记录从开始空闲到条件满足的时间
+         */
+        void recordIdle() {
+            int64_t idle = now() - idleStart_;
+            avgIdle_ = avgIdle_ < 0 ? idle : avgIdle_ + (idle - avgIdle_) / 8;
+            idleStart_ = 0;
+        }
+
+    private:
+        ///每个线程一个Parker,单独分配并在前后填充,不和其他线程的Parker共享缓存行
+        char                     pad0_[64];
+        Semaphore                sem_;
+        std::atomic<bool>        parked_{false};
+        ///本次空闲开始的时间,0表示没有在计时,只由所属线程访问
+        int64_t                  idleStart_{0};
+        ///最近空闲时间的平均值,只由所属线程访问
+        int64_t                  avgIdle_{-1};
+        char                     pad1_[64];
+
+    public:
+        Parker(const Parker&) = delete;
+        Parker& operator=(const Parker&) = delete;
+};
+
+#endif /* PARKER_HPP */
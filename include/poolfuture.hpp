@@ -0,0 +1,536 @@
+#ifndef POOLFUTURE_HPP
+#define POOLFUTURE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "task.hpp"
+#include "threadpoolexecutor.hpp"
+
+template<typename T> class PoolFuture;
+template<typename T> class PoolPromise;
+
+/**
+ * @brief FutureValue PoolFuture的结果存储,void特化不存储任何值
+ */
+template<typename T>
+struct FutureValue {
+    using result_type = const T&;
+
+    FutureValue() = default;
+
+    ~FutureValue() {
+        if (has_)
+            reinterpret_cast<T*>(&storage_)->~T();
+    }
+
+    template<typename U>
+    void set(U&& value) {
+        ::new (static_cast<void*>(&storage_)) T(std::forward<U>(value));
+        has_ = true;
+    }
+
+    const T& get() const {
+        return *reinterpret_cast<const T*>(&storage_);
+    }
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+    bool                                                       has_{false};
+
+    FutureValue(const FutureValue&) = delete;
+    FutureValue& operator=(const FutureValue&) = delete;
+};
+
+template<>
+struct FutureValue<void> {
+    using result_type = void;
+
+    void set() {}
+
+    void get() const {}
+};
+
+/**
+ * @brief FutureState PoolPromise和PoolFuture共享的状态
+ *                    完成前注册的回调在完成的线程内依次执行,完成后注册的回调立即执行
+ */
+template<typename T>
+struct FutureState {
+    explicit FutureState(ThreadPoolExecutor* e)
+        : executor(e) {}
+
+    template<typename Setter>
+    /**
+     * @brief complete 设置结果并执行回调
+     *
+     * @param set 在锁内设置value或error
+     *
+     * @return false - 已经有结果
+     */
+    bool complete(Setter set) {
+        std::vector<Task> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready.load(std::memory_order_relaxed))
+                return false;
+            set();
+            ready.store(true, std::memory_order_release);
+            pending.swap(callbacks);
+        }
+        readyCond.notify_all();
+        for (auto& e : pending) {
+            e();
+        }
+        return true;
+    }
+
+    /**
+     * @brief onReady 完成时执行callback,已经完成时在当前线程立即执行
+     */
+    void onReady(Task&& callback) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ready.load(std::memory_order_relaxed)) {
+                callbacks.push_back(std::move(callback));
+                return;
+            }
+        }
+        callback();
+    }
+
+    /**
+     * @brief wait 阻塞直到完成
+     */
+    void wait() {
+        if (ready.load(std::memory_order_acquire))
+            return;
+        std::unique_lock<std::mutex> lock(mutex);
+        readyCond.wait(lock, [this] { return ready.load(std::memory_order_relaxed); });
+    }
+
+    std::mutex                      mutex;
+    std::condition_variable         readyCond;
+    std::atomic<bool>               ready{false};
+    FutureValue<T>                  value;
+    std::exception_ptr              error;
+    std::vector<Task>               callbacks;
+    ///执行then回调的线程池,为nullptr时在完成的线程内执行
+    ThreadPoolExecutor*             executor;
+};
+
+/**
+ * @brief OnceTask 只执行一次的任务,线程池拒绝后可以在当前线程执行,不会重复执行
+ */
+struct OnceTask {
+    explicit OnceTask(Task&& t)
+        : task(std::move(t)) {}
+
+    void run() {
+        if (!done.test_and_set())
+            task();
+    }
+
+    Task             task;
+    std::atomic_flag done = ATOMIC_FLAG_INIT;
+};
+
+/**
+ * @brief dispatchOnce 把任务交给线程池执行,线程池为nullptr,已经关闭或拒绝时在当前线程执行
+ */
+inline void dispatchOnce(ThreadPoolExecutor* executor, const std::shared_ptr<OnceTask>& job) {
+    if (executor == nullptr || executor->isShutDown() || executor->isTerminated()) {
+        job->run();
+        return;
+    }
+    try {
+        if (!executor->execute(Task([job] { job->run(); })))
+            job->run();
+    } catch (...) {
+        job->run();
+    }
+}
+
+/**
+ * @brief ThenResult then回调的返回类型,回调的参数是前一个结果的const引用,void时没有参数
+ */
+template<typename F, typename T>
+struct ThenResult {
+    using type = typename std::result_of<F(const T&)>::type;
+};
+
+template<typename F>
+struct ThenResult<F, void> {
+    using type = typename std::result_of<F()>::type;
+};
+
+/**
+ * @brief PromiseGuard 最后一个PoolPromise副本析构时如果还没有结果,设置broken_promise
+ */
+template<typename T>
+struct PromiseGuard {
+    explicit PromiseGuard(const std::shared_ptr<FutureState<T>>& s)
+        : state(s) {}
+
+    ~PromiseGuard() {
+        std::shared_ptr<FutureState<T>> s = state;
+        s->complete([&s] {
+            s->error = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+        });
+    }
+
+    std::shared_ptr<FutureState<T>> state;
+};
+
+template<typename T>
+/**
+ * @brief PoolPromise PoolFuture的生产者,可以复制,所有副本共享同一个结果
+ */
+class PoolPromise {
+    public:
+        /**
+         * @brief PoolPromise 构造函数
+         *
+         * @param executor 执行then回调的线程池,为nullptr时在设置结果的线程内执行
+         */
+        explicit PoolPromise(ThreadPoolExecutor* executor = nullptr)
+            : state_(std::make_shared<FutureState<T>>(executor)),
+              guard_(std::make_shared<PromiseGuard<T>>(state_)) {}
+
+        /**
+         * @brief getFuture 得到关联的PoolFuture
+         */
+        PoolFuture<T> getFuture() const {
+            return PoolFuture<T>(state_);
+        }
+
+        template<typename... U>
+        /**
+         * @brief trySetValue 设置结果,唤醒等待的线程并执行回调
+         *
+         * @param value 结果,void时没有参数
+         *
+         * @return false - 已经有结果
+         */
+        bool trySetValue(U&&... value) {
+            FutureState<T>* s = state_.get();
+            return s->complete([&] { s->value.set(std::forward<U>(value)...); });
+        }
+
+        template<typename... U>
+        /**
+         * @brief setValue 设置结果,已经有结果时抛出异常
+         */
+        void setValue(U&&... value) {
+            if (!trySetValue(std::forward<U>(value)...))
+                throw std::logic_error("promise already satisfied");
+        }
+
+        /**
+         * @brief trySetException 设置异常
+         *
+         * @return false - 已经有结果
+         */
+        bool trySetException(std::exception_ptr error) {
+            FutureState<T>* s = state_.get();
+            return s->complete([&] { s->error = error; });
+        }
+
+        /**
+         * @brief setException 设置异常,已经有结果时抛出异常
+         */
+        void setException(std::exception_ptr error) {
+            if (!trySetException(error))
+                throw std::logic_error("promise already satisfied");
+        }
+
+    private:
+        std::shared_ptr<FutureState<T>>  state_;
+        std::shared_ptr<PromiseGuard<T>> guard_;
+};
+
+/**
+ * @brief FulfilPromise 执行g并把结果或异常交给promise
+ */
+template<typename R>
+struct FulfilPromise {
+    template<typename G>
+    static void apply(PoolPromise<R>& promise, G& g) {
+        try {
+            promise.trySetValue(g());
+        } catch (...) {
+            promise.trySetException(std::current_exception());
+        }
+    }
+};
+
+template<>
+struct FulfilPromise<void> {
+    template<typename G>
+    static void apply(PoolPromise<void>& promise, G& g) {
+        try {
+            g();
+            promise.trySetValue();
+        } catch (...) {
+            promise.trySetException(std::current_exception());
+        }
+    }
+};
+
+/**
+ * @brief ApplyValue 用前一个结果调用then回调
+ */
+template<typename T>
+struct ApplyValue {
+    template<typename F>
+    static auto call(F& f, FutureState<T>& state) -> decltype(f(state.value.get())) {
+        return f(state.value.get());
+    }
+};
+
+template<>
+struct ApplyValue<void> {
+    template<typename F>
+    static auto call(F& f, FutureState<void>&) -> decltype(f()) {
+        return f();
+    }
+};
+
+/**
+ * @brief ThenCallback then注册的回调,前一个结果是异常时直接传递异常
+ */
+template<typename F, typename T, typename R>
+struct ThenCallback {
+    void operator()() {
+        if (state->error) {
+            promise.trySetException(state->error);
+            return;
+        }
+        auto g = [this]() -> R { return ApplyValue<T>::call(f, *state); };
+        FulfilPromise<R>::apply(promise, g);
+    }
+
+    std::shared_ptr<FutureState<T>> state;
+    PoolPromise<R>                  promise;
+    F                               f;
+};
+
+template<typename T>
+/**
+ * @brief PoolFuture 可以注册后续操作的future,类似std::shared_future,可以复制
+ *                   then的回调在结果到达后交给所属的线程池执行,不需要阻塞线程等待
+ */
+class PoolFuture {
+    public:
+        PoolFuture() = default;
+
+        /**
+         * @brief valid 是否关联了PoolPromise
+         */
+        bool valid() const {
+            return state_ != nullptr;
+        }
+
+        /**
+         * @brief isReady 是否已经有结果
+         */
+        bool isReady() const {
+            return state_->ready.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief wait 阻塞直到有结果,在线程池的线程内调用可能死锁,应该使用then
+         */
+        void wait() const {
+            state_->wait();
+        }
+
+        /**
+         * @brief get 阻塞直到有结果,结果是异常时重新抛出
+         *
+         * @return 结果的const引用,void时没有返回值
+         */
+        typename FutureValue<T>::result_type get() const {
+            state_->wait();
+            if (state_->error)
+                std::rethrow_exception(state_->error);
+            return state_->value.get();
+        }
+
+        /**
+         * @brief getExecutor 执行then回调的线程池
+         */
+        ThreadPoolExecutor* getExecutor() const {
+            return state_->executor;
+        }
+
+        template<typename F>
+        /**
+         * @brief then 结果到达后在所属线程池执行f,前一个结果是异常时不执行f,异常传递给返回的PoolFuture
+         *
+         * @param f 参数是前一个结果的const引用(void时没有参数)
+         *
+         * @return f的结果的PoolFuture
+         */
+        PoolFuture<typename ThenResult<F, T>::type> then(F f) const {
+            using R = typename ThenResult<F, T>::type;
+            ThreadPoolExecutor* executor = state_->executor;
+            PoolPromise<R> promise(executor);
+            PoolFuture<R> next = promise.getFuture();
+            std::shared_ptr<OnceTask> job = std::make_shared<OnceTask>(
+                Task(ThenCallback<F, T, R> {state_, std::move(promise), std::move(f)}));
+            state_->onReady(Task([executor, job] { dispatchOnce(executor, job); }));
+            return next;
+        }
+
+        /**
+         * @brief onReady 有结果时在完成的线程内执行callback,已经完成时立即执行
+         *                只适合很短的操作,一般使用then
+         */
+        void onReady(Task&& callback) const {
+            state_->onReady(std::move(callback));
+        }
+
+        /**
+         * @brief error 结果的异常,没有异常或还没有结果时为nullptr
+         */
+        std::exception_ptr error() const {
+            return isReady() ? state_->error : nullptr;
+        }
+
+    private:
+        explicit PoolFuture(const std::shared_ptr<FutureState<T>>& state)
+            : state_(state) {}
+
+        friend class PoolPromise<T>;
+        template<typename U> friend struct CollectAll;
+
+        std::shared_ptr<FutureState<T>> state_;
+};
+
+/**
+ * @brief SubmitJob submitAsync提交的任务
+ */
+template<typename F, typename R>
+struct SubmitJob {
+    void operator()() {
+        FulfilPromise<R>::apply(promise, f);
+    }
+
+    PoolPromise<R> promise;
+    F              f;
+};
+
+template<typename F>
+/**
+ * @brief submitAsync 向线程池提交任务,返回可以注册后续操作的PoolFuture,
+ *                    后续操作也在这个线程池执行
+ *                    线程池拒绝时按拒绝策略处理,默认抛出异常
+ *
+ * @param executor 线程池
+ * @param f 要提交的任务
+ *
+ * @return 任务结果的PoolFuture
+ */
+PoolFuture<typename std::result_of<F()>::type> submitAsync(ThreadPoolExecutor& executor, F f) {
+    using R = typename std::result_of<F()>::type;
+    PoolPromise<R> promise(&executor);
+    PoolFuture<R> future = promise.getFuture();
+    executor.execute(Task(SubmitJob<F, R> {std::move(promise), std::move(f)}));
+    return future;
+}
+
+/**
+ * @brief CollectAll whenAll在所有PoolFuture完成后收集结果,第一个异常作为整体的异常
+ */
+template<typename T>
+struct CollectAll {
+    using type = std::vector<T>;
+
+    static void collect(const std::vector<PoolFuture<T>>& futures, PoolPromise<type>& promise) {
+        std::vector<T> res;
+        res.reserve(futures.size());
+        for (auto& e : futures) {
+            if (e.state_->error) {
+                promise.trySetException(e.state_->error);
+                return;
+            }
+            res.push_back(e.state_->value.get());
+        }
+        promise.trySetValue(std::move(res));
+    }
+};
+
+template<>
+struct CollectAll<void> {
+    using type = void;
+
+    static void collect(const std::vector<PoolFuture<void>>& futures, PoolPromise<void>& promise) {
+        for (auto& e : futures) {
+            if (e.state_->error) {
+                promise.trySetException(e.state_->error);
+                return;
+            }
+        }
+        promise.trySetValue();
+    }
+};
+
+template<typename T>
+/**
+ * @brief whenAll 所有PoolFuture都完成后完成,不阻塞任何线程
+ *
+ * @param futures 要等待的PoolFuture
+ *
+ * @return 按顺序排列的结果(void时没有结果),任何一个是异常时为第一个异常
+ */
+PoolFuture<typename CollectAll<T>::type> whenAll(const std::vector<PoolFuture<T>>& futures) {
+    using R = typename CollectAll<T>::type;
+    ThreadPoolExecutor* executor = futures.empty() ? nullptr : futures.front().getExecutor();
+    PoolPromise<R> promise(executor);
+    PoolFuture<R> res = promise.getFuture();
+    if (futures.empty()) {
+        CollectAll<T>::collect(futures, promise);
+        return res;
+    }
+    auto remaining = std::make_shared<std::atomic<size_t>>(futures.size());
+    auto all = std::make_shared<std::vector<PoolFuture<T>>>(futures);
+    for (auto& e : futures) {
+        e.onReady(Task([remaining, all, promise]() mutable {
+            if (remaining->fetch_sub(1) == 1)
+                CollectAll<T>::collect(*all, promise);
+        }));
+    }
+    return res;
+}
+
+template<typename T>
+/**
+ * @brief whenAny 任何一个PoolFuture完成后完成
+ *
+ * @param futures 要等待的PoolFuture,不能为空
+ *
+ * @return 第一个完成的PoolFuture的下标
+ */
+PoolFuture<size_t> whenAny(const std::vector<PoolFuture<T>>& futures) {
+    if (futures.empty())
+        throw std::logic_error("whenAny needs at least one future");
+    PoolPromise<size_t> promise(futures.front().getExecutor());
+    PoolFuture<size_t> res = promise.getFuture();
+    for (size_t i = 0; i < futures.size(); ++i) {
+        futures[i].onReady(Task([promise, i]() mutable {
+            promise.trySetValue(i);
+        }));
+    }
+    return res;
+}
+
+#endif /* POOLFUTURE_HPP */
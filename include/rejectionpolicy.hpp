@@ -0,0 +1,148 @@
+#ifndef REJECTIONPOLICY_HPP
+#define REJECTIONPOLICY_HPP
+
+#include <chrono>
+
+#include "threadpoolexecutor.hpp"
+
+/**
+ * @brief CallerRunsPolicy 在提交任务的线程中直接执行被拒绝的任务,线程池不在运行时丢弃
+ *                         提交者被拖慢,自然形成背压
+ */
+class CallerRunsPolicy : public RejectedExecutionHandler {
+    public:
+        using RejectedExecutionHandler::rejectedExecution;
+
+        virtual bool rejectedExecution(Task& task, ThreadPoolExecutor& executor) override {
+            if (!executor.isRunning())
+                return false;
+            task();
+            return true;
+        }
+
+        virtual RejectedExecutionHandler* clone() const override {
+            return new CallerRunsPolicy(*this);
+        }
+};
+
+/**
+ * @brief DiscardPolicy 丢弃被拒绝的任务,submit返回的future得到broken_promise
+ */
+class DiscardPolicy : public RejectedExecutionHandler {
+    public:
+        using RejectedExecutionHandler::rejectedExecution;
+
+        virtual bool rejectedExecution(Task& task, ThreadPoolExecutor&) override {
+            task.reset();
+            return false;
+        }
+
+        virtual RejectedExecutionHandler* clone() const override {
+            return new DiscardPolicy(*this);
+        }
+};
+
+/**
+ * @brief DiscardOldestPolicy 丢弃最早排队的任务,再放入被拒绝的任务,
+ *                            没有可以丢弃的排队任务或线程池不在运行时丢弃被拒绝的任务
+ */
+class DiscardOldestPolicy : public RejectedExecutionHandler {
+    public:
+        using RejectedExecutionHandler::rejectedExecution;
+
+        virtual bool rejectedExecution(Task& task, ThreadPoolExecutor& executor) override {
+            //其他提交者可能抢走刚空出的位置,有限次重试
+            for (int i = 0; i < 4 && executor.isRunning(); ++i) {
+                if (!executor.discardOldestTask())
+                    break;
+                if (executor.offer(std::move(task)))
+                    return true;
+            }
+            task.reset();
+            return false;
+        }
+
+        virtual RejectedExecutionHandler* clone() const override {
+            return new DiscardOldestPolicy(*this);
+        }
+};
+
+/**
+ * @brief BlockPolicy 阻塞提交者直到有空位,超时后按fallback处理(默认抛出异常)
+ *                    不要在线程池的线程内提交,所有线程都阻塞时没有任务能够完成
+ */
+class BlockPolicy : public RejectedExecutionHandler {
+    public:
+        /**
+         * @brief BlockPolicy 构造函数
+         *
+         * @param timeout 最长等待时间
+         * @param throwOnTimeout true - 超时抛出std::runtime_error, false - 超时丢弃
+         */
+        explicit BlockPolicy(const std::chrono::nanoseconds& timeout, bool throwOnTimeout = true)
+            : timeout_(timeout),
+              throwOnTimeout_(throwOnTimeout) {}
+
+        using RejectedExecutionHandler::rejectedExecution;
+
+        virtual bool rejectedExecution(Task& task, ThreadPoolExecutor& executor) override {
+            if (!executor.isRunning())
+                return RejectedExecutionHandler::rejectedExecution(task, executor);
+            if (executor.offer(std::move(task), timeout_))
+                return true;
+            if (throwOnTimeout_)
+                throw std::runtime_error("thread pool task capacity reached, wait timed out");
+            task.reset();
+            return false;
+        }
+
+        virtual RejectedExecutionHandler* clone() const override {
+            return new BlockPolicy(*this);
+        }
+
+    private:
+        std::chrono::nanoseconds timeout_;
+        bool                     throwOnTimeout_;
+};
+
+/**
+ * @brief LoadSheddingPolicy 最近的排队时间(getQueueDelay)超过maxQueueDelay时直接丢弃新任务,
+ *                           不等队列满;任务数达到上限时同样丢弃
+ *                           第一次检查时开启线程池的时间统计
+ */
+class LoadSheddingPolicy : public RejectedExecutionHandler {
+    public:
+        /**
+         * @brief LoadSheddingPolicy 构造函数
+         *
+         * @param maxQueueDelay 允许的排队时间
+         */
+        explicit LoadSheddingPolicy(const std::chrono::nanoseconds& maxQueueDelay)
+            : maxQueueDelay_(maxQueueDelay) {}
+
+        using RejectedExecutionHandler::rejectedExecution;
+
+        virtual bool rejectedExecution(Task& task, ThreadPoolExecutor&) override {
+            task.reset();
+            return false;
+        }
+
+        virtual bool admit(ThreadPoolExecutor& executor) override {
+            if (!executor.isMetricsEnabled())
+                executor.setMetricsEnabled(true);
+            return executor.getQueueDelay() <= maxQueueDelay_;
+        }
+
+        virtual bool checksAdmission() const override {
+            return true;
+        }
+
+        virtual RejectedExecutionHandler* clone() const override {
+            return new LoadSheddingPolicy(*this);
+        }
+
+    private:
+        std::chrono::nanoseconds maxQueueDelay_;
+};
+
+#endif /* REJECTIONPOLICY_HPP */
@@ -30,7 +30,7 @@ class Runnable {
          *
          * @param rh Runnable右值引用
          */
-        explicit Runnable(Runnable && rh): functor_(std::move(rh.functor_)) {}
+        explicit Runnable(Runnable && rh) noexcept: functor_(std::move(rh.functor_)) {}
 
         /**
          * @brief Runnable 拷贝构造不会复制functor_
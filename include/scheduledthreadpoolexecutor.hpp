@@ -6,142 +6,414 @@
 #include <algorithm>
 
 #include "threadpoolexecutor.hpp"
-#include "semaphore.hpp"
+#include "timerqueue.hpp"
+#include "timingwheel.hpp"
 
+class ScheduledThreadPoolExecutor;
+
+template<typename R>
 /**
- * @brief 定时任务封装
+ * @brief ScheduledFuture schedule系列函数返回的句柄,只能移动
+ *                        可以取消任务,查询状态和剩余延迟,
+ *                        一次性任务通过future()得到结果,周期任务的future()在取消后得到broken_promise
+ *                        只保存任务的weak_ptr,任务完成或取消后立即释放
+ *                        线程池析构后不能再调用cancel和getDelay
  */
-struct TimerTask : public Runnable {
-    template<typename F>
-    /**
-     * @brief TimerTask 构造函数
-     *
-     * @param initDelay 第一次调用的延迟
-     * @param interval 每次调用间隔
-     * @param fixedRate 是否等间隔运行,true执行间隔确定,false每次调用经过相同延迟
-     * @param f lambda或Runnable
-     */
-    TimerTask(const std::chrono::nanoseconds& initDelay,
-              const std::chrono::nanoseconds& interval,
-              bool fixedRate, F&& f)
-        : Runnable(std::move(f)),
-          initialDelay_(initDelay),
-          interval_(interval),
-          fixedRate_(fixedRate),
-          callTime_(std::chrono::steady_clock::now() + initDelay) {}
-
-    /**
-     * @brief TimerTask 拷贝构造
-     *
-     * @param rh 另一个TimerTask
-     */
-    explicit TimerTask(const TimerTask& rh)
-        : initialDelay_(rh.initialDelay_),
-          interval_(rh.interval_),
-          fixedRate_(rh.fixedRate_),
-          callTime_(rh.callTime_) {}
-
-    /**
-     * @brief TimerTask 默认构造
-     */
-    TimerTask() = default;
-
-    /**
-     * @brief operator= 赋值运算符
-     *
-     * @param rh 另一个TimerTask
-     *
-     * @return TimerTask&
-     */
-    TimerTask& operator=(const TimerTask& rh) {
-        initialDelay_ = rh.initialDelay_;
-        interval_ = rh.interval_;
-        fixedRate_ = rh.fixedRate_;
-        callTime_ = rh.callTime_;
-        return *this;
-    }
-    ///初次延迟
-    std::chrono::nanoseconds initialDelay_{0};
-    ///固定延迟或间隔
-    std::chrono::nanoseconds interval_{0};
-    ///是否是固定间隔执行
-    bool fixedRate_;
-    ///下次执行时间
-    std::chrono::steady_clock::time_point callTime_;
+class ScheduledFuture {
+    public:
+        /**
+         * @brief ScheduledFuture 默认构造,空句柄
+         */
+        ScheduledFuture() = default;
+
+        /**
+         * @brief ScheduledFuture 构造函数
+         *
+         * @param executor 任务所在的线程池
+         * @param task 定时任务
+         * @param future 任务结果
+         */
+        ScheduledFuture(ScheduledThreadPoolExecutor* executor,
+                        const std::shared_ptr<TimerTask>& task,
+                        std::future<R>&& future)
+            : executor_(executor), task_(task), future_(std::move(future)) {}
+
+        ScheduledFuture(ScheduledFuture&&) = default;
+        ScheduledFuture& operator=(ScheduledFuture&&) = default;
+
+        /**
+         * @brief cancel 取消任务,等待中的任务从定时任务队列移除,
+         *               正在执行的周期任务执行完后不再放回队列,
+         *               已经开始执行的一次性任务不能取消
+         *
+         * @return true - 取消成功,false - 任务已经开始,完成或已经取消
+         */
+        bool cancel();
+
+        /**
+         * @brief isCancelled 是否被这个句柄取消
+         */
+        bool isCancelled() const {
+            return cancelled_;
+        }
+
+        /**
+         * @brief isDone 任务是否已经完成或被取消
+         */
+        bool isDone() const;
+
+        /**
+         * @brief getDelay 距离下次执行的时间,已经到期或完成时返回0或负数
+         */
+        std::chrono::nanoseconds getDelay() const;
+
+        /**
+         * @brief future 任务结果
+         */
+        std::future<R>& future() {
+            return future_;
+        }
+
+        /**
+         * @brief get 等待并返回任务结果,取消的任务抛出std::future_error
+         */
+        R get() {
+            return future_.get();
+        }
+
+    private:
+        ScheduledThreadPoolExecutor*       executor_{nullptr};
+        std::weak_ptr<TimerTask>           task_;
+        std::future<R>                     future_;
+        bool                               cancelled_{false};
 };
 
 /**
  * @brief 定时任务调度线程池,最大线程数和核心线程数相等
+ *        也可以只使用一个定时线程,把到期的任务交给另一个ThreadPoolExecutor执行,
+ *        定时精度不受任务执行时间影响
  */
 class ScheduledThreadPoolExecutor: public ThreadPoolExecutor {
     private:
         /**
-         * @brief 小顶堆比较操作
+         * @brief 定时任务队列,由mutex_保护
          */
-        struct Comp {
-            public:
-                bool operator()(const std::shared_ptr<TimerTask>& t1, const std::shared_ptr<TimerTask>& t2) {
-                    return t1->callTime_ > t2->callTime_;
-                }
-        };
-
+        std::unique_ptr<TimerQueue> timerQueue_;
+        /**
+         * @brief 有新任务插入或线程池停止时通知等待的线程
+         */
+        std::condition_variable timerAvailable_;
         /**
-         * @brief 定时任务队列
+         * @brief 执行到期任务的线程池,为nullptr时由定时线程自己执行
          */
-        std::vector<std::shared_ptr<TimerTask>> timerTasks_;
-        Semaphore sem_{0};
+        ThreadPoolExecutor* workers_{nullptr};
+        /**
+         * @brief 已经交给workers_还没有执行完的任务数,由mutex_保护
+         */
+        int inFlight_{0};
 
     public:
         /**
-         * @brief ScheduledThreadPoolExecutor 构造函数
+         * @brief ScheduledThreadPoolExecutor 构造函数,使用小顶堆保存定时任务
          *
          * @param corePoolSize 核心线程数量
          * @param prefix 线程名前缀
          */
         ScheduledThreadPoolExecutor(int corePoolSize, const std::string& prefix = "")
             : ThreadPoolExecutor(corePoolSize, corePoolSize, prefix),
-              timerTasks_() {}
+              timerQueue_(new HeapTimerQueue()) {}
 
         /**
-         * @brief ~ScheduledThreadPoolExecutor 析构函数
+         * @brief ScheduledThreadPoolExecutor 构造函数
+         *
+         * @param corePoolSize 核心线程数量
+         * @param timerQueue 定时任务队列,例如new TimingWheel(std::chrono::milliseconds(1)),
+         *                   大量定时任务时插入和取消都是O(1),线程池负责释放
+         * @param prefix 线程名前缀
          */
-        virtual ~ScheduledThreadPoolExecutor() = default;
+        ScheduledThreadPoolExecutor(int corePoolSize, TimerQueue* timerQueue, const std::string& prefix = "")
+            : ThreadPoolExecutor(corePoolSize, corePoolSize, prefix),
+              timerQueue_(timerQueue) {
+            if (timerQueue == nullptr)
+                throw std::logic_error("timerQueue is nullptr");
+        }
+
+        /**
+         * @brief ScheduledThreadPoolExecutor 构造函数,只有一个定时线程,
+         *        到期的任务交给workers执行,workers的生命周期要长于这个线程池
+         *
+         * @param workers 执行任务的线程池,不负责释放
+         * @param timerQueue 定时任务队列,线程池负责释放
+         * @param prefix 定时线程名前缀
+         */
+        ScheduledThreadPoolExecutor(ThreadPoolExecutor& workers, TimerQueue* timerQueue,
+                                    const std::string& prefix = "")
+            : ThreadPoolExecutor(1, 1, prefix),
+              timerQueue_(timerQueue),
+              workers_(&workers) {
+            if (timerQueue == nullptr)
+                throw std::logic_error("timerQueue is nullptr");
+        }
+
+        /**
+         * @brief ScheduledThreadPoolExecutor 构造函数,只有一个定时线程,
+         *        使用小顶堆保存定时任务,到期的任务交给workers执行
+         *
+         * @param workers 执行任务的线程池,不负责释放
+         * @param prefix 定时线程名前缀
+         */
+        ScheduledThreadPoolExecutor(ThreadPoolExecutor& workers, const std::string& prefix = "")
+            : ScheduledThreadPoolExecutor(workers, new HeapTimerQueue(), prefix) {}
+
+        /**
+         * @brief ~ScheduledThreadPoolExecutor 析构函数,要在定时队列析构前停止定时线程
+         *        并等待交给workers的任务结束
+         */
+        virtual ~ScheduledThreadPoolExecutor() {
+            stop();
+        }
 
     private:
         /**
          * @brief scheduledThread 调度线程
+         *        在mutex_上等待最早的任务到期,插入更早的任务时会被唤醒,不会睡过头
+         *        shutdown后执行完剩下的一次性任务,交给workers_的任务也结束后退出
          */
-        virtual void coreWorkerThread(size_t) {
-            std::chrono::steady_clock::time_point callTime;
+        virtual void coreWorkerThread(size_t queueIdex) {
             std::shared_ptr<TimerTask> timerTask;
-            while(runStateOf(ctl_.load()) <= SHUTDOWN) {
-                sem_.wait();
+            std::atomic<uint32_t>& active = workerMetrics_[queueIdex]->active;
+            for (;;) {
                 {
-                    std::lock_guard<std::mutex> lock(mutex_);
-                    timerTask = timerTasks_.front();
-                    std::pop_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
-                    timerTasks_.pop_back();
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    int32_t rs = runStateOf(ctl_.load());
+                    if (rs > SHUTDOWN)
+                        break;
+                    timerTask = timerQueue_->poll(std::chrono::steady_clock::now());
+                    if (timerTask == nullptr) {
+                        if (rs == SHUTDOWN && timerQueue_->size() == 0 && inFlight_ == 0)
+                            break;
+                        TimerQueue::time_point next = timerQueue_->nextExpiry();
+                        if (next == TimerQueue::time_point::max())
+                            timerAvailable_.wait(lock);
+                        else
+                            timerAvailable_.wait_until(lock, next);
+                        continue;
+                    }
+                    timerTask->state_.store(TimerTask::RUNNING);
+                    if (workers_ != nullptr)
+                        ++inFlight_;
                 }
-                //如果是fixed rate就在执行前更新下次执行时间
-                //否则在执行后更新
-                callTime = timerTask->callTime_;
-                if (timerTask->fixedRate_) {
-                    timerTask->callTime_ = std::chrono::steady_clock::now() + timerTask->interval_;
-                    std::this_thread::sleep_until(callTime);
-                    timerTask->operator()();
-                } else {
-                    std::this_thread::sleep_until(callTime);
-                    timerTask->operator()();
-                    timerTask->callTime_ = std::chrono::steady_clock::now() + timerTask->interval_;
+                if (workers_ != nullptr) {
+                    dispatch(timerTask);
+                    timerTask.reset();
+                    continue;
                 }
-                //执行完毕并更新时间完成,将任务放回小顶堆
+                active.store(1, std::memory_order_relaxed);
+                timerTask->operator()();
+                active.store(0, std::memory_order_relaxed);
+                bool rescheduled = false;
                 {
-                    std::lock_guard<std::mutex> lock_guard(mutex_);
-                    timerTasks_.push_back(timerTask);
-                    std::push_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    rescheduled = afterRun(timerTask);
+                }
+                if (rescheduled)
+                    timerAvailable_.notify_one();
+                timerTask.reset();
+            }
+            //其他定时线程可能在等待刚被取走的最后一个任务,唤醒它们一起退出
+            timerAvailable_.notify_all();
+            processWorkerExit();
+        }
+
+        /**
+         * @brief dispatch 把到期的任务交给workers_执行,执行完后在workers_的线程中放回队列
+         *
+         * @param timerTask 到期的任务
+         */
+        void dispatch(const std::shared_ptr<TimerTask>& timerTask) {
+            std::shared_ptr<TimerTask> task(timerTask);
+            bool accepted = false;
+            try {
+                accepted = workers_->execute(Task([this, task]() {
+                    task->operator()();
+                    finishDispatched(task, true);
+                }));
+            } catch (...) {
+                accepted = false;
+            }
+            if (!accepted) {
+                //workers_已经关闭,任务不会再执行
+                task->state_.store(TimerTask::CANCELLED);
+                finishDispatched(task, false);
+            }
+        }
+
+        /**
+         * @brief finishDispatched 交给workers_的任务结束
+         *
+         * @param task 定时任务
+         * @param ran 是否执行了
+         */
+        void finishDispatched(const std::shared_ptr<TimerTask>& task, bool ran) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bool rescheduled = ran ? afterRun(task) : false;
+            if (!ran)
+                task->release();
+            --inFlight_;
+            //关闭后定时线程等待inFlight_为0再退出,停止时releaseWorkers等待inFlight_为0,
+            //它们醒来后线程池可能马上析构,持有锁通知,之后不再访问成员
+            if (rescheduled || runStateOf(ctl_.load()) >= SHUTDOWN)
+                timerAvailable_.notify_all();
+        }
+
+        /**
+         * @brief afterRun 任务执行完后更新状态,周期任务更新下次执行时间并放回定时任务队列,
+         *                 线程池关闭后周期任务被取消
+         *                 调用者需要持有mutex_
+         *
+         * @param task 刚执行完的任务
+         *
+         * @return true - 任务被放回队列
+         */
+        bool afterRun(const std::shared_ptr<TimerTask>& task) {
+            if (task->state_.load() == TimerTask::CANCELLED) {
+                task->release();
+                return false;
+            }
+            if (!task->isPeriodic()) {
+                task->state_.store(TimerTask::DONE);
+                if (task->done_ != nullptr)
+                    task->done_->set_value();
+                return false;
+            }
+            if (runStateAtLeast(ctl_.load(), SHUTDOWN)) {
+                task->state_.store(TimerTask::CANCELLED);
+                task->release();
+                return false;
+            }
+            //fixed rate按上次计划时间计算,fixed delay按执行结束时间计算
+            if (task->fixedRate_)
+                task->callTime_ += task->interval_;
+            else
+                task->callTime_ = std::chrono::steady_clock::now() + task->interval_;
+            task->state_.store(TimerTask::SCHEDULED);
+            timerQueue_->push(task);
+            return true;
+        }
+
+        /**
+         * @brief cancel 取消任务,由ScheduledFuture调用
+         *
+         * @param task 定时任务
+         *
+         * @return true - 取消成功
+         */
+        bool cancel(const std::shared_ptr<TimerTask>& task) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            int state = task->state_.load();
+            if (state == TimerTask::SCHEDULED) {
+                task->state_.store(TimerTask::CANCELLED);
+                timerQueue_->remove(task);
+                task->release();
+                return true;
+            }
+            if (state == TimerTask::RUNNING && task->isPeriodic()) {
+                //正在执行的周期任务,由afterRun释放;一次性任务已经开始执行,不能取消
+                task->state_.store(TimerTask::CANCELLED);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief getDelay 任务距离下次执行的时间,由ScheduledFuture调用
+         */
+        std::chrono::nanoseconds getDelay(const std::shared_ptr<TimerTask>& task) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       task->callTime_ - std::chrono::steady_clock::now());
+        }
+
+        template<typename R>
+        friend class ScheduledFuture;
+
+        /**
+         * @brief delayedExecute 放入定时任务队列,唤醒一个等待的线程,必要时启动新线程
+         *
+         * @param task 定时任务
+         *
+         * @return false - 线程池已经关闭,任务交给拒绝策略后被取消
+         */
+        bool delayedExecute(const std::shared_ptr<TimerTask>& task) {
+            int32_t c = ctl_.load();
+            bool accepted = false;
+            if (isRunning(c)) {
+                //在mutex_中再检查一次,onShutdown取出队列之后不会再有任务放入
+                std::lock_guard<std::mutex> lock(mutex_);
+                c = ctl_.load();
+                if (isRunning(c)) {
+                    timerQueue_->push(task);
+                    accepted = true;
+                }
+            }
+            if (!accepted) {
+                task->state_.store(TimerTask::CANCELLED);
+                reject(*task);
+                task->release();
+                return false;
+            }
+            timerAvailable_.notify_one();
+            int32_t wc = workerCountOf(c);
+            if (wc < corePoolSize_)
+                startCoreThreads(wc + 1);
+            return true;
+        }
+
+        /**
+         * @brief schedulePeriodic 提交TimerTask,完成通知由TimerTask的done_给出
+         */
+        ScheduledFuture<void> schedulePeriodic(const std::shared_ptr<TimerTask>& task) {
+            task->done_.reset(new std::promise<void>());
+            std::future<void> res(task->done_->get_future());
+            delayedExecute(task);
+            return ScheduledFuture<void>(this, task, std::move(res));
+        }
+
+    protected:
+        /**
+         * @brief onShutdown 取消所有周期任务,shutdown时保留一次性任务,执行完后定时线程退出,
+         *                   shutdownNow时取消所有任务,然后唤醒所有定时线程
+         */
+        virtual void onShutdown() override {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                bool stopped = runStateAtLeast(ctl_.load(), STOP);
+                for (auto& e : timerQueue_->drain()) {
+                    if (!stopped && !e->isPeriodic()) {
+                        timerQueue_->push(e);
+                        continue;
+                    }
+                    e->state_.store(TimerTask::CANCELLED);
+                    e->release();
                 }
-                sem_.post();
             }
+            timerAvailable_.notify_all();
+        }
+
+        /**
+         * @brief releaseWorkers 唤醒所有等待定时任务的线程后释放
+         */
+        virtual void releaseWorkers() override {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+            }
+            timerAvailable_.notify_all();
+            ThreadPoolExecutor::releaseWorkers();
+            //等待交给workers_的任务执行完,之后workers_不会再访问这个线程池
+            std::unique_lock<std::mutex> lock(mutex_);
+            timerAvailable_.wait(lock, [this] {
+                return inFlight_ == 0;
+            });
         }
 
     public:
@@ -157,56 +429,76 @@ class ScheduledThreadPoolExecutor: public ThreadPoolExecutor {
     public:
         template<typename F>
         /**
-         * @brief schedule 在将来某个时候执行给定的任务,
+         * @brief schedule 在将来某个时候执行一次给定的任务,
          *                 任务可以在新线程或现有的合并的线程中执行,
          *                 会抛出异常
          *
          * @param f 要提交的任务(Runnable或函数或lambda,不能是Runnable::sptr)
-         * @param delay 固定延迟
+         * @param delay 延迟
+         *
+         * @return 可以取消任务和得到结果的ScheduledFuture
          */
-        void schedule(F f, const std::chrono::nanoseconds& delay) {
-            int32_t c = ctl_.load();
-            int32_t rs = runStateOf(c);
-            int32_t wc = workerCountOf(c);
-            if (rs >= SHUTDOWN)
-                reject(Runnable(std::move(f)));
-            {
-                std::lock_guard<std::mutex> lock(mutex_);
-                timerTasks_.emplace_back(new TimerTask(delay, delay, false, std::move(f)));
-                std::push_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
-            }
-            sem_.post();
-            if(wc < corePoolSize_ && compareAndIncrementWorkerCount(c)) {
-                threads_.emplace_back(new Thread(std::bind(&ScheduledThreadPoolExecutor::coreWorkerThread, this, 0), prefix_));
-                threads_.back()->start();
-                everPoolSize_++;
-            }
+        ScheduledFuture<typename std::result_of<F()>::type>
+        schedule(F f, const std::chrono::nanoseconds& delay) {
+            using result_type = typename std::result_of<F()>::type;
+            std::packaged_task<result_type()> task(std::move(f));
+            std::future<result_type> res(task.get_future());
+            auto timerTask = std::make_shared<TimerTask>(delay, std::chrono::nanoseconds(0),
+                             false, std::move(task));
+            delayedExecute(timerTask);
+            return ScheduledFuture<result_type>(this, timerTask, std::move(res));
         }
 
         /**
          * @brief schedule 在将来某个时候执行给定的任务,
-         *                 任务可以在新线程或现有的合并的线程中执行,
+         *                 interval_大于0时按fixedRate_周期执行,否则只执行一次
          *                 会抛出异常
          *
          * @param f 要提交的任务(std::shared_ptr<TimerTask>)
+         *
+         * @return 可以取消任务的ScheduledFuture
          */
-        void schedule(const std::shared_ptr<TimerTask>& f) {
-            int32_t c = ctl_.load();
-            int32_t rs = runStateOf(c);
-            int32_t wc = workerCountOf(c);
-            if (rs >= SHUTDOWN)
-                reject(*f);
-            {
-                std::lock_guard<std::mutex> lock(mutex_);
-                timerTasks_.push_back(f);
-                std::push_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
+        ScheduledFuture<void> schedule(const std::shared_ptr<TimerTask>& f) {
+            return schedulePeriodic(f);
+        }
+
+        /**
+         * @brief SleepAwaiter co_await scheduler.sleepFor(delay)的等待对象,
+         *                     到期后协程在定时线程(或构造时传入的workers)中恢复,
+         *                     只分配TimerTask,没有future
+         */
+        struct SleepAwaiter {
+            bool await_ready() const noexcept {
+                return delay.count() <= 0;
             }
-            sem_.post();
-            if(wc < corePoolSize_ && compareAndIncrementWorkerCount(c)) {
-                threads_.emplace_back(new Thread(std::bind(&ScheduledThreadPoolExecutor::coreWorkerThread, this, 9), prefix_));
-                threads_.back()->start();
-                everPoolSize_++;
+
+            template<typename Handle>
+            bool await_suspend(Handle handle) {
+                //线程池已经关闭时按拒绝策略处理,默认的策略抛出的异常在co_await处重新抛出;
+                //拒绝策略没有抛出异常时任务已经被取消,返回false,协程不等待,在当前线程继续执行
+                //到期前被stop的协程不会再恢复
+                return scheduler->delayedExecute(std::make_shared<TimerTask>(delay, std::chrono::nanoseconds(0),
+                false, [handle]() mutable {
+                    handle.resume();
+                }));
             }
+
+            void await_resume() const noexcept {}
+
+            ScheduledThreadPoolExecutor* scheduler;
+            std::chrono::nanoseconds     delay;
+        };
+
+        /**
+         * @brief sleepFor 在协程中使用co_await scheduler.sleepFor(delay)等待一段时间,不占用线程
+         *                 没有workers时协程在定时线程中恢复,耗时的操作应该先co_await pool.schedule()
+         *
+         * @param delay 延迟,不大于0时不挂起
+         *
+         * @return 等待对象
+         */
+        SleepAwaiter sleepFor(const std::chrono::nanoseconds& delay) {
+            return SleepAwaiter{this, delay};
         }
 
         template<typename F>
@@ -215,27 +507,16 @@ class ScheduledThreadPoolExecutor: public ThreadPoolExecutor {
          *
          * @param f 要提交的任务(Runnable或函数或lambda,不能是Runnable::sptr)
          * @param initialDelay 初始延迟
-         * @param period 固定间隔
+         * @param period 固定间隔,必须大于0
+         *
+         * @return 可以取消任务的ScheduledFuture
          */
-        void scheduleAtFixedRate(F f,
-                                 const std::chrono::nanoseconds& initialDelay,
-                                 const std::chrono::nanoseconds& period) {
-            int32_t c = ctl_.load();
-            int32_t rs = runStateOf(c);
-            int32_t wc = workerCountOf(c);
-            if (rs >= SHUTDOWN)
-                reject(Runnable(std::move(f)));
-            {
-                std::lock_guard<std::mutex> lock(mutex_);
-                timerTasks_.emplace_back(new TimerTask(initialDelay, period, true, std::move(f)));
-                std::push_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
-            }
-            sem_.post();
-            if(wc < corePoolSize_ && compareAndIncrementWorkerCount(c)) {
-                threads_.emplace_back(new Thread(std::bind(&ScheduledThreadPoolExecutor::coreWorkerThread, this, 0), prefix_));
-                threads_.back()->start();
-                everPoolSize_++;
-            }
+        ScheduledFuture<void> scheduleAtFixedRate(F f,
+                const std::chrono::nanoseconds& initialDelay,
+                const std::chrono::nanoseconds& period) {
+            if (period.count() <= 0)
+                throw std::logic_error("period must be greater than 0");
+            return schedulePeriodic(std::make_shared<TimerTask>(initialDelay, period, true, std::move(f)));
         }
 
         template<typename F>
@@ -244,46 +525,16 @@ class ScheduledThreadPoolExecutor: public ThreadPoolExecutor {
          *
         * @param f 要提交的任务(Runnable或函数或lambda,不能是Runnable::sptr)
          * @param initialDelay 初始延迟
-         * @param delay 固定延迟
-         */
-        void scheduleAtFixedDelay(F f,
-                                  const std::chrono::nanoseconds& initialDelay,
-                                  const std::chrono::nanoseconds& delay) {
-            int32_t c = ctl_.load();
-            int32_t rs = runStateOf(c);
-            int32_t wc = workerCountOf(c);
-            if (rs >= SHUTDOWN)
-                reject(Runnable(std::move(f)));
-            {
-                std::lock_guard<std::mutex> lock(mutex_);
-                timerTasks_.emplace_back(initialDelay, delay, false, std::move(f));
-                std::push_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
-            }
-            sem_.post();
-            if(wc < corePoolSize_ && compareAndIncrementWorkerCount(c)) {
-                threads_.emplace_back(new Thread(std::bind(&ScheduledThreadPoolExecutor::coreWorkerThread, this, 0), prefix_));
-                threads_.back()->start();
-                everPoolSize_++;
-            }
-        }
-
-        /**
-         * @brief preStartCoreThreads 提前启动核心线程
+         * @param delay 固定延迟,必须大于0
          *
-         * @return
+         * @return 可以取消任务的ScheduledFuture
          */
-        virtual int preStartCoreThreads() {
-            int32_t c = ctl_.load();
-            for (int i = 0; i < corePoolSize_; ++i) {
-                if (compareAndIncrementWorkerCount(c)) {
-                    threads_.emplace_back(new Thread(std::bind(&ScheduledThreadPoolExecutor::coreWorkerThread,
-                                                     this, 0), prefix_));
-                }
-                c = ctl_.load();
-                threads_[i]->start();
-                everPoolSize_++;
-            }
-            return everPoolSize_;
+        ScheduledFuture<void> scheduleAtFixedDelay(F f,
+                const std::chrono::nanoseconds& initialDelay,
+                const std::chrono::nanoseconds& delay) {
+            if (delay.count() <= 0)
+                throw std::logic_error("delay must be greater than 0");
+            return schedulePeriodic(std::make_shared<TimerTask>(initialDelay, delay, false, std::move(f)));
         }
 
         std::string toString() const {
@@ -301,9 +552,42 @@ class ScheduledThreadPoolExecutor: public ThreadPoolExecutor {
 
         virtual long getTaskCount() const {
             std::lock_guard<std::mutex> lock(mutex_);
-            return timerTasks_.size();
+            return timerQueue_->size();
         }
 
 };
 
+template<typename R>
+bool ScheduledFuture<R>::cancel() {
+    if (cancelled_ || isDone())
+        return false;
+    std::shared_ptr<TimerTask> task = task_.lock();
+    if (task == nullptr || executor_ == nullptr)
+        return false;
+    if (executor_->cancel(task))
+        cancelled_ = true;
+    return cancelled_;
+}
+
+template<typename R>
+bool ScheduledFuture<R>::isDone() const {
+    //结果已经被get()取走或者已经可以取得
+    if (!future_.valid() ||
+            future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        return true;
+    std::shared_ptr<TimerTask> task = task_.lock();
+    if (task == nullptr)
+        return true;
+    int state = task->state_.load();
+    return state == TimerTask::DONE || state == TimerTask::CANCELLED;
+}
+
+template<typename R>
+std::chrono::nanoseconds ScheduledFuture<R>::getDelay() const {
+    std::shared_ptr<TimerTask> task = task_.lock();
+    if (task == nullptr || executor_ == nullptr)
+        return std::chrono::nanoseconds(0);
+    return executor_->getDelay(task);
+}
+
 #endif /* SCHEDULEDTHREADPOOLEXECUTOR_H */
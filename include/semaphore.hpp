@@ -2,6 +2,10 @@
 #define SEMAPHORE_HPP
 
 #include <semaphore.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
 #include <ctime>
 
 /**
@@ -52,6 +56,25 @@ class Semaphore {
             return sem_timedwait(&sem_, &ts);
         }
 
+        /**
+         * @brief waitFor 信号量减一,最多等待timeout
+         *
+         * @param timeout 等待时间
+         *
+         * @return 错误码 0表示成功,超时时errno为ETIMEDOUT
+         */
+        int waitFor(const std::chrono::nanoseconds& timeout) {
+            //sem_timedwait使用CLOCK_REALTIME的绝对时间
+            timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            int64_t ns = ts.tv_nsec + std::max<int64_t>(0, timeout.count());
+            ts.tv_sec += static_cast<time_t>(ns / 1000000000);
+            ts.tv_nsec = static_cast<long>(ns % 1000000000);
+            int res = 0;
+            while ((res = sem_timedwait(&sem_, &ts)) != 0 && errno == EINTR) {}
+            return res;
+        }
+
     public:
         /**
          * @brief Semaphore 构造函数
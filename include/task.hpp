@@ -0,0 +1,226 @@
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Task 只能移动的任务封装,线程池任务队列的元素类型
+ *             不大于INLINE_SIZE字节且可以无异常移动的可调用对象直接存放在Task内部,
+ *             不需要分配内存,其他的可调用对象放在堆上
+ *             调用,移动,析构都通过同一个函数指针完成,没有虚函数
+ */
+class Task {
+    public:
+        ///内部存储大小,加上函数指针,入队时间和对齐后sizeof(Task)为64字节
+        static constexpr size_t INLINE_SIZE = 48;
+
+    private:
+        /**
+         * @brief 函数指针要执行的操作
+         */
+        enum class Op { CALL, MOVE, DESTROY };
+
+        /**
+         * @brief 操作函数,MOVE时把src移动到dst并析构src
+         */
+        using Manager = void (*)(Op op, Task* dst, Task* src);
+
+        template<typename F>
+        struct IsInline {
+            static constexpr bool value =
+                sizeof(F) <= INLINE_SIZE &&
+                alignof(F) <= alignof(std::max_align_t) &&
+                std::is_nothrow_move_constructible<F>::value;
+        };
+
+        template<typename F>
+        static void inlineManager(Op op, Task* dst, Task* src) {
+            F* f = reinterpret_cast<F*>(&src->storage_);
+            switch (op) {
+            case Op::CALL:
+                (*f)();
+                break;
+            case Op::MOVE:
+                ::new (static_cast<void*>(&dst->storage_)) F(std::move(*f));
+                f->~F();
+                break;
+            case Op::DESTROY:
+                f->~F();
+                break;
+            }
+        }
+
+        template<typename F>
+        static void heapManager(Op op, Task* dst, Task* src) {
+            F*& f = *reinterpret_cast<F**>(&src->storage_);
+            switch (op) {
+            case Op::CALL:
+                (*f)();
+                break;
+            case Op::MOVE:
+                *reinterpret_cast<F**>(&dst->storage_) = f;
+                break;
+            case Op::DESTROY:
+                delete f;
+                break;
+            }
+        }
+
+        template<typename F>
+        void init(F&& f, std::true_type) {
+            using Fn = typename std::decay<F>::type;
+            ::new (static_cast<void*>(&storage_)) Fn(std::forward<F>(f));
+            manager_ = &inlineManager<Fn>;
+        }
+
+        template<typename F>
+        void init(F&& f, std::false_type) {
+            using Fn = typename std::decay<F>::type;
+            *reinterpret_cast<Fn**>(&storage_) = new Fn(std::forward<F>(f));
+            manager_ = &heapManager<Fn>;
+        }
+
+    public:
+        /**
+         * @brief Task 默认构造,空任务
+         */
+        Task() noexcept {}
+
+        template<typename F,
+                 typename = typename std::enable_if<
+                     !std::is_same<typename std::decay<F>::type, Task>::value>::type,
+                 typename = decltype(std::declval<typename std::decay<F>::type&>()())>
+        /**
+         * @brief Task 构造函数
+         *
+         * @param f 可调用对象(函数,lambda,std::packaged_task,Runnable等)
+         */
+        Task(F&& f) {
+            init(std::forward<F>(f),
+                 std::integral_constant<bool, IsInline<typename std::decay<F>::type>::value>());
+        }
+
+        /**
+         * @brief Task 移动构造
+         *
+         * @param rh 被移动的Task,之后为空
+         */
+        Task(Task&& rh) noexcept
+            : enqueueTime_(rh.enqueueTime_)
+#ifdef THREADPOOL_TRACE
+            , traceId_(rh.traceId_)
+#endif
+        {
+            if (rh.manager_ != nullptr) {
+                rh.manager_(Op::MOVE, this, &rh);
+                manager_ = rh.manager_;
+                rh.manager_ = nullptr;
+            }
+        }
+
+        /**
+         * @brief operator= 移动赋值
+         *
+         * @param rh 被移动的Task,之后为空
+         *
+         * @return Task&
+         */
+        Task& operator=(Task&& rh) noexcept {
+            if (this != &rh) {
+                reset();
+                enqueueTime_ = rh.enqueueTime_;
+#ifdef THREADPOOL_TRACE
+                traceId_ = rh.traceId_;
+#endif
+                if (rh.manager_ != nullptr) {
+                    rh.manager_(Op::MOVE, this, &rh);
+                    manager_ = rh.manager_;
+                    rh.manager_ = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        /**
+         * @brief ~Task 析构函数
+         */
+        ~Task() {
+            reset();
+        }
+
+        /**
+         * @brief operator() 执行任务,空任务什么都不做
+         */
+        void operator()() {
+            if (manager_ != nullptr)
+                manager_(Op::CALL, this, this);
+        }
+
+        /**
+         * @brief reset 释放内部的可调用对象
+         */
+        void reset() noexcept {
+            if (manager_ != nullptr) {
+                manager_(Op::DESTROY, this, this);
+                manager_ = nullptr;
+            }
+        }
+
+        /**
+         * @brief empty 判断是否为空任务
+         *
+         * @return bool true-空
+         */
+        bool empty() const noexcept {
+            return manager_ == nullptr;
+        }
+
+        /**
+         * @brief enqueueTime 入队时间(metricsNow纳秒),0表示没有记录
+         */
+        int64_t enqueueTime() const noexcept {
+            return enqueueTime_;
+        }
+
+        /**
+         * @brief setEnqueueTime 记录入队时间
+         */
+        void setEnqueueTime(int64_t t) noexcept {
+            enqueueTime_ = t;
+        }
+
+#ifdef THREADPOOL_TRACE
+        /**
+         * @brief traceId 跟踪用的任务编号,0表示提交时没有开启跟踪
+         */
+        uint64_t traceId() const noexcept {
+            return traceId_;
+        }
+
+        void setTraceId(uint64_t id) noexcept {
+            traceId_ = id;
+        }
+#endif
+
+    private:
+        ///可调用对象存储,放不下时存放堆上对象的指针
+        typename std::aligned_storage<INLINE_SIZE, alignof(std::max_align_t)>::type storage_;
+        ///操作函数,为nullptr表示空任务
+        Manager manager_{nullptr};
+        ///入队时间,用于统计排队时间,占用对齐填充的位置
+        int64_t enqueueTime_{0};
+#ifdef THREADPOOL_TRACE
+        ///跟踪编号,只在定义THREADPOOL_TRACE时存在,sizeof(Task)变为80字节
+        uint64_t traceId_{0};
+#endif
+
+    public:
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+};
+
+#endif /* TASK_HPP */
@@ -0,0 +1,195 @@
+#ifndef TASKGROUP_HPP
+#define TASKGROUP_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "threadpoolexecutor.hpp"
+
+/**
+ * @brief TaskGroup 绑定到一个线程池的一组相关任务,run提交,wait等待全部结束,cancel取消还没有开始的任务
+ *                  任务放在组自己的队列中,每个任务向线程池提交一个取任务执行的占位任务,
+ *                  wait时调用线程先执行组内还没有开始的任务,只在剩下的任务都在其他线程执行时休眠,
+ *                  所以线程池的线程嵌套等待时不会占住线程等待排在自己后面的任务
+ */
+class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPoolExecutor& executor)
+            : executor_(executor), state_(std::make_shared<State>()) {}
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        /**
+         * @brief ~TaskGroup 等待所有任务结束,任务的异常被丢弃
+         */
+        ~TaskGroup() {
+            state_->waitAll();
+        }
+
+        template<typename F>
+        /**
+         * @brief run 把f加入组,交给线程池执行;线程池拒绝时f留在组的队列中,由wait的线程执行
+         *            组已经取消时f不会执行
+         *
+         * @param f 可调用对象,抛出的第一个异常由wait重新抛出,同时取消组内其他还没有开始的任务
+         */
+        void run(F f) {
+            std::shared_ptr<State> state = state_;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->cancelled.load(std::memory_order_relaxed))
+                    return;
+                state->pending.fetch_add(1, std::memory_order_relaxed);
+                state->queue.emplace_back(std::move(f));
+                //wait的线程可能在等待其他线程上的任务,唤醒它来执行新任务
+                state->done.notify_all();
+            }
+            //占位任务被拒绝时f仍在组的队列中,由wait的线程执行
+            try {
+                executor_.execute(Task([state] {
+                    state->runOne(false);
+                }));
+            } catch (...) {
+            }
+        }
+
+        /**
+         * @brief wait 等待组内所有任务结束,等待时在当前线程执行还没有开始的任务;
+         *             有任务抛出异常时重新抛出第一个异常,之后组可以继续使用
+         */
+        void wait() {
+            state_->waitAll();
+            std::exception_ptr error;
+            {
+                std::lock_guard<std::mutex> lock(state_->mutex);
+                error = std::move(state_->error);
+                state_->error = nullptr;
+                state_->cancelled.store(false, std::memory_order_relaxed);
+            }
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        /**
+         * @brief cancel 丢弃还没有开始的任务,之后run的任务也不再执行,直到wait返回
+         *               正在执行的任务不会被中断,可以通过isCancelled检查
+         */
+        void cancel() {
+            state_->cancel();
+        }
+
+        /**
+         * @brief isCancelled 组是否已经被取消或者有任务抛出异常
+         */
+        bool isCancelled() const {
+            return state_->cancelled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief getPendingCount 还没有结束的任务数,包括正在执行的任务
+         */
+        size_t getPendingCount() const {
+            return state_->pending.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief State 组的状态,线程池中的占位任务也持有它,组析构后占位任务仍然可以安全执行
+         */
+        struct State {
+            std::mutex                 mutex;
+            std::condition_variable    done;
+            std::deque<Task>           queue;
+            ///还没有结束的任务数
+            std::atomic<size_t>        pending{0};
+            std::atomic<bool>          cancelled{false};
+            ///第一个异常,wait时取走
+            std::exception_ptr         error;
+
+            /**
+             * @brief runOne 取出并执行一个任务,占位任务从队头取(先提交先执行),
+             *               wait的线程从队尾取(最近提交的任务,和嵌套的子任务在一起)
+             *
+             * @return 队列为空时返回false
+             */
+            bool runOne(bool newest) {
+                Task task;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (queue.empty())
+                        return false;
+                    if (newest) {
+                        task = std::move(queue.back());
+                        queue.pop_back();
+                    } else {
+                        task = std::move(queue.front());
+                        queue.pop_front();
+                    }
+                }
+                if (!cancelled.load(std::memory_order_relaxed)) {
+                    try {
+                        task();
+                    } catch (...) {
+                        fail(std::current_exception());
+                    }
+                }
+                task.reset();
+                finish(1);
+                return true;
+            }
+
+            void fail(std::exception_ptr e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = e;
+                cancelled.store(true, std::memory_order_relaxed);
+            }
+
+            void cancel() {
+                std::deque<Task> dropped;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    cancelled.store(true, std::memory_order_relaxed);
+                    dropped.swap(queue);
+                }
+                //在锁外析构任务,任务捕获的对象析构时可能再调用run
+                size_t count = dropped.size();
+                dropped.clear();
+                if (count != 0)
+                    finish(count);
+            }
+
+            void finish(size_t count) {
+                if (pending.fetch_sub(count, std::memory_order_acq_rel) == count) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done.notify_all();
+                }
+            }
+
+            /**
+             * @brief waitAll 先执行队列中的任务,队列为空后等待其他线程上的任务结束
+             */
+            void waitAll() {
+                while (pending.load(std::memory_order_acquire) != 0) {
+                    if (runOne(true))
+                        continue;
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.wait(lock, [this] {
+                        return pending.load(std::memory_order_acquire) == 0 || !queue.empty();
+                    });
+                }
+            }
+        };
+
+    private:
+        ThreadPoolExecutor&    executor_;
+        std::shared_ptr<State> state_;
+};
+
+#endif /* TASKGROUP_HPP */
@@ -1,13 +1,17 @@
 #ifndef THREAD_HPP
 #define THREAD_HPP
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <cstring>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include <pthread.h>
+#include <sched.h>
 #include <sys/syscall.h>
 #include <sys/signal.h>
 #include <unistd.h>
@@ -114,6 +118,25 @@ static bool setCurrentThreadName(const std::string& name) {
     return setThreadName(std::this_thread::get_id(), name);
 }
 
+/**
+ * @brief setCurrentThreadAffinity 把当前线程绑定到指定的CPU
+ *
+ * @param cpus CPU编号,为空时不做任何修改
+ *
+ * @return true - 成功
+ */
+static bool setCurrentThreadAffinity(const std::vector<int>& cpus) {
+    if (cpus.empty())
+        return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
 class ThreadPoolExecutor;
 
 /**
@@ -176,8 +199,9 @@ class Thread {
             setCurrentThreadName(name_ + std::to_string(syscall(__NR_gettid)));
             currentPid_ = syscall(__NR_gettid);
             idle_.store(false, std::memory_order_relaxed);
-            lastActiveTime_ = std::chrono::steady_clock::now();
+            touch();
             pthread_setschedprio(pthread_self(), prio_);
+            setCurrentThreadAffinity(cpus_);
             try {
                 run();
             } catch(...) {
@@ -194,8 +218,9 @@ class Thread {
             setCurrentThreadName(name_ + std::to_string(syscall(__NR_gettid)));
             currentPid_ = syscall(__NR_gettid);
             idle_.store(false, std::memory_order_relaxed);
-            lastActiveTime_ = std::chrono::steady_clock::now();
+            touch();
             pthread_setschedprio(pthread_self(), prio_);
+            setCurrentThreadAffinity(cpus_);
             try {
                 func_uptr_->call();
                 func_uptr_.release();
@@ -303,7 +328,14 @@ class Thread {
          */
         virtual std::chrono::steady_clock::time_point
         getLastActiveTime()const final {
-            return lastActiveTime_;
+            return lastActiveTime_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief touch 把上一次活跃时间更新为现在,其他线程可以同时调用getLastActiveTime
+         */
+        virtual void touch() final {
+            lastActiveTime_.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
         }
 
         /**
@@ -342,6 +374,24 @@ class Thread {
             prio_ = prio;
         }
 
+        /**
+         * @brief setAffinity 设置线程可以运行的CPU,在start之前调用
+         *
+         * @param cpus CPU编号,为空表示不限制
+         */
+        virtual void setAffinity(const std::vector<int>& cpus) final {
+            cpus_ = cpus;
+        }
+
+        /**
+         * @brief getAffinity 获取线程绑定的CPU
+         *
+         * @return CPU编号,为空表示不限制
+         */
+        virtual std::vector<int> getAffinity() const final {
+            return cpus_;
+        }
+
         /**
          * @brief getPrio 获取线程优先级
          *
@@ -358,16 +408,22 @@ class Thread {
         pid_t                                  currentPid_{-1};
         ///线程名前缀
         std::string                            name_;
+        ///绑定的CPU,为空表示不限制
+        std::vector<int>                       cpus_;
         ///线程
         std::thread                            thread_;
+        //stop_和yield_由控制线程修改,idle_和lastActiveTime_由线程自己修改,放在不同的缓存行
+        char                                   controlPad_[64];
         ///线程停止标志
         std::atomic_bool                       stop_{true};
-        ///线程空闲标志
-        std::atomic_bool                       idle_{true};
         ///让出时间片标志
         std::atomic_bool                       yield_{false};
+        char                                   statePad_[64];
+        ///线程空闲标志
+        std::atomic_bool                       idle_{true};
         ///上次活跃时间
-        std::chrono::steady_clock::time_point  lastActiveTime_{std::chrono::steady_clock::now()};
+        std::atomic<std::chrono::steady_clock::time_point> lastActiveTime_{std::chrono::steady_clock::now()};
+        char                                   endPad_[64];
 
     protected:
         /**
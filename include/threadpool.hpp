@@ -3,5 +3,9 @@
 
 #include "scheduledthreadpoolexecutor.hpp"
 #include "workstealingthreadpoolexecutor.hpp"
+#include "poolfuture.hpp"
+#include "parallel.hpp"
+#include "taskgroup.hpp"
+#include "rejectionpolicy.hpp"
 
 #endif /* THREADPOOL_H */
@@ -1,16 +1,31 @@
 #ifndef THREADPOOLEXECUTOR_HPP
 #define THREADPOOLEXECUTOR_HPP
 
+#include <chrono>
+#include <condition_variable>
 #include <future>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include "thread.hpp"
 #include "blockingqueue.hpp"
 #include "runnable.hpp"
 #include "semaphore.hpp"
+#include "parker.hpp"
+#include "task.hpp"
+#include "metrics.hpp"
+#include "topology.hpp"
+#include "workstealingqueue.hpp"
+#include "localtaskpool.hpp"
+#include "trace.hpp"
+
+class ThreadPoolExecutor;
 
 /**
- * @brief 不再接受任务时的拒绝策略
+ * @brief 不再接受任务或任务数达到上限时的拒绝策略,默认抛出异常
+ *        内置的其他策略见rejectionpolicy.hpp
  */
 class RejectedExecutionHandler {
     public:
@@ -37,6 +52,61 @@ class RejectedExecutionHandler {
         virtual void rejectedExecution(const Runnable& r) {
             throw std::logic_error("thread pool is not RUNNING");
         }
+
+        /**
+         * @brief rejectedExecution 线程池拒绝任务时调用,
+         *                          默认线程池不在运行时调用rejectedExecution(Runnable),
+         *                          任务数达到上限时抛出std::runtime_error
+         *
+         * @param task 被拒绝的任务,可以执行,移动或丢弃
+         * @param executor 拒绝任务的线程池
+         *
+         * @return true - 任务已经执行或放入队列
+         */
+        virtual bool rejectedExecution(Task& task, ThreadPoolExecutor& executor);
+
+        /**
+         * @brief admit 任务放入队列前的准入检查,只有checksAdmission为true时才会调用
+         *
+         * @return false - 拒绝任务,交给rejectedExecution处理
+         */
+        virtual bool admit(ThreadPoolExecutor&) {
+            return true;
+        }
+
+        /**
+         * @brief checksAdmission 是否需要在每次提交时调用admit
+         */
+        virtual bool checksAdmission() const {
+            return false;
+        }
+
+        /**
+         * @brief clone 复制策略,setRejectedExecutionHandler(const&)使用,
+         *              子类必须重写,否则复制得到的是基类,setRejectedExecutionHandler(const&)抛出异常;
+         *              不能复制的策略使用setRejectedExecutionHandler(std::shared_ptr)
+         */
+        virtual RejectedExecutionHandler* clone() const {
+            return new RejectedExecutionHandler(*this);
+        }
+};
+
+/**
+ * @brief 任务优先级,NORMAL使用原来的任务队列,HIGH和LOW只分配给核心线程
+ */
+enum class TaskPriority { HIGH = 0, NORMAL = 1, LOW = 2 };
+
+/**
+ * @brief 弹性伸缩策略:排队时间超过growThreshold时增加非核心线程,
+ *        非核心线程连续空闲keepAlive后退出
+ */
+struct ElasticPolicy {
+    ///排队时间(各线程指数移动平均)超过这个值时增加线程
+    std::chrono::nanoseconds growThreshold{std::chrono::milliseconds(1)};
+    ///非核心线程空闲多久后退出
+    std::chrono::nanoseconds keepAlive{std::chrono::seconds(60)};
+    ///两次增加线程的最小间隔,新线程开始分担任务后排队时间才会下降
+    std::chrono::nanoseconds growInterval{std::chrono::milliseconds(10)};
 };
 
 /**
@@ -96,6 +166,22 @@ class ThreadPoolExecutor {
                                     int32_t maxPoolSize,
                                     const std::string& prefix = "");
 
+        /**
+         * @brief ThreadPoolExecutor 构造函数,根据corePoolSize构造相同大小的有界workQueue
+         *							 每个线程的任务队列都是容量为queueCapacity的
+         *							 无锁环形队列,队列满时提交任务会阻塞
+         *                           会抛出异常
+         *
+         * @param corePoolSize 核心线程数
+         * @param maxPoolSize 最大线程数
+         * @param queueCapacity 每个任务队列的容量(向上取整为2的幂),0表示无界队列
+         * @param prefix  线程名前缀
+         */
+        explicit ThreadPoolExecutor(int32_t corePoolSize,
+                                    int32_t maxPoolSize,
+                                    size_t queueCapacity,
+                                    const std::string& prefix = "");
+
         /**
          * @brief ~ThreadPoolExecutor 析构函数
          */
@@ -118,7 +204,7 @@ class ThreadPoolExecutor {
         virtual void keepNonCoreThreadAlive(bool value) final;
 
         /**
-         * @brief releaseNonCoreThreads 释放非核心线程(释放线程资源,并弹出线程队列)
+         * @brief releaseNonCoreThreads 释放非核心线程(释放线程资源,队列位置留给之后的非核心线程)
          *								如果keepNonCoreThreadAlive=false,
          *								那么非核心线程会自动退出
          *								执行时会将keepNonCoreThreadAlive设为false,
@@ -126,18 +212,136 @@ class ThreadPoolExecutor {
          */
         virtual void releaseNonCoreThreads();
 
+        /**
+         * @brief setElastic 开启或关闭弹性伸缩,需要至少一个核心线程,会开启时间统计
+         *                   开启后非核心线程没有自己的任务,从核心线程的队列窃取任务,
+         *                   core=false提交的任务也放入核心线程的队列;
+         *                   执行任务时测得的排队时间超过growThreshold就增加一个非核心线程(不超过maxPoolSize),
+         *                   非核心线程按Thread::getLastActiveTime空闲keepAlive后退出
+         *
+         * @param enabled true - 开启
+         * @param policy 伸缩策略
+         */
+        virtual void setElastic(bool enabled, const ElasticPolicy& policy = ElasticPolicy()) final;
+
+        /**
+         * @brief isElastic 是否开启了弹性伸缩
+         */
+        virtual bool isElastic() const final;
+
+        /**
+         * @brief getElasticPolicy 弹性伸缩策略
+         */
+        virtual ElasticPolicy getElasticPolicy() const final;
+
+        /**
+         * @brief getGrowCount 弹性伸缩增加线程的次数
+         */
+        virtual uint64_t getGrowCount() const final;
+
+        /**
+         * @brief getShrinkCount 弹性伸缩中非核心线程空闲退出的次数
+         */
+        virtual uint64_t getShrinkCount() const final;
+
+        /**
+         * @brief getPoolSize 当前的线程数
+         */
+        virtual int getPoolSize() const final;
+
+        /**
+         * @brief setRejectedExecutionHandler 设置新的任务拒绝策略,保存handler.clone()的结果
+         *                                    clone返回的类型和handler不同时(子类没有重写clone)
+         *                                    抛出std::logic_error,不会悄悄退化成基类的策略
+         *
+         * @param handler RejectedExecutionHandler类对象,子类需要重写clone
+         */
+        virtual void setRejectedExecutionHandler(const RejectedExecutionHandler& handler) final;
+
         /**
          * @brief setRejectedExecutionHandler 设置新的任务拒绝策略
          *
-         * @param handler RejectedExecutionHandler类对象
+         * @param handler 拒绝策略,线程池负责释放
+         */
+        virtual void setRejectedExecutionHandler(RejectedExecutionHandler* handler) final;
+
+        /**
+         * @brief setRejectedExecutionHandler 设置新的任务拒绝策略,和调用者共享,不复制,保留实际类型
+         *
+         * @param handler 拒绝策略,为空时使用默认策略
          */
-        virtual void setRejectedExecutionHandler(RejectedExecutionHandler handler) final;
+        virtual void setRejectedExecutionHandler(std::shared_ptr<RejectedExecutionHandler> handler) final;
+
+        /**
+         * @brief setTaskCapacity 设置线程池接受的任务总数上限(排队和正在执行的任务),
+         *                        达到上限后提交的任务交给拒绝策略,
+         *                        线程池的线程向自己队列提交的子任务不受限制
+         *
+         * @param capacity 上限,0表示不限制
+         */
+        virtual void setTaskCapacity(size_t capacity) final;
+
+        /**
+         * @brief getTaskCapacity 任务总数上限
+         *
+         * @return 上限,0表示不限制
+         */
+        virtual size_t getTaskCapacity() const final;
+
+        /**
+         * @brief getPendingTaskCount 已经接受还没有执行完的任务数,
+         *                            线程池外提交的任务和每个线程提交给自己的任务分开计数,这里求和
+         */
+        virtual size_t getPendingTaskCount() const final;
+
+        /**
+         * @brief offer 放入任务,不触发拒绝策略
+         *              不会抛出异常
+         *
+         * @param task 任务,失败时不会被移动
+         *
+         * @return false - 线程池不在运行或任务数达到上限
+         */
+        virtual bool offer(Task&& task);
+
+        /**
+         * @brief offer 放入任务,任务数达到上限时最多等待timeout,不触发拒绝策略
+         *              在线程池的线程内调用可能等不到空位
+         *
+         * @param task 任务,失败时不会被移动
+         * @param timeout 最长等待时间
+         *
+         * @return false - 线程池不在运行或超时
+         */
+        virtual bool offer(Task&& task, const std::chrono::nanoseconds& timeout);
+
+        /**
+         * @brief discardOldestTask 丢弃一个最早排队的任务,先找低优先级队列
+         *
+         * @return true - 丢弃了一个任务
+         */
+        virtual bool discardOldestTask();
+
+        /**
+         * @brief getQueueDelay 最近的排队时间,各线程排队时间指数移动平均的最大值,
+         *                      只统计最近100ms内执行过任务的线程,需要setMetricsEnabled(true)
+         *
+         * @return 排队时间
+         */
+        virtual std::chrono::nanoseconds getQueueDelay() const;
+
+        /**
+         * @brief isRunning 线程池是否还在接受任务
+         */
+        virtual bool isRunning() const final {
+            return isRunning(ctl_.load());
+        }
 
         /**
             * @brief execute 在将来某个时候执行给定的任务,无返回值,
             *                任务可以在新线程或现有的合并的线程中执行,
             *                向任务队列提交的是任务副本
-            *                不会抛出异常
+            *                被拒绝时交给拒绝策略,默认的策略会抛出异常
             *
             * @param command 要执行的任务(Runnable的子类shared_ptr),
         	*                任务执行完依然能够拿到结果
@@ -152,7 +356,7 @@ class ThreadPoolExecutor {
          * @brief execute 在将来某个时候执行给定的任务,无返回值,
          *                任务可以在新线程或现有的合并的线程中执行,
          *                向任务队列提交的是任务副本
-         *                不会抛出异常
+         *                被拒绝时交给拒绝策略,默认的策略会抛出异常
          *
          * @param command 要执行的任务(Runnable或函数或lambda),任务会被用std::move(转移),
          *                任务结束后就会消失
@@ -164,11 +368,40 @@ class ThreadPoolExecutor {
          */
         virtual bool execute(Runnable& command, bool core = true);
 
+        /**
+         * @brief execute 在将来某个时候执行给定的任务,无返回值,
+         *                任务直接以Task的形式放入任务队列,
+         *                不大于Task::INLINE_SIZE的函数或lambda不会分配内存
+         *                在本线程池的线程内调用时无锁压入当前线程的本地队列(LIFO),
+         *                当前线程优先执行,空闲线程从另一端窃取
+         *                被拒绝时交给拒绝策略,默认的策略会抛出异常
+         *
+         * @param task    要执行的任务(函数或lambda)
+         * @param core    是否使用核心线程,在核心线程没有完全启动时,
+         *                会忽略core的值,优先启动核心线程
+         *
+         * @return          true - 添加成功
+         */
+        virtual bool execute(Task&& task, bool core = true);
+
+        /**
+         * @brief execute 按优先级执行任务,无返回值
+         *                核心线程总是先执行HIGH,再执行NORMAL,最后执行LOW,
+         *                低优先级队列连续被跳过getPriorityAging次后优先执行一次,不会饿死
+         *                被拒绝时交给拒绝策略,默认的策略会抛出异常
+         *
+         * @param task     要执行的任务
+         * @param priority 优先级,NORMAL和execute(task)相同
+         *
+         * @return true - 添加成功
+         */
+        virtual bool execute(Task&& task, TaskPriority priority);
+
         /**
          * @brief execute 在将来某个时候执行给定的任务,无返回值,
          *                任务可以在新线程或现有的合并的线程中执行,
          *                向任务队列提交的是任务副本
-         *                不会抛出异常
+         *                被拒绝时交给拒绝策略,默认的策略会抛出异常
          *
          * @param commands 要执行的任务队列
          * @param core 是否使用核心线程,如果为true,任务将被平均分配给核心线程
@@ -196,16 +429,158 @@ class ThreadPoolExecutor {
             using result_type = typename std::result_of<F()>::type;
             std::packaged_task<result_type()> task(std::move(f));
             std::future<result_type> res(task.get_future());
-            if(addWorker(Runnable(std::move(task)), core)) {
-            } else {
-                int c = ctl_.load();
-                if (!isRunning(c)) {
-                    reject(Runnable(std::move(task)));
-                }
+            //packaged_task可以直接放进Task内部,除了future的共享状态外没有其他内存分配
+            execute(Task(std::move(task)), core);
+            return res;
+        }
+
+        /**
+         * @brief submit 按优先级提交任务,可以有返回值
+         *               会抛出异常
+         *
+         * @param f 要提交的任务(Runnable或函数或lambda)
+         * @param priority 优先级,高优先级任务可以超过已经排队的普通任务和低优先级任务
+         *
+         * @return res 任务返回值的future
+         */
+        template<typename F>
+        std::future<typename std::result_of<F()>::type>
+        submit(F f, TaskPriority priority) {
+            using result_type = typename std::result_of<F()>::type;
+            std::packaged_task<result_type()> task(std::move(f));
+            std::future<result_type> res(task.get_future());
+            execute(Task(std::move(task)), priority);
+            return res;
+        }
+
+        /**
+         * @brief executeOnNode 把任务交给指定NUMA节点上的核心线程,无返回值
+         *                      会启动到该节点线程为止的核心线程,
+         *                      没有线程在该节点时和execute(task)相同
+         *                      被拒绝时交给拒绝策略,默认的策略会抛出异常
+         *
+         * @param task 要执行的任务
+         * @param node 节点下标,见getWorkerNode
+         *
+         * @return true - 添加成功
+         */
+        virtual bool executeOnNode(Task&& task, int node);
+
+        /**
+         * @brief submitOnNode 把任务交给指定NUMA节点上的核心线程,可以有返回值
+         *                     会抛出异常
+         *
+         * @param f 要提交的任务(Runnable或函数或lambda)
+         * @param node 节点下标
+         *
+         * @return res 任务返回值的future
+         */
+        template<typename F>
+        std::future<typename std::result_of<F()>::type>
+        submitOnNode(F f, int node) {
+            using result_type = typename std::result_of<F()>::type;
+            std::packaged_task<result_type()> task(std::move(f));
+            std::future<result_type> res(task.get_future());
+            executeOnNode(Task(std::move(task)), node);
+            return res;
+        }
+
+        /**
+         * @brief executeBatch 批量执行任务,无返回值,
+         *                     任务被分成连续的几段,每个核心线程的任务队列只加一次锁,
+         *                     整批任务只唤醒一次等待的线程
+         *                     被拒绝时交给拒绝策略,默认的策略会抛出异常
+         *
+         * @param tasks 要执行的任务,成功后被清空
+         * @param core  是否使用核心线程,如果为true,任务将被平均分配给核心线程
+         *              如果为false,新建一个线程执行整批任务(前提是线程池小于maxPoolSize),
+         *              否则仍然分配给核心线程
+         *
+         * @return true - 任务全部放入执行队列
+         */
+        virtual bool executeBatch(std::vector<Task>& tasks, bool core = true);
+
+        /**
+         * @brief executeBatch 批量执行任务,无返回值
+         *
+         * @param first 起始迭代器,指向函数或lambda,会被移动
+         * @param last  结束迭代器
+         * @param core  是否使用核心线程
+         *
+         * @return true - 任务全部放入执行队列
+         */
+        template<typename Iterator>
+        bool executeBatch(Iterator first, Iterator last, bool core = true) {
+            std::vector<Task> tasks;
+            tasks.reserve(std::distance(first, last));
+            for (; first != last; ++first) {
+                tasks.emplace_back(std::move(*first));
+            }
+            return executeBatch(tasks, core);
+        }
+
+        /**
+         * @brief submitBulk 批量提交任务,和executeBatch一样只加一次锁和唤醒一次,
+         *                   可以有返回值
+         *                   会抛出异常
+         *
+         * @param fs 要提交的任务(函数或lambda)
+         * @param core 是否使用核心线程
+         *
+         * @return 和fs顺序相同的future
+         */
+        template<typename F>
+        std::vector<std::future<typename std::result_of<F()>::type>>
+        submitBulk(std::vector<F> fs, bool core = true) {
+            using result_type = typename std::result_of<F()>::type;
+            std::vector<std::future<result_type>> res;
+            std::vector<Task> tasks;
+            res.reserve(fs.size());
+            tasks.reserve(fs.size());
+            for (auto& f : fs) {
+                std::packaged_task<result_type()> task(std::move(f));
+                res.push_back(task.get_future());
+                tasks.emplace_back(std::move(task));
             }
+            executeBatch(tasks, core);
             return res;
         }
 
+        /**
+         * @brief ScheduleAwaiter co_await pool.schedule()的等待对象,
+         *                        协程句柄直接放进Task,由线程池的线程恢复,没有future
+         *                        只依赖句柄的resume(),C++11编译时不需要<coroutine>
+         */
+        struct ScheduleAwaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            template<typename Handle>
+            bool await_suspend(Handle handle) {
+                //线程池拒绝时按拒绝策略处理,默认的策略抛出的异常在co_await处重新抛出;
+                //拒绝策略丢弃任务时返回false,协程在当前线程继续执行,
+                //执行了任务(CallerRunsPolicy)时协程已经恢复过,返回true
+                return executor->execute(Task([handle]() mutable {
+                    handle.resume();
+                }));
+            }
+
+            void await_resume() const noexcept {}
+
+            ThreadPoolExecutor* executor;
+        };
+
+        /**
+         * @brief schedule 在协程中使用co_await pool.schedule()切换到线程池的线程继续执行
+         *                 协程和C++20的任务类型见cotask.hpp
+         *
+         * @return 等待对象
+         */
+        ScheduleAwaiter schedule() {
+            return ScheduleAwaiter{this};
+        }
+
         /**
          * @brief toString 返回标识此池的字符串及其状态，包括运行状态和估计的Worker和任务计数的指示
          *
@@ -214,23 +589,104 @@ class ThreadPoolExecutor {
         virtual std::string toString() const;
 
         /**
-         * @brief getActiveCount 返回正在执行任务的线程的大概数量
-         *                       也就是非空闲线程数量
+         * @brief getActiveCount 返回正在执行任务的线程的大概数量,不加锁,O(线程数)
          *
          * @return 线程数
          */
         virtual int getActiveCount() const final;
 
         /**
-         * @brief getTaskCount 得到任务队列大小
+         * @brief getTaskCount 得到所有队列中排队的任务数,读取每个队列的原子计数,不加锁,O(线程数)
          *
          * @return 任务队列大小
          */
         virtual long getTaskCount() const;
 
+        /**
+         * @brief setCpuAffinity 把线程绑定到一组CPU,必须在启动任何线程(提交任务或preStartCoreThreads)前调用,
+         *                       之后线程不加锁读取绑定和节点信息,已经启动过线程时抛出std::logic_error
+         *
+         * @param cpus CPU编号,为空表示不限制
+         * @param pinEachWorker true - 每个线程绑定一个CPU(按队列位置轮流分配),
+         *                      false - 所有线程都可以在这组CPU上运行
+         */
+        virtual void setCpuAffinity(const std::vector<int>& cpus, bool pinEachWorker = true) final;
+
+        /**
+         * @brief setNumaAware 按NUMA节点分组线程,和setCpuAffinity一样必须在启动任何线程前调用,
+         *                     已经启动过线程时抛出std::logic_error
+         *                     第i个线程属于节点i % nodeCount,只在该节点(和setCpuAffinity的交集)的CPU上运行,
+         *                     WorkStealingThreadPoolExecutor先从同一节点的线程窃取
+         *
+         * @param enabled true - 开启
+         * @param topology 拓扑,默认从/sys读取
+         */
+        virtual void setNumaAware(bool enabled, const CpuTopology& topology = CpuTopology()) final;
+
+        /**
+         * @brief getWorkerNode 队列位置对应线程所在的NUMA节点
+         *
+         * @return 节点下标,没有开启NUMA分组或绑定CPU时为0
+         */
+        virtual int getWorkerNode(size_t queueIdex) const final;
+
+        /**
+         * @brief getWorkerCpus 队列位置对应线程绑定的CPU
+         *
+         * @return CPU编号,为空表示不限制
+         */
+        virtual std::vector<int> getWorkerCpus(size_t queueIdex) const final;
+
+        /**
+         * @brief setIdleStrategy 设置线程没有任务时的等待策略,对正在运行的线程也生效
+         *                        自旋可以减少突发任务的唤醒延迟,但会占用CPU
+         *
+         * @param strategy 等待策略
+         */
+        virtual void setIdleStrategy(const IdleStrategy& strategy) final;
+
+        /**
+         * @brief getIdleStrategy 线程没有任务时的等待策略
+         */
+        virtual IdleStrategy getIdleStrategy() const final;
+
+        /**
+         * @brief setPriorityAging 设置老化阈值:有任务的低优先级队列被跳过多少次后优先执行一次
+         *
+         * @param aging 阈值,大于0
+         */
+        virtual void setPriorityAging(unsigned aging) final;
+
+        /**
+         * @brief getPriorityAging 老化阈值
+         */
+        virtual unsigned getPriorityAging() const final;
+
+        /**
+         * @brief setMetricsEnabled 开启或关闭排队时间和执行时间统计
+         *                          完成数,窃取数和拒绝数一直统计;
+         *                          开启后每个任务多读三次时钟,统计只写执行线程自己的数据,没有共享缓存行
+         *
+         * @param enabled true - 开启
+         */
+        virtual void setMetricsEnabled(bool enabled) final;
+
+        /**
+         * @brief isMetricsEnabled 是否开启了时间统计
+         */
+        virtual bool isMetricsEnabled() const final;
+
+        /**
+         * @brief getMetrics 无锁读取所有线程的统计快照,不影响正在执行的线程
+         *                   completed和stolen按线程统计,rejected是整个线程池的计数
+         *
+         * @return 统计快照
+         */
+        virtual ExecutorMetrics getMetrics() const;
+
         /**
          * @brief setMaxPoolSize 设置允许的最大线程数。
-         *                       这将覆盖在构造函数中设置的任何值。
+         *                       不超过构造函数中设置的值,每个线程的队列在构造时分配,之后不再移动。
          *                       如果新值小于当前值，则过多的现有线程在下一个空闲时将被终止
          *
          * @param maxPoolSize 新的最大值
@@ -244,6 +700,13 @@ class ThreadPoolExecutor {
          */
         virtual int getEverPoolSize() const final;
 
+        /**
+         * @brief getQueueCapacity 返回每个任务队列的容量
+         *
+         * @return 容量,0表示无界队列
+         */
+        virtual size_t getQueueCapacity() const final;
+
         /**
          * @brief getCorePoolSize 返回核心线程数
          *
@@ -252,18 +715,49 @@ class ThreadPoolExecutor {
         virtual int getCorePoolSize() const final;
 
         /**
-         * @brief shutdown 不在接受新任务,并且在所有任务执行完后终止线程池
-         *                 如果还有新任务提交将会触发拒绝策略,默认的拒绝策略会抛出异常
+         * @brief shutdown 不在接受新任务,并且在所有任务执行完后终止线程池,不等待
+         *                 如果还有新任务提交将会触发拒绝策略,默认的拒绝策略会抛出异常;
+         *                 休眠的线程被唤醒,执行完自己的任务后帮助执行其他队列中剩下的任务,
+         *                 没有任务时退出,最后一个退出的线程终止线程池;
+         *                 线程池的线程在任务中提交的子任务仍然接受,它们在线程退出前执行完
          */
         virtual void shutdown() final;
 
         /**
-         * @brief stop 不在接受新任务,终止旧任务,释放正在运行的线程
+         * @brief shutdownNow 不在接受新任务,取出所有还没有开始执行的任务并返回,不等待正在执行的任务
+         *                    线程执行完当前任务后退出
+         *
+         * @return 没有执行的任务,每个任务只会被执行或返回一次
+         */
+        virtual std::vector<Task> shutdownNow() final;
+
+        /**
+         * @brief shutdownGracefully 在drainTimeout内等待剩下的任务执行完,超时后调用shutdownNow
+         *                           用于滚动重启等有固定排空时间的场景
+         *
+         * @param drainTimeout 排空时间
+         *
+         * @return 超时后没有执行的任务,按时排空时为空
+         */
+        virtual std::vector<Task> shutdownGracefully(const std::chrono::nanoseconds& drainTimeout) final;
+
+        /**
+         * @brief awaitTermination 等待线程池终止
+         *
+         * @param timeout 最长等待时间
+         *
+         * @return true - 线程池已经终止, false - 超时
+         */
+        virtual bool awaitTermination(const std::chrono::nanoseconds& timeout) final;
+
+        /**
+         * @brief stop 不在接受新任务,丢弃还没有执行的任务,等待正在执行的任务结束后释放所有线程
+         *             不要在线程池的线程内调用
          */
         virtual void stop() final;
 
         /**
-         * @brief isShutDown 判断线程池是否shutdown
+         * @brief isShutDown 判断线程池是否已经关闭(不再接受新任务)
          *
          * @return
          */
@@ -290,7 +784,20 @@ class ThreadPoolExecutor {
          * @param command 要抛弃的任务
          */
         virtual inline void reject(const Runnable & command) final {
-            rejectHandler_->rejectedExecution(command);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            handler()->rejectedExecution(command);
+        }
+
+        /**
+         * @brief reject 把任务交给拒绝策略
+         *
+         * @param task 被拒绝的任务
+         *
+         * @return true - 拒绝策略执行了任务或把任务放入了队列
+         */
+        virtual bool reject(Task& task) final {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return handler()->rejectedExecution(task, *this);
         }
 
     protected:
@@ -299,12 +806,60 @@ class ThreadPoolExecutor {
          */
         virtual void terminated() {}
 
+        /**
+         * @brief onShutdown shutdown和shutdownNow改变运行状态后调用,
+         *                   派生类在这里处理自己保存的任务并唤醒自己的线程
+         */
+        virtual void onShutdown() {}
+
     protected:
         /**
-         * @brief releaseWorkers 释放所有线程(释放线程资源,并弹出线程队列)
+         * @brief releaseWorkers 唤醒并join所有线程,线程池已经不再运行时调用
          */
         virtual void releaseWorkers();
 
+        /**
+         * @brief joinWorkers 析构时调用,关闭线程池并join所有线程,之后线程不再访问线程池的成员
+         *                    派生类的线程使用派生类的成员时,派生类的析构函数也要先调用
+         */
+        void joinWorkers();
+
+        /**
+         * @brief tryTerminate 线程池已经关闭,没有线程并且没有剩下的任务时终止线程池
+         *                     SHUTDOWN状态下先在当前线程执行剩下的任务,STOP状态下等shutdownNow取出
+         */
+        void tryTerminate();
+
+        /**
+         * @brief processWorkerExit 线程退出时减少线程数,最后一个线程终止线程池
+         */
+        void processWorkerExit();
+
+        /**
+         * @brief takeAnyTask 从任意队列取出一个任务,关闭后排空队列使用
+         *
+         * @param task 取出的任务
+         *
+         * @return 是否取到任务
+         */
+        bool takeAnyTask(Task& task);
+
+        /**
+         * @brief retireWorker 非核心线程退出前调用:把Thread移出threads_,
+         *                     线程池还在运行时队列位置留给之后的线程,然后调用processWorkerExit
+         *
+         * @param queueIdex 任务队列位置
+         */
+        void retireWorker(size_t queueIdex);
+
+        /**
+         * @brief acquireSlot 为新的非核心线程取得队列位置,优先复用退出的线程留下的位置
+         *                    调用者需要持有mutex_
+         *
+         * @return 队列位置
+         */
+        size_t acquireSlot();
+
         /**
          * @brief runStateOf 得到线程池状态
          *
@@ -342,12 +897,12 @@ class ThreadPoolExecutor {
         /**
          * @brief addWorker 将任务添加到队列
          *
-         * @param task 任务
+         * @param task 任务,添加失败时不会被移动
          * @param core      是否使用核心线程
          *
          * @return          true - 添加成功
          */
-        virtual bool addWorker(Runnable task, bool core = true);
+        virtual bool addWorker(Task&& task, bool core = true);
 
         /**
             * @brief addWorker 将任务添加到队列
@@ -359,6 +914,50 @@ class ThreadPoolExecutor {
             */
         virtual bool addWorker(Runnable::sptr task, bool core = true);
 
+        /**
+         * @brief startCoreThreads 启动核心线程,直到线程数达到count
+         *
+         * @param count 目标线程数,不会超过corePoolSize
+         *
+         * @return 线程数已启动
+         */
+        virtual int startCoreThreads(int count);
+
+        /**
+         * @brief signalNotEmpty 唤醒所有休眠的线程,用于线程池状态改变
+         */
+        virtual void signalNotEmpty() final;
+
+        /**
+         * @brief signalWorker 任务放入queueIdex队列后唤醒对应的线程,
+         *                     线程没有休眠时什么都不做
+         *
+         * @param queueIdex 线程队列位置
+         */
+        virtual void signalWorker(size_t queueIdex);
+
+        /**
+         * @brief addWorkQueue 为新的非核心线程启用一个预分配的队列位置,调用者需要持有mutex_
+         *
+         * @return 新队列的位置
+         */
+        virtual size_t addWorkQueue() final;
+
+        /**
+         * @brief initWorkQueues 保证每个核心线程都有任务队列,并为非核心线程分配好队列,Parker和统计
+         *
+         * @param workQueue 构造函数传入的任务队列,其中的任务会被转移到workQueues_
+         */
+        virtual void initWorkQueues(const std::vector<BlockingQueue<Runnable::sptr>>& workQueue) final;
+
+        /**
+         * @brief transferTasks 把Runnable::sptr队列中的任务转移到Task队列
+         *
+         * @param from 源队列,转移后为空
+         * @param to 目标队列
+         */
+        static void transferTasks(BlockingQueue<Runnable::sptr>& from, BlockingQueue<Task>& to);
+
         /**
          * @brief advanceRunState 改变线程池状态
          *
@@ -373,6 +972,160 @@ class ThreadPoolExecutor {
          */
         virtual void coreWorkerThread(size_t queueIdex);
 
+        template<typename Predicate>
+        /**
+         * @brief idleWait 按等待策略自旋,条件仍不满足时在自己的Parker上休眠
+         *
+         * @param queueIdex 线程队列位置
+         * @param ready 等待的条件
+         * @param timeout 最长休眠时间,0表示一直休眠
+         */
+        void idleWait(size_t queueIdex, Predicate ready,
+                      std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero()) {
+            Parker& parker = *parkers_[queueIdex];
+            if (parker.spinWait(ready, getIdleStrategy()))
+                return;
+            //休眠前登记,线程内提交任务时只在有线程休眠时才去唤醒
+            parkedWorkers_.fetch_add(1);
+            THREADPOOL_TRACE_EVENT(PARK, 0, static_cast<uint32_t>(queueIdex));
+            if (timeout.count() > 0)
+                parker.parkFor(ready, timeout);
+            else
+                parker.park(ready);
+            THREADPOOL_TRACE_EVENT(UNPARK, 0, static_cast<uint32_t>(queueIdex));
+            parkedWorkers_.fetch_sub(1);
+        }
+
+        /**
+         * @brief 当前线程所属线程池和队列位置,线程池的线程开始时设置
+         */
+        struct LocalWorker {
+            const ThreadPoolExecutor* pool;
+            size_t                    index;
+            ///窃取时随机选择开始位置的种子,0表示还没有初始化
+            uint32_t                  seed;
+        };
+
+        /**
+         * @brief currentLocal 当前线程的LocalWorker
+         */
+        static LocalWorker& currentLocal() {
+            static thread_local LocalWorker local{nullptr, 0, 0};
+            return local;
+        }
+
+        /**
+         * @brief workerLocalQueue 当前线程是本线程池的线程时返回它的本地队列,否则返回nullptr
+         */
+        WorkStealingQueue<LocalTask*>* workerLocalQueue() const {
+            LocalWorker& local = currentLocal();
+            if (local.pool != this || local.index >= localQueues_.size())
+                return nullptr;
+            return localQueues_[local.index].get();
+        }
+
+        /**
+         * @brief pushLocalTask 把任务压入当前线程的本地队列,节点从线程自己的LocalTaskPool分配,
+         *                      计入线程自己的submitted,只能由queueIdex对应的线程调用
+         *
+         * @param queueIdex 当前线程的队列位置
+         * @param task 任务
+         */
+        void pushLocalTask(size_t queueIdex, Task&& task) {
+            localQueues_[queueIdex]->push(localPools_[queueIdex]->acquire(std::move(task)));
+        }
+
+        /**
+         * @brief signalLocalPush 任务压入本地队列并执行seq_cst fence后调用,有线程休眠时最多唤醒count个来窃取
+         *                        线程池的线程提交的任务不经过submitId_和mutex_,
+         *                        也不受任务总数上限限制,否则递归任务可能无法完成
+         *
+         * @param count 压入的任务数
+         */
+        virtual void signalLocalPush(size_t count);
+
+        /**
+         * @brief popLocalTask 从自己的本地队列取出最近提交的任务(LIFO),只能由queueIdex对应的线程调用
+         */
+        bool popLocalTask(size_t queueIdex, Task& task);
+
+        /**
+         * @brief stealLocalTask 从其他线程的本地队列窃取最早提交的任务(FIFO)
+         *
+         * @param queueIdex 当前线程的队列位置,不从自己窃取
+         */
+        bool stealLocalTask(size_t queueIdex, Task& task);
+
+        /**
+         * @brief hasLocalTask 是否有线程的本地队列中有任务
+         */
+        bool hasLocalTask() const;
+
+        /**
+         * @brief signalParkedWorker 唤醒一个休眠的线程
+         *
+         * @param self 当前线程的队列位置,从它的下一个位置开始找
+         *
+         * @return true - 唤醒了一个线程
+         */
+        bool signalParkedWorker(size_t self);
+
+        /**
+         * @brief bindWorker 按setCpuAffinity和setNumaAware绑定当前线程,线程开始时调用
+         *
+         * @param queueIdex 线程队列位置
+         */
+        void bindWorker(size_t queueIdex);
+
+        /**
+         * @brief checkNoWorkers 已经启动过线程时抛出std::logic_error,持有mutex_时调用
+         */
+        void checkNoWorkers() const;
+
+        /**
+         * @brief updatePlacement 重新计算每个队列位置所在的节点
+         */
+        void updatePlacement();
+
+        /**
+         * @brief pollTask 按优先级从线程自己的队列取出任务,只能由queueIdex对应的线程调用
+         *
+         * @param queueIdex 任务队列位置
+         * @param task 取出的任务
+         *
+         * @return true - 取到任务
+         */
+        bool pollTask(size_t queueIdex, Task& task);
+
+        /**
+         * @brief stealTask 按优先级从queueIdex的队列取出任务,不更新老化计数,其他线程可以调用
+         */
+        bool stealTask(size_t queueIdex, Task& task);
+
+        /**
+         * @brief hasQueuedTask queueIdex的各个优先级队列中是否有任务
+         */
+        bool hasQueuedTask(size_t queueIdex) const;
+
+        /**
+         * @brief markEnqueued 开启时间统计时记录任务的入队时间
+         *
+         * @param task 要入队的任务
+         */
+        inline void markEnqueued(Task& task) const {
+            if (metricsEnabled_.load(std::memory_order_relaxed))
+                task.setEnqueueTime(metricsNow());
+            THREADPOOL_TRACE_SUBMIT(task);
+        }
+
+        /**
+         * @brief runWorkerTask 执行任务并更新线程自己的统计
+         *
+         * @param task 要执行的任务
+         * @param metrics 执行线程的统计,nullptr表示不是线程池的线程
+         */
+        void runWorkerTask(Task& task, WorkerMetrics* metrics);
+
         /**
          * @brief workerThread 非核心线程循环
          *
@@ -380,15 +1133,131 @@ class ThreadPoolExecutor {
          */
         virtual void workerThread(size_t queueIdex);
 
+        /**
+         * @brief elasticWorkerThread 弹性伸缩的非核心线程循环:执行自己队列的任务,
+         *                            再从核心线程的队列窃取,空闲keepAlive后退出
+         *
+         * @param queueIdex 任务队列位置
+         */
+        virtual void elasticWorkerThread(size_t queueIdex);
+
+        /**
+         * @brief maybeGrow 排队时间超过阈值时按growInterval限速增加线程,先唤醒休眠的非核心线程
+         *
+         * @param delay 排队时间,取这个任务和移动平均中较小的一个
+         * @param now 当前时间(metricsNow)
+         */
+        void maybeGrow(int64_t delay, int64_t now);
+
+        /**
+         * @brief addElasticWorker 启动一个弹性伸缩的非核心线程,优先复用已经退出的线程的队列位置
+         *
+         * @return true - 启动了新线程
+         */
+        bool addElasticWorker();
+
+        /**
+         * @brief attachElasticWorker 非核心线程开始时找到自己的Thread,用于记录活跃时间
+         *
+         * @return 当前线程的Thread,已经被releaseWorkers移出时为nullptr
+         */
+        Thread* attachElasticWorker();
+
+        /**
+         * @brief retireElasticWorker 弹性伸缩的非核心线程退出前调用,运行时记录一次退出,然后调用retireWorker
+         *
+         * @param queueIdex 任务队列位置
+         */
+        void retireElasticWorker(size_t queueIdex);
+
+        /**
+         * @brief elasticIdleTimeout 非核心线程还可以空闲多久
+         *
+         * @param self 当前线程的Thread
+         *
+         * @return 不大于0时应该退出
+         */
+        std::chrono::nanoseconds elasticIdleTimeout(const Thread* self) const;
+
         /**
          * @brief reject 将任务抛弃
          *
          * @param command 要抛弃的任务
          */
         virtual inline void reject(const Runnable::sptr command) final {
-            rejectHandler_->rejectedExecution(command);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            handler()->rejectedExecution(command);
+        }
+
+        /**
+         * @brief handler 当前的拒绝策略,可以和setRejectedExecutionHandler同时调用
+         */
+        std::shared_ptr<RejectedExecutionHandler> handler() const {
+            return std::atomic_load(&rejectHandler_);
         }
 
+        /**
+         * @brief admit 外部提交任务前的准入检查,通过时占用count个位置
+         *
+         * @param count 任务数
+         *
+         * @return false - 任务数达到上限或拒绝策略的admit拒绝
+         */
+        bool admit(size_t count);
+
+        /**
+         * @brief acquireTasks 不检查上限,占用count个位置,用于构造时转入的任务和没有上限时的外部提交
+         */
+        inline void acquireTasks(size_t count) {
+            pendingTasks_.fetch_add(count);
+        }
+
+        /**
+         * @brief releaseTasks 任务在线程池外执行完或被丢弃后释放位置,有offer在等待时唤醒它
+         */
+        inline void releaseTasks(size_t count) {
+            pendingTasks_.fetch_sub(count);
+            if (admissionWaiters_.load() > 0)
+                signalAdmission();
+        }
+
+        /**
+         * @brief releaseWorkerTask 线程池的线程执行完任务,只修改线程自己的completed
+         *
+         * @param metrics 执行线程的统计
+         */
+        inline void releaseWorkerTask(WorkerMetrics* metrics) {
+            WorkerMetrics::increment(metrics->completed);
+            //有任务总数上限时和offer登记等待者配对,要么这里看到等待者,要么offer看到新的completed
+            if (taskCapacity_.load(std::memory_order_relaxed) != 0)
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (admissionWaiters_.load(std::memory_order_relaxed) > 0)
+                signalAdmission();
+        }
+
+        /**
+         * @brief collectWorkerTasks 所有线程压入本地队列的任务数和执行完的任务数,
+         *                           和pendingTasks_相加后得到还没有执行完的任务数
+         */
+        void collectWorkerTasks(uint64_t& submitted, uint64_t& completed) const;
+
+        /**
+         * @brief signalAdmission 唤醒在offer中等待的线程
+         */
+        void signalAdmission();
+
+        /**
+         * @brief revokeLocalPush 压入本地队列后发现线程池已经stop时取回刚压入的任务
+         *                        调用者压入后执行seq_cst fence,shutdownNow先修改状态再取出任务,
+         *                        两边至少有一边看到对方
+         *
+         * @param queue 当前线程的本地队列
+         * @param task 取回的任务
+         *
+         * @return true - 取回了任务,需要交给拒绝策略;false - 任务已经被取走
+         */
+        bool revokeLocalPush(WorkStealingQueue<LocalTask*>* queue, Task& task);
+
         /**
          * @brief isRunning 是否还在运行
          *
@@ -456,6 +1325,56 @@ class ThreadPoolExecutor {
             } while (!compareAndDecrementWorkerCount(ctl_.load()));
         }
 
+    protected:
+        /**
+         * @brief SubmitGuard 外部提交从检查状态到放入队列期间持有,
+         *                    shutdownNow等待所有持有者离开后才认为队列中不会再出现新任务
+         */
+        struct SubmitGuard {
+            explicit SubmitGuard(std::atomic<int>& submitters)
+                : submitters_(submitters) {
+                submitters_.fetch_add(1);
+            }
+
+            ~SubmitGuard() {
+                submitters_.fetch_sub(1);
+            }
+
+            std::atomic<int>& submitters_;
+
+            SubmitGuard(const SubmitGuard&) = delete;
+            SubmitGuard& operator=(const SubmitGuard&) = delete;
+        };
+
+        /**
+         * @brief 核心线程的高优先级和低优先级队列,普通优先级使用workQueues_
+         */
+        struct PriorityQueues {
+            explicit PriorityQueues(size_t capacity)
+                : high(capacity),
+                  low(capacity) {}
+
+            BlockingQueue<Task> high;
+            BlockingQueue<Task> low;
+            ///high和low中的任务数,放入前增加,为0时取任务不需要检查这两个队列
+            std::atomic<int>    pending{0};
+            char                pad0_[64];
+            ///每个优先级有任务但被跳过的次数,只由所属线程读写
+            unsigned            skipped[3] = {0, 0, 0};
+            char                pad1_[64];
+        };
+
+        /**
+         * @brief levelQueue 优先级对应的队列,queueIdex必须是核心线程
+         */
+        BlockingQueue<Task>& levelQueue(size_t queueIdex, int level) {
+            if (level == static_cast<int>(TaskPriority::HIGH))
+                return priorityQueues_[queueIdex]->high;
+            if (level == static_cast<int>(TaskPriority::LOW))
+                return priorityQueues_[queueIdex]->low;
+            return workQueues_[queueIdex];
+        }
+
     protected:
         ///初始化使用
         const int32_t COUNT_BITS = 29;
@@ -472,31 +1391,120 @@ class ThreadPoolExecutor {
         ///线程池关闭,terminated()函数已经执行
         const int32_t TERMINATED = 3 << COUNT_BITS;
 
+        //成员按写入频率分组:只读为主的配置,每个线程的记录,提交和完成时修改的控制变量,mutex_保护的状态
+        //经常被不同线程修改的变量前后各填充一个缓存行,线程池对象可能在栈上或者堆上,不依赖对齐
+
         ///核心线程数
         int											                 corePoolSize_;
         ///最大线程数
-        int											                 maxPoolSize_;
-        ///提交任务的id
-        unsigned int                                                 submitId_{0};
+        std::atomic<int>                                             maxPoolSize_;
+        ///构造时的最大线程数,队列位置按它分配,setMaxPoolSize不能超过
+        int                                                          maxPoolSizeLimit_{0};
         ///线程名前缀
         std::string                                                  prefix_;
+        ///任务队列容量,0表示无界队列
+        size_t                                                       queueCapacity_{0};
+        ///拒绝策略回调,通过std::atomic_load/atomic_store替换
+        std::shared_ptr<RejectedExecutionHandler>	                 rejectHandler_;
         ///是否允许非核心线程超时
-        volatile bool                                                keepNonCoreThreadAlive_{false};
-        ///曾经出现的线程数量,包括已经死亡的
-        std::atomic<int>                                             everPoolSize_{0};
+        std::atomic<bool>                                            keepNonCoreThreadAlive_{false};
+        ///是否统计排队时间和执行时间
+        std::atomic<bool>                                            metricsEnabled_{false};
+        ///等待策略:最长自旋时间(纳秒),yield次数,是否自适应
+        std::atomic<int64_t>                                         idleSpinNs_{0};
+        std::atomic<unsigned>                                        idleYields_{0};
+        std::atomic<bool>                                            idleAdaptive_{true};
+        ///老化阈值
+        std::atomic<unsigned>                                        priorityAging_{8};
+        ///线程可以使用的CPU,为空表示不限制
+        std::vector<int>                                             cpuSet_;
+        ///每个线程绑定一个CPU
+        bool                                                         pinEachWorker_{false};
+        ///CPU拓扑,开启NUMA分组或绑定CPU后才读取
+        std::unique_ptr<CpuTopology>                                 topology_;
+        ///是否按NUMA节点分组
+        bool                                                         numaAware_{false};
+        ///每个队列位置所在的节点,在线程启动前计算,之后只读,不加锁读取
+        std::vector<int>                                             workerNodes_;
+        ///任务总数上限,0表示不限制
+        std::atomic<size_t>                                          taskCapacity_{0};
+        ///拒绝策略是否需要准入检查,避免每次提交都读取拒绝策略
+        std::atomic<bool>                                            checksAdmission_{false};
+        ///是否开启弹性伸缩
+        std::atomic<bool>                                            elastic_{false};
+        ///弹性伸缩策略(纳秒)
+        std::atomic<int64_t>                                         growThresholdNs_{0};
+        std::atomic<int64_t>                                         keepAliveNs_{0};
+        std::atomic<int64_t>                                         growIntervalNs_{0};
+
+        //每个线程的记录,vector本身只在增加线程时修改,元素各自填充,相邻线程的记录不共享缓存行
+        ///任务队列,构造时按最大线程数分配,之后不再改变
+        std::vector<BlockingQueue<Task>>	                         workQueues_;
+        ///每个线程休眠用的Parker,下标和workQueues_相同,构造后不再改变
+        std::vector<std::unique_ptr<Parker>>                         parkers_;
+        ///每个线程的本地队列,线程池的线程提交的任务压入这里,下标和workQueues_相同,构造后不再改变
+        std::vector<std::unique_ptr<WorkStealingQueue<LocalTask*>>>  localQueues_;
+        ///每个线程本地队列的节点缓存,下标和workQueues_相同,构造后不再改变
+        std::vector<std::unique_ptr<LocalTaskPool>>                  localPools_;
+        ///每个线程的统计,下标和workQueues_相同,构造后不再改变
+        std::vector<std::unique_ptr<WorkerMetrics>>                  workerMetrics_;
+        ///已经启用的队列位置数,只在mutex_内增加,getMetrics,getTaskCount和getActiveCount不加锁读取
+        std::atomic<size_t>                                          slotCount_{0};
+        ///核心线程的高低优先级队列,下标和workQueues_相同
+        std::vector<std::unique_ptr<PriorityQueues>>                 priorityQueues_;
+
+        char                                                         ctlPad_[64];
+        ///控制变量,每次提交都读取,增加和退出线程时修改
+        std::atomic_int32_t                                          ctl_;
+        char                                                         submitIdPad_[64];
+        ///提交任务的id,用来轮流选择队列,每次外部提交都原子递增,不受mutex_保护
+        std::atomic<unsigned int>                                    submitId_{0};
+        char                                                         pendingPad_[64];
+        ///线程池外提交的任务数减去在线程池外执行完或丢弃的任务数,线程池的线程提交和执行完的任务
+        ///记在自己的WorkerMetrics中,只在检查上限和终止时求和;单独看可能"小于0"(按无符号回绕)
+        std::atomic<size_t>                                          pendingTasks_{0};
+        char                                                         submittersPad_[64];
+        ///正在把任务放入队列的外部提交者数
+        std::atomic<int>                                             submitters_{0};
+        char                                                         parkedPad_[64];
+        ///正在休眠的线程数,为0时压入本地队列不需要唤醒
+        std::atomic<int>                                             parkedWorkers_{0};
+        char                                                         mutexPad_[64];
         ///队列锁
         mutable std::mutex                                           mutex_;
-        ///控制变量
-        std::atomic_int32_t                                          ctl_;
-        ///队列非空条件变量
-        std::condition_variable                                      notEmpty_;
+        ///曾经出现的线程数量,包括已经死亡的
+        std::atomic<int>                                             everPoolSize_{0};
         ///线程队列
         std::vector<Thread::sptr>                                    threads_;
-        ///任务队列
-        std::vector<BlockingQueue<Runnable::sptr>>	                 workQueues_;
-        ///拒绝策略回调
-        std::unique_ptr<RejectedExecutionHandler>	                 rejectHandler_;
+        ///已经退出的非核心线程留下的队列位置,受mutex_保护
+        std::vector<size_t>                                          freeSlots_;
+        ///已经退出还没有join的非核心线程,受mutex_保护,下次增加线程时释放
+        std::vector<Thread::sptr>                                    retiredThreads_;
+        char                                                         coldPad_[64];
+        ///被拒绝的任务数,线程池共用一个计数,只在拒绝时修改,放在不常修改的变量中
+        std::atomic<uint64_t>                                        rejected_{0};
+        ///在offer中等待空位的线程数
+        std::atomic<int>                                             admissionWaiters_{0};
+        std::mutex                                                   admissionMutex_;
+        std::condition_variable                                      admissionCond_;
+        ///上一次尝试增加线程的时间,用于限速
+        std::atomic<int64_t>                                         lastGrowTime_{0};
+        ///增加和退出线程的次数
+        std::atomic<uint64_t>                                        growCount_{0};
+        std::atomic<uint64_t>                                        shrinkCount_{0};
+        ///等待线程池终止
+        std::mutex                                                   terminationMutex_;
+        std::condition_variable                                      terminationCond_;
+        char                                                         endPad_[64];
 
 };
 
+inline bool RejectedExecutionHandler::rejectedExecution(Task& task, ThreadPoolExecutor& executor) {
+    if (!executor.isRunning()) {
+        rejectedExecution(Runnable(std::move(task)));
+        return false;
+    }
+    throw std::runtime_error("thread pool task capacity reached");
+}
+
 #endif /* THREADPOOLEXECUTOR_HPP */
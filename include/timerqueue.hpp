@@ -0,0 +1,263 @@
+#ifndef TIMERQUEUE_HPP
+#define TIMERQUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <list>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "runnable.hpp"
+
+/**
+ * @brief 定时任务封装
+ */
+struct TimerTask : public Runnable {
+    /**
+     * @brief 任务状态,SCHEDULED和RUNNING之间的转换都在线程池的mutex_中进行
+     */
+    enum State { SCHEDULED, RUNNING, DONE, CANCELLED };
+
+    template<typename F>
+    /**
+     * @brief TimerTask 构造函数
+     *
+     * @param initDelay 第一次调用的延迟
+     * @param interval 每次调用间隔
+     * @param fixedRate 是否等间隔运行,true执行间隔确定,false每次调用经过相同延迟
+     * @param f lambda或Runnable
+     */
+    TimerTask(const std::chrono::nanoseconds& initDelay,
+              const std::chrono::nanoseconds& interval,
+              bool fixedRate, F&& f)
+        : Runnable(std::move(f)),
+          initialDelay_(initDelay),
+          interval_(interval),
+          fixedRate_(fixedRate),
+          callTime_(std::chrono::steady_clock::now() + initDelay) {}
+
+    /**
+     * @brief TimerTask 拷贝构造
+     *
+     * @param rh 另一个TimerTask
+     */
+    explicit TimerTask(const TimerTask& rh)
+        : initialDelay_(rh.initialDelay_),
+          interval_(rh.interval_),
+          fixedRate_(rh.fixedRate_),
+          callTime_(rh.callTime_) {}
+
+    /**
+     * @brief TimerTask 默认构造
+     */
+    TimerTask() = default;
+
+    /**
+     * @brief operator= 赋值运算符
+     *
+     * @param rh 另一个TimerTask
+     *
+     * @return TimerTask&
+     */
+    TimerTask& operator=(const TimerTask& rh) {
+        initialDelay_ = rh.initialDelay_;
+        interval_ = rh.interval_;
+        fixedRate_ = rh.fixedRate_;
+        callTime_ = rh.callTime_;
+        return *this;
+    }
+
+    /**
+     * @brief operator() 执行任务,和Runnable不同,执行后保留函数包装器,周期任务可以再次执行
+     */
+    virtual void operator()() override {
+        if (functor_ != nullptr) {
+            functor_->call();
+        }
+    }
+
+    /**
+     * @brief isPeriodic 是否是周期任务,interval_为0时只执行一次
+     */
+    bool isPeriodic() const {
+        return interval_.count() > 0;
+    }
+
+    /**
+     * @brief release 取消时释放函数包装器和done_,
+     *                等待结果的std::future会得到broken_promise
+     */
+    void release() {
+        functor_.reset();
+        done_.reset();
+    }
+
+    ///初次延迟
+    std::chrono::nanoseconds initialDelay_{0};
+    ///固定延迟或间隔
+    std::chrono::nanoseconds interval_{0};
+    ///是否是固定间隔执行
+    bool fixedRate_;
+    ///下次执行时间
+    std::chrono::steady_clock::time_point callTime_;
+    ///所在的时间轮槽位,位置和层级,由TimingWheel维护,不在时间轮中时为nullptr
+    std::list<std::shared_ptr<TimerTask>>*           wheelSlot_{nullptr};
+    std::list<std::shared_ptr<TimerTask>>::iterator  wheelPos_;
+    int                                              wheelLevel_{-1};
+    ///任务状态
+    std::atomic<int>                                 state_{SCHEDULED};
+    ///周期任务和通过shared_ptr<TimerTask>提交的任务,ScheduledFuture等待的完成通知
+    std::unique_ptr<std::promise<void>>              done_;
+};
+
+/**
+ * @brief TimerQueue 定时任务队列接口,按callTime_取出到期的任务
+ *                   不是线程安全的,由调用者加锁
+ */
+class TimerQueue {
+    public:
+        using time_point = std::chrono::steady_clock::time_point;
+
+        virtual ~TimerQueue() = default;
+
+        /**
+         * @brief push 插入任务,按任务的callTime_排序
+         *
+         * @param task 定时任务
+         */
+        virtual void push(const std::shared_ptr<TimerTask>& task) = 0;
+
+        /**
+         * @brief remove 移除还没有到期的任务,调用前任务状态已经设置为CANCELLED
+         *
+         * @param task 定时任务
+         *
+         * @return true - 任务在队列中并被移除
+         */
+        virtual bool remove(const std::shared_ptr<TimerTask>& task) = 0;
+
+        /**
+         * @brief poll 取出一个在now之前到期的任务
+         *
+         * @param now 当前时间
+         *
+         * @return 到期的任务,没有时返回nullptr
+         */
+        virtual std::shared_ptr<TimerTask> poll(time_point now) = 0;
+
+        /**
+         * @brief nextExpiry 下次需要检查的时间,不会晚于最早的任务到期时间
+         *
+         * @return 队列为空时返回time_point::max()
+         */
+        virtual time_point nextExpiry() const = 0;
+
+        /**
+         * @brief size 任务个数
+         */
+        virtual size_t size() const = 0;
+
+        /**
+         * @brief drain 取出所有没有取消的任务,线程池关闭时调用
+         *
+         * @return 队列中剩下的任务
+         */
+        virtual std::vector<std::shared_ptr<TimerTask>> drain() {
+            std::vector<std::shared_ptr<TimerTask>> tasks;
+            while (std::shared_ptr<TimerTask> task = poll(time_point::max()))
+                tasks.push_back(std::move(task));
+            return tasks;
+        }
+};
+
+/**
+ * @brief HeapTimerQueue 小顶堆实现,插入和取出O(log n)
+ *                       取消堆顶时立即弹出,其他任务延迟删除:
+ *                       取出时跳过,被取消的任务超过一半时重建堆
+ */
+class HeapTimerQueue : public TimerQueue {
+    private:
+        /**
+         * @brief 小顶堆比较操作
+         */
+        struct Comp {
+            public:
+                bool operator()(const std::shared_ptr<TimerTask>& t1, const std::shared_ptr<TimerTask>& t2) {
+                    return t1->callTime_ > t2->callTime_;
+                }
+        };
+
+    public:
+        virtual void push(const std::shared_ptr<TimerTask>& task) override {
+            timerTasks_.push_back(task);
+            std::push_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
+        }
+
+        virtual bool remove(const std::shared_ptr<TimerTask>& task) override {
+            if (timerTasks_.empty())
+                return false;
+            if (timerTasks_.front() == task) {
+                std::pop_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
+                timerTasks_.pop_back();
+                dropCancelledHead();
+                return true;
+            }
+            if (++cancelled_ * 2 > timerTasks_.size())
+                purge();
+            return true;
+        }
+
+        virtual std::shared_ptr<TimerTask> poll(time_point now) override {
+            if (timerTasks_.empty() || timerTasks_.front()->callTime_ > now)
+                return nullptr;
+            std::shared_ptr<TimerTask> task = timerTasks_.front();
+            std::pop_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
+            timerTasks_.pop_back();
+            dropCancelledHead();
+            return task;
+        }
+
+        virtual time_point nextExpiry() const override {
+            return timerTasks_.empty() ? time_point::max() : timerTasks_.front()->callTime_;
+        }
+
+        virtual size_t size() const override {
+            return timerTasks_.size() - cancelled_;
+        }
+
+    private:
+        /**
+         * @brief dropCancelledHead 弹出堆顶已经取消的任务,保证堆顶总是有效任务,
+         *                          nextExpiry不会因为取消的任务唤醒线程
+         */
+        void dropCancelledHead() {
+            while (!timerTasks_.empty() &&
+                    timerTasks_.front()->state_.load() == TimerTask::CANCELLED) {
+                std::pop_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
+                timerTasks_.pop_back();
+                --cancelled_;
+            }
+        }
+
+        /**
+         * @brief purge 删除所有取消的任务并重建堆
+         */
+        void purge() {
+            timerTasks_.erase(std::remove_if(timerTasks_.begin(), timerTasks_.end(),
+            [](const std::shared_ptr<TimerTask>& e) {
+                return e->state_.load() == TimerTask::CANCELLED;
+            }), timerTasks_.end());
+            std::make_heap(timerTasks_.begin(), timerTasks_.end(), Comp());
+            cancelled_ = 0;
+        }
+
+    private:
+        ///定时任务小顶堆
+        std::vector<std::shared_ptr<TimerTask>> timerTasks_;
+        ///堆中已经取消但还没有删除的任务个数
+        size_t                                  cancelled_{0};
+};
+
+#endif /* TIMERQUEUE_HPP */
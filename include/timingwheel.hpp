@@ -0,0 +1,279 @@
+#ifndef TIMINGWHEEL_HPP
+#define TIMINGWHEEL_HPP
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include "timerqueue.hpp"
+
+/**
+ * @brief TimingWheel 分层时间轮,插入和取消O(1),每个tick的开销和任务总数无关
+ *                    第0层每个槽位是一个tick,第l层每个槽位是SLOTS^l个tick,
+ *                    任务按到期tick和当前tick的差放入对应层级,
+ *                    低层转完一圈时把高层对应槽位的任务重新分配到低层(cascade)
+ *                    任务按tick取整,最多晚一个tick到期,不会提前
+ *                    超过最大范围的任务先放在最高层,cascade时重新计算位置
+ */
+class TimingWheel : public TimerQueue {
+    public:
+        ///层数
+        static constexpr int      LEVELS    = 4;
+        ///每层槽位数的位数
+        static constexpr int      SLOT_BITS = 6;
+        ///每层槽位数
+        static constexpr uint64_t SLOTS     = 1 << SLOT_BITS;
+        static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+
+    private:
+        using Slot = std::list<std::shared_ptr<TimerTask>>;
+
+    public:
+        /**
+         * @brief TimingWheel 构造函数
+         *
+         * @param tick 每个tick的时间,也是定时精度,默认1毫秒,
+         *             4层64槽位可以覆盖2^24个tick(1毫秒时约4.6小时),超出的任务会多cascade几次
+         */
+        explicit TimingWheel(const std::chrono::nanoseconds& tick = std::chrono::milliseconds(1))
+            : tick_(tick),
+              start_(std::chrono::steady_clock::now()) {
+            if (tick_.count() <= 0)
+                throw std::logic_error("TimingWheel tick must be greater than 0");
+        }
+
+        /**
+         * @brief ~TimingWheel 析构函数,清除剩余任务的槽位信息
+         */
+        virtual ~TimingWheel() {
+            for (int l = 0; l < LEVELS; ++l) {
+                for (uint64_t i = 0; i < SLOTS; ++i) {
+                    detachAll(slots_[l][i]);
+                }
+            }
+            detachAll(ready_);
+        }
+
+        virtual void push(const std::shared_ptr<TimerTask>& task) override {
+            if (task->wheelSlot_ != nullptr)
+                throw std::logic_error("TimerTask is already in a TimingWheel");
+            place(task, tickOf(task->callTime_));
+            ++count_;
+        }
+
+        virtual bool remove(const std::shared_ptr<TimerTask>& task) override {
+            if (task->wheelSlot_ == nullptr)
+                return false;
+            if (task->wheelLevel_ >= 0)
+                --levelCount_[task->wheelLevel_];
+            //erase会释放list中的shared_ptr,先保留一个引用
+            std::shared_ptr<TimerTask> guard(task);
+            task->wheelSlot_->erase(task->wheelPos_);
+            task->wheelSlot_ = nullptr;
+            task->wheelLevel_ = -1;
+            --count_;
+            return true;
+        }
+
+        virtual std::shared_ptr<TimerTask> poll(time_point now) override {
+            advance(now);
+            if (ready_.empty())
+                return nullptr;
+            std::shared_ptr<TimerTask> task = std::move(ready_.front());
+            ready_.pop_front();
+            task->wheelSlot_ = nullptr;
+            --count_;
+            return task;
+        }
+
+        virtual time_point nextExpiry() const override {
+            if (!ready_.empty())
+                return timeOf(current_);
+            uint64_t next = nextEventTick();
+            if (next == std::numeric_limits<uint64_t>::max())
+                return time_point::max();
+            return timeOf(next);
+        }
+
+        virtual size_t size() const override {
+            return count_;
+        }
+
+        /**
+         * @brief drain 不推进时间轮,直接取出所有槽位中的任务,之后放入的任务按原来的tick计算位置
+         */
+        virtual std::vector<std::shared_ptr<TimerTask>> drain() override {
+            std::vector<std::shared_ptr<TimerTask>> tasks;
+            tasks.reserve(count_);
+            for (int l = 0; l < LEVELS; ++l) {
+                for (uint64_t i = 0; i < SLOTS; ++i) {
+                    take(slots_[l][i], tasks);
+                }
+                levelCount_[l] = 0;
+            }
+            take(ready_, tasks);
+            count_ = 0;
+            return tasks;
+        }
+
+        /**
+         * @brief getTick 每个tick的时间
+         */
+        std::chrono::nanoseconds getTick() const {
+            return tick_;
+        }
+
+    private:
+        /**
+         * @brief tickOf 时间点对应的tick,向上取整,保证任务不会提前到期
+         */
+        uint64_t tickOf(time_point t) const {
+            if (t <= start_)
+                return 0;
+            uint64_t ns = static_cast<uint64_t>((t - start_).count());
+            uint64_t tick = static_cast<uint64_t>(tick_.count());
+            return (ns + tick - 1) / tick;
+        }
+
+        /**
+         * @brief timeOf tick对应的时间点
+         */
+        time_point timeOf(uint64_t tick) const {
+            return start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                       tick_ * static_cast<int64_t>(tick));
+        }
+
+        /**
+         * @brief place 按到期tick放入对应层级的槽位,已经到期的放入ready_
+         */
+        void place(const std::shared_ptr<TimerTask>& task, uint64_t expiry) {
+            if (expiry <= current_) {
+                link(task, ready_, -1);
+                return;
+            }
+            uint64_t delta = expiry - current_;
+            int level = 0;
+            while (level < LEVELS - 1 && delta >= (SLOTS << (SLOT_BITS * level)))
+                ++level;
+            if (delta >= (SLOTS << (SLOT_BITS * level))) {
+                //超出最大范围,放在最高层最远的槽位,cascade时重新计算
+                expiry = current_ + (SLOTS << (SLOT_BITS * level)) - 1;
+            }
+            uint64_t index = (expiry >> (SLOT_BITS * level)) & SLOT_MASK;
+            link(task, slots_[level][index], level);
+            ++levelCount_[level];
+        }
+
+        void link(const std::shared_ptr<TimerTask>& task, Slot& slot, int level) {
+            slot.push_back(task);
+            task->wheelSlot_ = &slot;
+            task->wheelPos_ = std::prev(slot.end());
+            task->wheelLevel_ = level;
+        }
+
+        static void detachAll(Slot& slot) {
+            for (auto& e : slot) {
+                e->wheelSlot_ = nullptr;
+                e->wheelLevel_ = -1;
+            }
+        }
+
+        static void take(Slot& slot, std::vector<std::shared_ptr<TimerTask>>& tasks) {
+            detachAll(slot);
+            for (auto& e : slot) {
+                tasks.push_back(std::move(e));
+            }
+            slot.clear();
+        }
+
+        /**
+         * @brief nextEventTick 下一个需要处理的tick:第0层最近的非空槽位或者高层的cascade时刻
+         *
+         * @return 时间轮为空时返回uint64_t最大值
+         */
+        uint64_t nextEventTick() const {
+            uint64_t next = std::numeric_limits<uint64_t>::max();
+            if (levelCount_[0] > 0) {
+                for (uint64_t i = 1; i < SLOTS; ++i) {
+                    if (!slots_[0][(current_ + i) & SLOT_MASK].empty()) {
+                        next = current_ + i;
+                        break;
+                    }
+                }
+            }
+            for (int l = 1; l < LEVELS; ++l) {
+                if (levelCount_[l] > 0) {
+                    int shift = SLOT_BITS * l;
+                    next = std::min(next, ((current_ >> shift) + 1) << shift);
+                }
+            }
+            return next;
+        }
+
+        /**
+         * @brief cascade 把第level层当前槽位的任务重新放入低层
+         */
+        void cascade(int level) {
+            Slot slot;
+            slot.swap(slots_[level][(current_ >> (SLOT_BITS * level)) & SLOT_MASK]);
+            levelCount_[level] -= slot.size();
+            for (auto& e : slot) {
+                e->wheelSlot_ = nullptr;
+                place(e, tickOf(e->callTime_));
+            }
+        }
+
+        /**
+         * @brief advance 推进到now,到期的任务移到ready_
+         *                跳过没有任务的tick,空闲很久之后也不会逐个tick推进
+         */
+        void advance(time_point now) {
+            if (now <= start_)
+                return;
+            uint64_t target = static_cast<uint64_t>((now - start_).count()) /
+                              static_cast<uint64_t>(tick_.count());
+            while (current_ < target) {
+                uint64_t next = nextEventTick();
+                if (next > target) {
+                    current_ = target;
+                    break;
+                }
+                current_ = next;
+                //从高层到低层cascade,高层落下来的任务可能还要继续落到更低层
+                for (int l = LEVELS - 1; l > 0; --l) {
+                    if ((current_ & ((uint64_t(1) << (SLOT_BITS * l)) - 1)) == 0)
+                        cascade(l);
+                }
+                Slot& slot = slots_[0][current_ & SLOT_MASK];
+                levelCount_[0] -= slot.size();
+                for (auto& e : slot) {
+                    e->wheelSlot_ = &ready_;
+                    e->wheelLevel_ = -1;
+                }
+                //splice不会使迭代器失效,wheelPos_仍然有效
+                ready_.splice(ready_.end(), slot);
+            }
+        }
+
+    private:
+        ///每个tick的时间
+        std::chrono::nanoseconds          tick_;
+        ///tick 0对应的时间点
+        time_point                        start_;
+        ///当前tick,之前的槽位都已经处理
+        uint64_t                          current_{0};
+        ///所有任务个数,包括ready_
+        size_t                            count_{0};
+        ///每层的任务个数,用来跳过空的层
+        size_t                            levelCount_[LEVELS] = {0, 0, 0, 0};
+        ///槽位
+        Slot                              slots_[LEVELS][SLOTS];
+        ///已经到期还没有被取出的任务
+        Slot                              ready_;
+
+    public:
+        TimingWheel(const TimingWheel&) = delete;
+        TimingWheel& operator=(const TimingWheel&) = delete;
+};
+
+#endif /* TIMINGWHEEL_HPP */
@@ -0,0 +1,153 @@
+#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+/**
+ * @brief CpuTopology CPU和NUMA节点的对应关系
+ *                    Linux下从/sys/devices/system/node读取,
+ *                    读取失败时所有可用CPU属于节点0
+ */
+class CpuTopology {
+    public:
+        /**
+         * @brief CpuTopology 构造函数,读取当前机器的拓扑
+         */
+        CpuTopology() {
+            detect("/sys/devices/system/node");
+        }
+
+        /**
+         * @brief CpuTopology 构造函数,使用给定的节点,用于测试或手动指定拓扑
+         *
+         * @param nodes 每个节点的CPU编号,不要求有序,保存时排序去重
+         */
+        explicit CpuTopology(const std::vector<std::vector<int>>& nodes)
+            : nodes_(nodes) {
+            //nodeOfCpu二分查找,和parseCpuList的结果一样保持有序
+            for (auto& e : nodes_) {
+                std::sort(e.begin(), e.end());
+                e.erase(std::unique(e.begin(), e.end()), e.end());
+            }
+            if (nodes_.empty())
+                nodes_.push_back(availableCpus());
+        }
+
+        /**
+         * @brief parseCpuList 解析"0-3,8,10-11"格式的CPU列表
+         *
+         * @param list CPU列表
+         *
+         * @return 排序后的CPU编号
+         */
+        static std::vector<int> parseCpuList(const std::string& list) {
+            std::vector<int> cpus;
+            std::stringstream ss(list);
+            std::string range;
+            while (std::getline(ss, range, ',')) {
+                if (range.empty() || range[0] < '0' || range[0] > '9')
+                    continue;
+                size_t dash = range.find('-');
+                int first = std::atoi(range.c_str());
+                int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+            std::sort(cpus.begin(), cpus.end());
+            cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+            return cpus;
+        }
+
+        /**
+         * @brief availableCpus 当前进程可以使用的CPU
+         */
+        static std::vector<int> availableCpus() {
+            std::vector<int> cpus;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &set))
+                        cpus.push_back(cpu);
+                }
+            }
+            if (cpus.empty()) {
+                int n = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+                for (int cpu = 0; cpu < n; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+            return cpus;
+        }
+
+        /**
+         * @brief nodeCount NUMA节点数,至少为1
+         */
+        int nodeCount() const {
+            return static_cast<int>(nodes_.size());
+        }
+
+        /**
+         * @brief cpusOfNode 节点的CPU
+         *
+         * @param node 节点下标,0到nodeCount()-1
+         */
+        const std::vector<int>& cpusOfNode(int node) const {
+            return nodes_[static_cast<size_t>(node)];
+        }
+
+        /**
+         * @brief nodeOfCpu CPU所在的节点
+         *
+         * @return 节点下标,找不到时返回0
+         */
+        int nodeOfCpu(int cpu) const {
+            for (size_t i = 0; i < nodes_.size(); ++i) {
+                if (std::binary_search(nodes_[i].begin(), nodes_[i].end(), cpu))
+                    return static_cast<int>(i);
+            }
+            return 0;
+        }
+
+    private:
+        /**
+         * @brief detect 读取nodeN/cpulist,只保留有CPU并且当前进程可以使用的节点
+         */
+        void detect(const std::string& root) {
+            std::vector<int> available = availableCpus();
+            std::ifstream online(root + "/online");
+            std::string list;
+            if (online && std::getline(online, list)) {
+                for (int node : parseCpuList(list)) {
+                    std::ifstream in(root + "/node" + std::to_string(node) + "/cpulist");
+                    std::string cpuList;
+                    if (!in || !std::getline(in, cpuList))
+                        continue;
+                    std::vector<int> cpus;
+                    for (int cpu : parseCpuList(cpuList)) {
+                        if (std::binary_search(available.begin(), available.end(), cpu))
+                            cpus.push_back(cpu);
+                    }
+                    if (!cpus.empty())
+                        nodes_.push_back(cpus);
+                }
+            }
+            if (nodes_.empty())
+                nodes_.push_back(available);
+        }
+
+    private:
+        ///每个节点的CPU编号,已排序
+        std::vector<std::vector<int>> nodes_;
+};
+
+#endif /* TOPOLOGY_HPP */
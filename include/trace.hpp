@@ -0,0 +1,409 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+//任务跟踪,编译时定义THREADPOOL_TRACE才启用(cmake -DTHREADPOOL_TRACE=ON);
+//没有定义时THREADPOOL_TRACE_EVENT展开为空,Task和线程池没有额外的字段和开销
+
+#ifdef THREADPOOL_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "metrics.hpp"
+#include "task.hpp"
+
+/**
+ * @brief traceTicks 跟踪用的时间戳,x86上是TSC,其他平台是metricsNow纳秒
+ */
+inline uint64_t traceTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(metricsNow());
+#endif
+}
+
+/**
+ * @brief TraceEventType 跟踪事件类型
+ */
+enum class TraceEventType : uint8_t {
+    ///任务放入队列,id为任务编号
+    SUBMIT,
+    ///开始执行任务
+    START,
+    ///任务执行结束
+    END,
+    ///从其他线程的队列窃取任务,arg为被窃取的队列位置
+    STEAL,
+    ///没有任务,开始休眠
+    PARK,
+    ///休眠结束
+    UNPARK
+};
+
+/**
+ * @brief TraceEvent 导出时使用的事件
+ */
+struct TraceEvent {
+    ///traceTicks时间戳
+    uint64_t       ticks;
+    ///任务编号,PARK/UNPARK为0
+    uint64_t       id;
+    ///队列位置,没有时为UINT32_MAX
+    uint32_t       arg;
+    TraceEventType type;
+};
+
+/**
+ * @brief TraceBuffer 每个线程一个的环形缓冲区,只有所属线程写入,写满后覆盖最早的事件
+ *                    每个事件三个普通store加一个head_的release store,导出时其他线程无锁读取,
+ *                    读取期间被覆盖的事件在snapshot中丢弃
+ */
+class TraceBuffer {
+    public:
+        /**
+         * @brief TraceBuffer 构造函数
+         *
+         * @param capacity 事件个数,向上取整为2的幂
+         */
+        explicit TraceBuffer(size_t capacity)
+            : tid_(static_cast<int>(syscall(__NR_gettid))) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            mask_ = size - 1;
+            slots_.reset(new Slot[size]);
+            char name[16] = {0};
+            if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+                name_ = name;
+        }
+
+        /**
+         * @brief push 记录一个事件,只能由所属线程调用
+         */
+        void push(TraceEventType type, uint64_t id, uint32_t arg) {
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            Slot& slot = slots_[head & mask_];
+            slot.ticks = traceTicks();
+            slot.id = id;
+            slot.meta = (static_cast<uint64_t>(type) << 32) | arg;
+            head_.store(head + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief snapshot 按时间顺序复制缓冲区中的事件,复制期间被覆盖的事件会被丢弃
+         */
+        std::vector<TraceEvent> snapshot() const {
+            uint64_t head = head_.load(std::memory_order_acquire);
+            uint64_t size = mask_ + 1;
+            uint64_t first = head > size ? head - size : 0;
+            std::vector<TraceEvent> events;
+            events.reserve(static_cast<size_t>(head - first));
+            for (uint64_t i = first; i < head; ++i) {
+                const Slot& slot = slots_[i & mask_];
+                uint64_t meta = slot.meta;
+                TraceEvent e;
+                e.ticks = slot.ticks;
+                e.id = slot.id;
+                e.arg = static_cast<uint32_t>(meta);
+                e.type = static_cast<TraceEventType>(meta >> 32);
+                events.push_back(e);
+            }
+            //复制时写入线程可能已经绕回,开头的事件不可信
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t now = head_.load(std::memory_order_relaxed);
+            uint64_t overwritten = now > size ? now - size : 0;
+            if (overwritten > first)
+                events.erase(events.begin(),
+                             events.begin() + static_cast<std::ptrdiff_t>(std::min(overwritten, head) - first));
+            return events;
+        }
+
+        /**
+         * @brief clear 丢弃所有事件,应该在所属线程不再记录时调用
+         */
+        void clear() {
+            head_.store(0, std::memory_order_release);
+        }
+
+        int tid() const {
+            return tid_;
+        }
+
+        const std::string& name() const {
+            return name_;
+        }
+
+    private:
+        struct Slot {
+            uint64_t ticks{0};
+            uint64_t id{0};
+            uint64_t meta{0};
+        };
+
+        std::unique_ptr<Slot[]> slots_;
+        uint64_t                mask_{0};
+        ///写入的事件总数,只由所属线程修改
+        std::atomic<uint64_t>   head_{0};
+        int                     tid_;
+        std::string             name_;
+};
+
+/**
+ * @brief Tracer 全局的跟踪开关和所有线程的缓冲区
+ *               线程第一次记录事件时创建自己的缓冲区,线程退出后缓冲区保留到进程结束,之后仍然可以导出
+ */
+class Tracer {
+    public:
+        /**
+         * @brief setEnabled 开始或停止记录,开始时校准时间戳
+         */
+        static void setEnabled(bool enabled) {
+            if (enabled) {
+                std::lock_guard<std::mutex> lock(state().mutex);
+                if (state().baseTicks == 0) {
+                    state().baseTicks = traceTicks();
+                    state().baseNs = metricsNow();
+                }
+            }
+            enabledFlag().store(enabled, std::memory_order_relaxed);
+        }
+
+        static bool isEnabled() {
+            return enabledFlag().load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief setBufferCapacity 之后创建的缓冲区的事件个数,默认65536
+         */
+        static void setBufferCapacity(size_t capacity) {
+            if (capacity > 0)
+                state().capacity.store(capacity, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief nextId 新的任务编号,高位是线程缓冲区的编号,不需要全局计数器
+         */
+        static uint64_t nextId() {
+            Local& local = currentLocal();
+            if (local.buffer == nullptr)
+                attach(local);
+            return (local.index << 40) | ++local.count;
+        }
+
+        /**
+         * @brief record 记录一个事件,没有开启时只读一次开关,
+         *               开启时读一次线程的缓冲区指针,写入一个槽位,不经过state()
+         */
+        static void record(TraceEventType type, uint64_t id, uint32_t arg = UINT32_MAX) {
+            if (!isEnabled())
+                return;
+            TraceBuffer* buffer = currentLocal().buffer;
+            if (buffer == nullptr)
+                buffer = attach(currentLocal());
+            buffer->push(type, id, arg);
+        }
+
+        /**
+         * @brief clear 丢弃所有线程已经记录的事件,应该在线程池空闲时调用
+         */
+        static void clear() {
+            std::lock_guard<std::mutex> lock(state().mutex);
+            for (auto& e : state().buffers) {
+                e->clear();
+            }
+        }
+
+        /**
+         * @brief eventCount 所有缓冲区中的事件数
+         */
+        static size_t eventCount() {
+            std::vector<std::shared_ptr<TraceBuffer>> buffers = getBuffers();
+            size_t count = 0;
+            for (auto& e : buffers) {
+                count += e->snapshot().size();
+            }
+            return count;
+        }
+
+        /**
+         * @brief writeChromeTrace 导出Chrome trace JSON,可以用chrome://tracing或ui.perfetto.dev打开
+         *                         每个线程一行,任务是START到END的区间,SUBMIT到START用flow箭头连接,
+         *                         休眠是PARK到UNPARK的区间,STEAL是瞬时事件
+         *
+         * @param out 输出流
+         */
+        static void writeChromeTrace(std::ostream& out) {
+            std::vector<std::shared_ptr<TraceBuffer>> buffers = getBuffers();
+            uint64_t baseTicks = 0;
+            int64_t baseNs = 0;
+            {
+                std::lock_guard<std::mutex> lock(state().mutex);
+                baseTicks = state().baseTicks;
+                baseNs = state().baseNs;
+            }
+            //用开启时和现在的两个时间点换算TSC,导出的时间是相对开启时的微秒
+            double nsPerTick = 1.0;
+            uint64_t nowTicks = traceTicks();
+            int64_t nowNs = metricsNow();
+            if (nowTicks > baseTicks && nowNs > baseNs)
+                nsPerTick = static_cast<double>(nowNs - baseNs) / static_cast<double>(nowTicks - baseTicks);
+            int pid = static_cast<int>(getpid());
+            bool first = true;
+            out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            auto begin = [&out, &first, pid](const char* name, const char* ph, int tid, double ts) {
+                out << (first ? "\n" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"" << ph
+                    << "\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"ts\":" << ts;
+                first = false;
+            };
+            out.setf(std::ios::fixed);
+            out.precision(3);
+            for (auto& buffer : buffers) {
+                int tid = buffer->tid();
+                begin("thread_name", "M", tid, 0);
+                out << ",\"args\":{\"name\":\"" << buffer->name() << "\"}}";
+                //缓冲区绕回后开头可能是没有开始的区间,跳过
+                int depth = 0;
+                for (const TraceEvent& e : buffer->snapshot()) {
+                    double ts = e.ticks >= baseTicks ?
+                                static_cast<double>(e.ticks - baseTicks) * nsPerTick / 1000.0 : 0;
+                    switch (e.type) {
+                    case TraceEventType::SUBMIT:
+                        begin("submit", "i", tid, ts);
+                        out << ",\"s\":\"t\",\"args\":{\"task\":" << e.id << "}}";
+                        begin("task", "s", tid, ts);
+                        out << ",\"cat\":\"task\",\"id\":" << e.id << "}";
+                        break;
+                    case TraceEventType::START:
+                        ++depth;
+                        begin("task", "B", tid, ts);
+                        out << ",\"args\":{\"task\":" << e.id << "}}";
+                        if (e.id != 0) {
+                            begin("task", "f", tid, ts);
+                            out << ",\"cat\":\"task\",\"bp\":\"e\",\"id\":" << e.id << "}";
+                        }
+                        break;
+                    case TraceEventType::PARK:
+                        ++depth;
+                        begin("park", "B", tid, ts);
+                        out << "}";
+                        break;
+                    case TraceEventType::END:
+                    case TraceEventType::UNPARK:
+                        if (depth == 0)
+                            break;
+                        --depth;
+                        begin(e.type == TraceEventType::END ? "task" : "park", "E", tid, ts);
+                        out << "}";
+                        break;
+                    case TraceEventType::STEAL:
+                        begin("steal", "i", tid, ts);
+                        out << ",\"s\":\"t\",\"args\":{\"task\":" << e.id << ",\"victim\":" << e.arg << "}}";
+                        break;
+                    }
+                }
+            }
+            out << "\n]}\n";
+        }
+
+        /**
+         * @brief writeChromeTrace 导出到文件
+         *
+         * @return 是否写入成功
+         */
+        static bool writeChromeTrace(const std::string& path) {
+            std::ofstream out(path.c_str());
+            if (!out)
+                return false;
+            writeChromeTrace(out);
+            return static_cast<bool>(out);
+        }
+
+    private:
+        struct State {
+            std::atomic<size_t>                       capacity{1 << 16};
+            std::mutex                                mutex;
+            std::vector<std::shared_ptr<TraceBuffer>> buffers;
+            uint64_t                                  baseTicks{0};
+            int64_t                                   baseNs{0};
+        };
+
+        struct Local {
+            TraceBuffer* buffer;
+            uint64_t     index;
+            uint64_t     count;
+        };
+
+        static State& state() {
+            static State s;
+            return s;
+        }
+
+        /**
+         * @brief enabledFlag 开关不放在State中,常量初始化,读取时没有局部静态变量的初始化检查
+         */
+        static std::atomic<bool>& enabledFlag() {
+            static std::atomic<bool> enabled{false};
+            return enabled;
+        }
+
+        static Local& currentLocal() {
+            static thread_local Local local{nullptr, 0, 0};
+            return local;
+        }
+
+        static TraceBuffer* attach(Local& local) {
+            std::shared_ptr<TraceBuffer> buffer(new TraceBuffer(state().capacity.load(std::memory_order_relaxed)));
+            std::lock_guard<std::mutex> lock(state().mutex);
+            state().buffers.push_back(buffer);
+            local.buffer = buffer.get();
+            local.index = state().buffers.size();
+            return local.buffer;
+        }
+
+        static std::vector<std::shared_ptr<TraceBuffer>> getBuffers() {
+            std::lock_guard<std::mutex> lock(state().mutex);
+            return state().buffers;
+        }
+};
+
+/**
+ * @brief traceSubmit 给任务分配编号并记录SUBMIT
+ */
+inline void traceSubmit(Task& task) {
+    if (!Tracer::isEnabled())
+        return;
+    task.setTraceId(Tracer::nextId());
+    Tracer::record(TraceEventType::SUBMIT, task.traceId());
+}
+
+#define THREADPOOL_TRACE_EVENT(type, id, arg) Tracer::record(TraceEventType::type, (id), (arg))
+#define THREADPOOL_TRACE_TASK(type, task, arg) THREADPOOL_TRACE_EVENT(type, (task).traceId(), (arg))
+#define THREADPOOL_TRACE_SUBMIT(task) traceSubmit(task)
+
+#else
+
+#define THREADPOOL_TRACE_EVENT(type, id, arg) ((void)0)
+#define THREADPOOL_TRACE_TASK(type, task, arg) ((void)0)
+#define THREADPOOL_TRACE_SUBMIT(task) ((void)0)
+
+#endif /* THREADPOOL_TRACE */
+
+#endif /* TRACE_HPP */
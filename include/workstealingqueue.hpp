@@ -0,0 +1,183 @@
+#ifndef WORKSTEALINGQUEUE_HPP
+#define WORKSTEALINGQUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+template <typename T>
+/**
+ * @brief WorkStealingQueue Chase-Lev无锁双端队列
+ *                          只有所属线程可以push和pop(LIFO),
+ *                          其他线程通过steal从另一端窃取(FIFO),
+ *                          元素必须是可平凡复制的类型(通常是指针)
+ */
+class WorkStealingQueue {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "WorkStealingQueue element must be trivially copyable");
+
+    private:
+        /**
+         * @brief 环形数组,容量是2的幂
+         */
+        struct Array {
+            explicit Array(int64_t capacity)
+                : capacity_(capacity),
+                  mask_(capacity - 1),
+                  buffer_(new std::atomic<T>[capacity]) {}
+
+            int64_t capacity() const {
+                return capacity_;
+            }
+
+            void put(int64_t i, T x) {
+                buffer_[i & mask_].store(x, std::memory_order_relaxed);
+            }
+
+            T get(int64_t i) const {
+                return buffer_[i & mask_].load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief grow 容量翻倍并复制[top, bottom)之间的元素
+             */
+            Array* grow(int64_t bottom, int64_t top) const {
+                Array* a = new Array(capacity_ * 2);
+                for (int64_t i = top; i != bottom; ++i) {
+                    a->put(i, get(i));
+                }
+                return a;
+            }
+
+            int64_t                         capacity_;
+            int64_t                         mask_;
+            std::unique_ptr<std::atomic<T>[]> buffer_;
+        };
+
+    public:
+        /**
+         * @brief WorkStealingQueue 构造函数
+         *
+         * @param capacity 初始容量,会向上取整为2的幂
+         */
+        explicit WorkStealingQueue(int64_t capacity = 256) {
+            int64_t c = 1;
+            while (c < capacity)
+                c <<= 1;
+            Array* a = new Array(c);
+            garbage_.emplace_back(a);
+            array_.store(a, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief push 所属线程在底部插入元素
+         *
+         * @param x 元素
+         */
+        void push(T x) {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_acquire);
+            Array* a = array_.load(std::memory_order_relaxed);
+            if (b - t > a->capacity() - 1) {
+                //旧数组可能还在被窃取线程读取,到析构时才释放
+                a = a->grow(b, t);
+                garbage_.emplace_back(a);
+                array_.store(a, std::memory_order_release);
+            }
+            a->put(b, x);
+            bottom_.store(b + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief pop 所属线程从底部弹出元素(LIFO)
+         *
+         * @param x 弹出元素赋值对象,失败时不会被修改
+         *
+         * @return true - 成功
+         */
+        bool pop(T& x) {
+            int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            Array* a = array_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            T item = a->get(b);
+            if (t == b) {
+                //只剩最后一个元素,和窃取线程竞争
+                bool won = top_.compare_exchange_strong(t, t + 1,
+                                                        std::memory_order_seq_cst,
+                                                        std::memory_order_relaxed);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                if (!won)
+                    return false;
+            }
+            x = item;
+            return true;
+        }
+
+        /**
+         * @brief steal 其他线程从顶部窃取元素(FIFO)
+         *
+         * @param x 窃取元素赋值对象,失败时不会被修改
+         *
+         * @return true - 成功
+         */
+        bool steal(T& x) {
+            int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t >= b)
+                return false;
+            Array* a = array_.load(std::memory_order_acquire);
+            T item = a->get(t);
+            if (!top_.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed))
+                return false;
+            x = item;
+            return true;
+        }
+
+        /**
+         * @brief size 返回元素个数(估计值)
+         *
+         * @return 元素个数
+         */
+        size_t size() const {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            return b > t ? static_cast<size_t>(b - t) : 0;
+        }
+
+        /**
+         * @brief is_empty 判断队列是否为空(估计值)
+         *
+         * @return true - 队列为空
+         */
+        bool is_empty() const {
+            return size() == 0;
+        }
+
+    private:
+        ///窃取的线程修改top_,所属线程修改bottom_,放在不同的缓存行
+        char                                 pad0_[64];
+        std::atomic<int64_t>                 top_{0};
+        char                                 pad1_[64];
+        std::atomic<int64_t>                 bottom_{0};
+        std::atomic<Array*>                  array_{nullptr};
+        ///所有分配过的数组,只有所属线程会修改
+        std::vector<std::unique_ptr<Array>>  garbage_;
+        char                                 pad2_[64];
+
+    public:
+        WorkStealingQueue(const WorkStealingQueue&) = delete;
+        WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+};
+
+#endif /* WORKSTEALINGQUEUE_HPP */
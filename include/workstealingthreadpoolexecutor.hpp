@@ -2,9 +2,12 @@
 #define WorkStealingThreadPoolExecutor_H
 
 #include "threadpoolexecutor.hpp"
+#include "workstealingqueue.hpp"
 
 /**
- * @brief 任务窃取线程池,从下一个线程的任务队列窃取任务
+ * @brief 任务窃取线程池,每个线程有一个Chase-Lev无锁双端队列,
+ *        线程内提交的任务压入自己的队列(LIFO),
+ *        空闲线程从随机选择的其他线程队列窃取任务(FIFO)
  */
 class WorkStealingThreadPoolExecutor: public ThreadPoolExecutor {
     public:
@@ -47,13 +50,32 @@ class WorkStealingThreadPoolExecutor: public ThreadPoolExecutor {
                                        int32_t maxPoolSize,
                                        const std::string& prefix = "");
 
-        ~WorkStealingThreadPoolExecutor() {}
+        /**
+         * @brief WorkStealingThreadPoolExecutor 构造函数
+         *
+         * @param corePoolSize  核心线程数量
+         * @param maxPoolSize   最大线程数
+         * @param queueCapacity 外部提交任务队列的容量,0表示无界队列
+         * @param prefix        线程名前缀
+         */
+        WorkStealingThreadPoolExecutor(int32_t corePoolSize,
+                                       int32_t maxPoolSize,
+                                       size_t queueCapacity,
+                                       const std::string& prefix = "");
+
+        /**
+         * @brief ~WorkStealingThreadPoolExecutor 析构函数,线程使用空闲线程的记录,要在它们析构前join
+         */
+        virtual ~WorkStealingThreadPoolExecutor() {
+            joinWorkers();
+        }
 
     public:
         /**
          * @brief submit 在将来某个时候执行给定的任务,
          *               任务可以在新线程或现有的合并的线程中执行,
          *               可以有返回值,向任务队列提交的是任务副本
+         *               在本线程池的线程内提交时,任务压入当前线程的双端队列
          *               会抛出异常
          *
          * @param f 要提交的任务(Runnable或函数或lambda)
@@ -67,85 +89,116 @@ class WorkStealingThreadPoolExecutor: public ThreadPoolExecutor {
             using result_type = typename std::result_of<F()>::type;
             std::packaged_task<result_type()> task(std::move(f));
             std::future<result_type> res(task.get_future());
-            if(addWorker(Runnable(std::move(task)), core)) {
-                return res;
-            } else {
-                int c = ctl_.load();
-                if (!isRunning(c)) {
-                    reject(Runnable(std::move(task)));
-                }
-                return res;
-            }
+            execute(Task(std::move(task)), core);
+            return res;
         }
 
+        using ThreadPoolExecutor::submit;
+
+        /**
+         * @brief tryExecuteOne 在当前线程执行一个待处理的任务,
+         *                      本线程池的线程优先执行自己队列中的任务,否则去窃取,
+         *                      用于fork/join中等待子任务时帮忙执行而不是阻塞
+         *
+         * @return true - 执行了一个任务
+         */
+        bool tryExecuteOne();
+
+    protected:
         /**
-         * @brief workerThread 核心工作线程
+         * @brief workerThread 非核心工作线程
          *
          * @param queueIdex 线程队列位置
          */
         virtual void workerThread(size_t queueIdex) override;
 
         /**
-         * @brief workerThread 非核心工作线程
+         * @brief coreWorkerThread 核心工作线程
          *
          * @param queueIdex 线程队列位置
          */
         virtual void coreWorkerThread(size_t queueIdex) override;
+
+        /**
+         * @brief elasticWorkerThread 弹性伸缩的非核心线程,和其他线程一样窃取任务,空闲keepAlive后退出
+         *
+         * @param queueIdex 线程队列位置
+         */
+        virtual void elasticWorkerThread(size_t queueIdex) override;
+
+        /**
+         * @brief signalWorker 唤醒queueIdex对应的线程,
+         *                     它没有休眠时从空闲栈唤醒一个线程来窃取任务
+         */
+        virtual void signalWorker(size_t queueIdex) override;
+
+        /**
+         * @brief signalLocalPush 本线程池的线程向自己的双端队列压入任务并执行seq_cst fence后,
+         *                        从空闲栈最多唤醒count个休眠的线程来窃取
+         */
+        virtual void signalLocalPush(size_t count) override;
+
+    private:
+        /**
+         * @brief runNextTask 依次尝试自己的双端队列,自己的任务队列,窃取其他线程
+         *
+         * @param queueIdex 线程队列位置
+         *
+         * @return true - 执行了一个任务
+         */
+        bool runNextTask(size_t queueIdex);
+
+        /**
+         * @brief runRemainingTask 关闭后执行任意队列中剩下的一个任务,包括非核心线程的队列
+         *
+         * @return true - 执行了一个任务
+         */
+        bool runRemainingTask(size_t queueIdex);
+
+        /**
+         * @brief steal 从随机选择的线程开始遍历所有线程的队列窃取任务
+         *
+         * @param self 当前线程的队列位置,不从自己窃取
+         */
+        bool steal(size_t self, LocalTask*& task, Task& shared);
+
+        /**
+         * @brief runTask 执行从双端队列或任务队列取得的任务
+         *
+         * @param self 当前线程的队列位置,不是线程池的线程时为localQueues_.size()
+         */
+        void runTask(size_t self, LocalTask* task, Task& shared);
+
+        /**
+         * @brief hasWork 是否还有可以执行或窃取的任务
+         */
+        bool hasWork(size_t queueIdex) const;
+
+        /**
+         * @brief signalIdleWorker 从空闲栈顶唤醒一个休眠的线程
+         *
+         * @return true - 唤醒了一个线程
+         */
+        bool signalIdleWorker();
+
+        /**
+         * @brief park 没有任务时把自己放入空闲栈,在自己的Parker上休眠
+         *
+         * @param queueIdex 线程队列位置
+         * @param core 是否是核心线程,非核心线程在keepNonCoreThreadAlive为false时也会被唤醒
+         * @param timeout 最长休眠时间,0表示一直休眠
+         */
+        void park(size_t queueIdex, bool core,
+                  std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero());
+
+    private:
+        char                                                       pad0_[64];
+        ///正在等待的线程数,为0时压入本地队列不需要通知
+        std::atomic<int>                                           parked_{0};
+        ///空闲栈锁
+        std::mutex                                                 idleMutex_;
+        ///空闲栈,栈顶是最近休眠的线程,缓存最热
+        std::vector<size_t>                                        idleWorkers_;
 };
 
-WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(int32_t corePoolSize,
-        int32_t maxPoolSize,
-        const std::vector<BlockingQueue<Runnable::sptr>>& workQueue,
-        const RejectedExecutionHandler& handler,
-        const std::string& prefix)
-    : ThreadPoolExecutor(corePoolSize, maxPoolSize, workQueue, handler, prefix) {}
-
-WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(int32_t corePoolSize,
-        int32_t maxPoolSize,
-        const std::vector<BlockingQueue<Runnable::sptr>>& workQueue,
-        RejectedExecutionHandler* handler,
-        const std::string& prefix)
-    : ThreadPoolExecutor(corePoolSize, maxPoolSize, workQueue, handler, prefix) {}
-
-WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(int32_t corePoolSize,
-        int32_t maxPoolSize,
-        const std::string& prefix)
-    : ThreadPoolExecutor(corePoolSize, maxPoolSize, prefix) {}
-
-void WorkStealingThreadPoolExecutor::coreWorkerThread(size_t queueIdex) {
-    setCurrentThreadName(prefix_);
-    Runnable::sptr task;
-    std::unique_lock<std::mutex> lk(mutex_);
-    while(runStateOf(ctl_.load()) <= SHUTDOWN) {
-        if (workQueues_[queueIdex].is_empty() &&
-                workQueues_[(queueIdex + 1) % workQueues_.size()].is_empty()) {
-            notEmpty_.wait(lk);
-        }
-        if(workQueues_[queueIdex].try_pop(task) ||
-                workQueues_[(queueIdex + 1) % workQueues_.size()].try_pop(task)) {
-            task->operator()();
-        }
-    }
-}
-
-void WorkStealingThreadPoolExecutor::workerThread(size_t queueIdex) {
-    setCurrentThreadName(prefix_);
-    Runnable::sptr task;
-    std::unique_lock<std::mutex> lk(mutex_);
-    while(runStateOf(ctl_.load()) <= SHUTDOWN) {
-        if (workQueues_[queueIdex].is_empty() &&
-                workQueues_[(queueIdex + 1) % workQueues_.size()].is_empty()) {
-            notEmpty_.wait(lk);
-        }
-        if(workQueues_[queueIdex].try_pop(task) ||
-                workQueues_[(queueIdex + 1) % workQueues_.size()].try_pop(task)) {
-            task->operator()();
-        }
-        if(keepNonCoreThreadAlive_) {
-            std::this_thread::yield();
-        } else {
-            return;
-        }
-    }
-}
 #endif /* WorkStealingThreadPoolExecutor_H */
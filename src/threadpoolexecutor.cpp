@@ -1,9 +1,23 @@
+#include <cassert>
 #include <sstream>
 #include <functional>
 #include <stdexcept>
+#include <algorithm>
+#include <thread>
+#include <typeinfo>
 
 #include "threadpoolexecutor.hpp"
 
+/**
+ * @brief cloneHandler 复制拒绝策略,子类没有重写clone时抛出异常,避免策略被切割成基类
+ */
+static RejectedExecutionHandler* cloneHandler(const RejectedExecutionHandler& handler) {
+    std::unique_ptr<RejectedExecutionHandler> copy(handler.clone());
+    if (copy == nullptr || typeid(*copy) != typeid(handler))
+        throw std::logic_error(std::string("clone() is not overridden by ") + typeid(handler).name());
+    return copy.release();
+}
+
 ThreadPoolExecutor::ThreadPoolExecutor(int32_t corePoolSize,
                                        int32_t maxPoolSize,
                                        const std::vector<BlockingQueue<Runnable::sptr>>& workQueue,
@@ -13,14 +27,16 @@ ThreadPoolExecutor::ThreadPoolExecutor(int32_t corePoolSize,
     : corePoolSize_(corePoolSize),
       maxPoolSize_(maxPoolSize),
       prefix_(prefix),
-      ctl_(ctlOf(RUNNING, 0)),
-      workQueues_(workQueue),
-      rejectHandler_(new RejectedExecutionHandler(handler)) {
+      rejectHandler_(cloneHandler(handler)),
+      workQueues_(),
+      ctl_(ctlOf(RUNNING, 0)) {
 
     if (corePoolSize < 0               ||
             maxPoolSize <= 0           ||
             maxPoolSize < corePoolSize)
         throw std::logic_error("parameter value is wrong");
+    initWorkQueues(workQueue);
+    checksAdmission_.store(rejectHandler_->checksAdmission());
 }
 
 ThreadPoolExecutor::ThreadPoolExecutor(int32_t corePoolSize,
@@ -32,14 +48,16 @@ ThreadPoolExecutor::ThreadPoolExecutor(int32_t corePoolSize,
     : corePoolSize_(corePoolSize),
       maxPoolSize_(maxPoolSize),
       prefix_(prefix),
-      ctl_(ctlOf(RUNNING, 0)),
-      workQueues_(workQueue),
-      rejectHandler_(handler) {
+      rejectHandler_(handler != nullptr ? handler : new RejectedExecutionHandler()),
+      workQueues_(),
+      ctl_(ctlOf(RUNNING, 0)) {
 
     if (corePoolSize < 0               ||
             maxPoolSize <= 0           ||
             maxPoolSize < corePoolSize)
         throw std::logic_error("parameter value is wrong");
+    initWorkQueues(workQueue);
+    checksAdmission_.store(rejectHandler_->checksAdmission());
 }
 
 ThreadPoolExecutor::ThreadPoolExecutor(int32_t corePoolSize,
@@ -49,17 +67,91 @@ ThreadPoolExecutor::ThreadPoolExecutor(int32_t corePoolSize,
     : corePoolSize_(corePoolSize),
       maxPoolSize_(maxPoolSize),
       prefix_(prefix),
-      ctl_(ctlOf(RUNNING, 0)),
-      workQueues_(corePoolSize),
-      rejectHandler_(new RejectedExecutionHandler()) {
+      rejectHandler_(new RejectedExecutionHandler()),
+      workQueues_(),
+      ctl_(ctlOf(RUNNING, 0)) {
 
     if (corePoolSize < 0               ||
             maxPoolSize <= 0           ||
             maxPoolSize < corePoolSize)
         throw std::logic_error("parameter value is wrong");
+    initWorkQueues(std::vector<BlockingQueue<Runnable::sptr>>());
 }
 
-ThreadPoolExecutor::~ThreadPoolExecutor() {}
+ThreadPoolExecutor::ThreadPoolExecutor(int32_t corePoolSize,
+                                       int32_t maxPoolSize,
+                                       size_t queueCapacity,
+                                       const std::string& prefix
+                                      )
+    : corePoolSize_(corePoolSize),
+      maxPoolSize_(maxPoolSize),
+      prefix_(prefix),
+      queueCapacity_(queueCapacity),
+      rejectHandler_(new RejectedExecutionHandler()),
+      workQueues_(),
+      ctl_(ctlOf(RUNNING, 0)) {
+
+    if (corePoolSize < 0               ||
+            maxPoolSize <= 0           ||
+            maxPoolSize < corePoolSize)
+        throw std::logic_error("parameter value is wrong");
+    initWorkQueues(std::vector<BlockingQueue<Runnable::sptr>>());
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor() {
+    //本地队列中剩下的任务随localPools_的节点一起释放
+    joinWorkers();
+}
+
+void ThreadPoolExecutor::initWorkQueues(const std::vector<BlockingQueue<Runnable::sptr>>& workQueue) {
+    //每个核心线程都要有自己的队列;非核心线程的队列,Parker和统计也在这里一次分配好,
+    //之后vector不再改变,正在运行的线程和提交任务的线程不加锁访问它们
+    size_t size = std::max(workQueue.size(), static_cast<size_t>(corePoolSize_));
+    size_t slots = size + static_cast<size_t>(maxPoolSize_ - corePoolSize_);
+    workQueues_.reserve(slots);
+    parkers_.reserve(slots);
+    workerMetrics_.reserve(slots);
+    for (size_t i = 0; i < slots; ++i) {
+        if (i < workQueue.size()) {
+            //传入的有界队列保持自己的容量
+            size_t capacity = workQueue[i].capacity();
+            workQueues_.emplace_back(capacity > 0 ? capacity : queueCapacity_);
+            BlockingQueue<Runnable::sptr> commands(workQueue[i]);
+            transferTasks(commands, workQueues_[i]);
+            acquireTasks(workQueues_[i].size());
+        } else {
+            workQueues_.emplace_back(queueCapacity_);
+        }
+        parkers_.emplace_back(new Parker());
+        workerMetrics_.emplace_back(new WorkerMetrics());
+    }
+    for (int i = 0; i < corePoolSize_; ++i) {
+        priorityQueues_.emplace_back(new PriorityQueues(queueCapacity_));
+    }
+    for (size_t i = 0; i < slots; ++i) {
+        localQueues_.emplace_back(new WorkStealingQueue<LocalTask*>());
+        localPools_.emplace_back(new LocalTaskPool());
+    }
+    maxPoolSizeLimit_ = maxPoolSize_;
+    slotCount_.store(size, std::memory_order_release);
+}
+
+size_t ThreadPoolExecutor::addWorkQueue() {
+    //非核心线程退出后队列位置由acquireSlot复用,这里只启用一个新的预分配位置
+    size_t index = slotCount_.load(std::memory_order_relaxed);
+    assert(index < workQueues_.size());
+    slotCount_.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+void ThreadPoolExecutor::transferTasks(BlockingQueue<Runnable::sptr>& from, BlockingQueue<Task>& to) {
+    Runnable::sptr command;
+    while (from.try_pop(command)) {
+        to.put(Task([command]() {
+            command->operator()();
+        }));
+    }
+}
 
 bool ThreadPoolExecutor::keepNonCoreThreadAlive() const {
     return keepNonCoreThreadAlive_;
@@ -76,64 +168,96 @@ void ThreadPoolExecutor::keepNonCoreThreadAlive(bool value) {
 
 void ThreadPoolExecutor::releaseNonCoreThreads() {
     keepNonCoreThreadAlive_ = false;
-    notEmpty_.notify_all();
-    for (int i = threads_.size() - 1; i >= corePoolSize_; --i) {
-        if (threads_[i] != nullptr && threads_[i]->isIdle()) {
-            decrementWorkerCount();
-            threads_.pop_back();
-            workQueues_.pop_back();
-        }
-    }
-    threads_.shrink_to_fit();
+    signalNotEmpty();
+    //非核心线程退出时自己减少线程数并移入retiredThreads_,这里只join已经退出的线程
+    std::vector<Thread::sptr> retired;
+    std::lock_guard<std::mutex> lock(mutex_);
+    retired.swap(retiredThreads_);
 }
 
 void ThreadPoolExecutor::releaseWorkers() {
-    notEmpty_.notify_all();
-    for (int i = threads_.size() - 1; i >= 0 ; --i) {
-        decrementWorkerCount();
-        threads_.pop_back();
+    signalNotEmpty();
+    //在锁外join,退出的线程在retireWorker中需要mutex_
+    std::vector<Thread::sptr> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads.swap(threads_);
+        std::move(retiredThreads_.begin(), retiredThreads_.end(), std::back_inserter(threads));
+        retiredThreads_.clear();
     }
+    threads.clear();
 }
 
-bool ThreadPoolExecutor::addWorker(Runnable::sptr task, bool core) {
+void ThreadPoolExecutor::joinWorkers() {
+    //没有关闭的线程池先关闭,线程执行完剩下的任务后退出;
+    //已经stop的线程池threads_为空,这里什么也不做
+    shutdown();
+    releaseWorkers();
+}
+
+bool ThreadPoolExecutor::addWorker(Task&& task, bool core) {
+    int32_t state = runStateOf(ctl_.load());
+    if (state > SHUTDOWN)
+        return false;
+    //线程池的线程提交的任务留在自己的本地队列,不经过submitId_和mutex_,
+    //节点从线程自己的缓存分配,计数只修改线程自己的submitted;
+    //shutdown后仍然接受,提交的线程退出前会执行完自己的本地队列
+    WorkStealingQueue<LocalTask*>* local = workerLocalQueue();
+    if (local != nullptr) {
+        size_t index = currentLocal().index;
+        WorkerMetrics::increment(workerMetrics_[index]->submitted);
+        markEnqueued(task);
+        pushLocalTask(index, std::move(task));
+        //一次fence同时和休眠线程的登记,shutdownNow修改状态配对
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        signalLocalPush(1);
+        return !revokeLocalPush(local, task);
+    }
+    if (!isRunning(state))
+        return false;
+    SubmitGuard guard(submitters_);
+    if (!admit(1))
+        return false;
+    //弹性伸缩时非核心线程从核心线程的队列窃取任务
+    if (!core && elastic_.load(std::memory_order_relaxed))
+        core = true;
+    markEnqueued(task);
     int32_t c = 0;
     int32_t rs = 0;
     int32_t wc = 0;
     for (;;) {
         c = ctl_.load();
         rs = runStateOf(c);
-        if (rs >= SHUTDOWN)
+        if (rs >= SHUTDOWN) {
+            releaseTasks(1);
             return false;
+        }
         for (;;) {
             wc = workerCountOf(c);
-            if (wc >= (core ? corePoolSize_ : maxPoolSize_)) {
-                if (core) {
-                    workQueues_[++submitId_ % corePoolSize_].put(task);
-                    notEmpty_.notify_all();
-                    return true;
+            if (wc >= (core ? corePoolSize_ : maxPoolSize_.load())) {
+                size_t nonCore = slotCount_.load(std::memory_order_acquire) - corePoolSize_;
+                size_t index = 0;
+                if (core || nonCore == 0) {
+                    index = (submitId_.fetch_add(1, std::memory_order_relaxed) + 1) % corePoolSize_;
                 } else {
-                    workQueues_[(submitId_++ % corePoolSize_) + corePoolSize_].put(task);
-                    notEmpty_.notify_all();
-                    return true;
+                    index = (submitId_.fetch_add(1, std::memory_order_relaxed) % nonCore) + corePoolSize_;
                 }
+                workQueues_[index].put(std::move(task));
+                signalWorker(index);
+                return true;
             }
             if(compareAndIncrementWorkerCount(c)) {
-                wc = workerCountOf(c);
-                if (core || wc <= corePoolSize_) {
-                    {
-                        std::lock_guard<std::mutex> lock(mutex_);
-                        workQueues_[++submitId_ % corePoolSize_].put(task);
-                    }
+                //新线程的队列下标就是它的worker编号,创建线程只在慢路径上持有mutex_
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (core || wc < corePoolSize_) {
+                    workQueues_[wc].put(std::move(task));
                     threads_.emplace_back(new Thread(std::bind(&ThreadPoolExecutor::coreWorkerThread,
-                                                     this, workQueues_.size() - 1), prefix_));
+                                                     this, wc), prefix_));
                 } else {
-                    {
-                        std::lock_guard<std::mutex> lock(mutex_);
-                        workQueues_.push_back(BlockingQueue<Runnable::sptr>());
-                        workQueues_.back().put(task);
-                    }
+                    size_t index = acquireSlot();
+                    workQueues_[index].put(std::move(task));
                     threads_.emplace_back(new Thread(std::bind(&ThreadPoolExecutor::workerThread,
-                                                     this, workQueues_.size() - 1), prefix_));
+                                                     this, index), prefix_));
                 }
                 threads_.back()->start();
                 everPoolSize_++;
@@ -146,56 +270,23 @@ bool ThreadPoolExecutor::addWorker(Runnable::sptr task, bool core) {
     }
 }
 
-bool ThreadPoolExecutor::addWorker(Runnable task, bool core) {
-    int32_t c = 0;
-    int32_t rs = 0;
-    int32_t wc = 0;
-    for (;;) {
-        c = ctl_.load();
-        rs = runStateOf(c);
-        if (rs >= SHUTDOWN)
-            return false;
-        for (;;) {
-            wc = workerCountOf(c);
-            if (wc >= (core ? corePoolSize_ : maxPoolSize_)) {
-                if (core) {
-                    workQueues_[++submitId_ % corePoolSize_].put(std::make_shared<Runnable>(std::move(task)));
-                    notEmpty_.notify_all();
-                    return true;
-                } else {
-                    workQueues_[(submitId_++ % corePoolSize_) + corePoolSize_].put(std::make_shared<Runnable>(std::move(task)));
-                    notEmpty_.notify_all();
-                    return true;
-                }
-            }
-            if(compareAndIncrementWorkerCount(c)) {
-                if (core) {
-                    {
-                        std::lock_guard<std::mutex> lock(mutex_);
-                        workQueues_[++submitId_ % corePoolSize_].put(std::make_shared<Runnable>(std::move(task)));
-                    }
-                    threads_.emplace_back(new Thread(std::bind(&ThreadPoolExecutor::coreWorkerThread,
-                                                     this, workQueues_.size() - 1), prefix_));
-                } else {
-                    {
-                        std::lock_guard<std::mutex> lock(mutex_);
-                        workQueues_.push_back(BlockingQueue<Runnable::sptr>());
-                        workQueues_.back().put(std::make_shared<Runnable>(std::move(task)));
-                    }
-                    threads_.emplace_back(new Thread(std::bind(&ThreadPoolExecutor::workerThread,
-                                                     this, workQueues_.size() - 1), prefix_));
-                }
-                threads_.back()->start();
-                everPoolSize_++;
-                return true;
-            }
-            c = ctl_.load();  // Re-read ctl
-            if(runStateOf(c) != rs)
-                break;
-        }
+bool ThreadPoolExecutor::addWorker(Runnable::sptr task, bool core) {
+    return addWorker(Task([task]() {
+        task->operator()();
+    }), core);
+}
+
+void ThreadPoolExecutor::signalNotEmpty() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& e : parkers_) {
+        e->unpark();
     }
 }
 
+void ThreadPoolExecutor::signalWorker(size_t queueIdex) {
+    parkers_[queueIdex]->unpark();
+}
+
 bool ThreadPoolExecutor::execute(Runnable::sptr command, bool core) {
     int32_t c = ctl_.load();
     if(addWorker(command, core)) {
@@ -206,59 +297,469 @@ bool ThreadPoolExecutor::execute(Runnable::sptr command, bool core) {
         reject(command);
         return false;
     }
-    return false;
+    //任务数达到上限
+    Task task([command]() {
+        command->operator()();
+    });
+    return reject(task);
 }
 
-bool ThreadPoolExecutor::execute(Runnable& command, bool core) {
+bool ThreadPoolExecutor::execute(Task&& task, bool core) {
+    if(addWorker(std::move(task), core)) {
+        return true;
+    }
+    return reject(task);
+}
+
+bool ThreadPoolExecutor::execute(Task&& task, TaskPriority priority) {
+    if (priority == TaskPriority::NORMAL || corePoolSize_ == 0)
+        return execute(std::move(task), true);
+    SubmitGuard guard(submitters_);
     int32_t c = ctl_.load();
-    if(isRunning(c)) {
-        if(addWorker(std::make_shared<Runnable>(command), core)) {
-            return true;
-        }
-        c = ctl_.load();
-        if (!isRunning(c)) {
-            reject(command);
-            return false;
-        }
+    if (!isRunning(c) || !admit(1))
+        return reject(task);
+    markEnqueued(task);
+    //和addWorker一样,核心线程没有全部启动时交给新启动的线程
+    size_t index = 0;
+    int wc = workerCountOf(c);
+    if (wc < corePoolSize_) {
+        startCoreThreads(wc + 1);
+        index = static_cast<size_t>(wc);
+    } else {
+        index = (submitId_.fetch_add(1, std::memory_order_relaxed) + 1) % corePoolSize_;
     }
-    return false;
+    PriorityQueues& queues = *priorityQueues_[index];
+    queues.pending.fetch_add(1);
+    levelQueue(index, static_cast<int>(priority)).put(std::move(task));
+    signalWorker(index);
+    return true;
+}
+
+bool ThreadPoolExecutor::executeOnNode(Task&& task, int node) {
+    if (corePoolSize_ == 0 || workerNodes_.empty())
+        return execute(std::move(task), true);
+    SubmitGuard guard(submitters_);
+    int32_t c = ctl_.load();
+    if (!isRunning(c))
+        return reject(task);
+    //从下一个提交位置开始找该节点上的核心线程
+    size_t core = static_cast<size_t>(corePoolSize_);
+    size_t first = submitId_.fetch_add(1, std::memory_order_relaxed) + 1;
+    for (size_t i = 0; i < core; ++i) {
+        size_t index = (first + i) % core;
+        if (getWorkerNode(index) != node)
+            continue;
+        if (!admit(1))
+            return reject(task);
+        markEnqueued(task);
+        startCoreThreads(static_cast<int>(index) + 1);
+        workQueues_[index].put(std::move(task));
+        signalWorker(index);
+        return true;
+    }
+    return execute(std::move(task), true);
+}
+
+bool ThreadPoolExecutor::execute(Runnable& command, bool core) {
+    int32_t c = ctl_.load();
+    if(!isRunning(c))
+        return false;
+    return execute(Task(Runnable(command)), core);
 }
 
 bool ThreadPoolExecutor::execute(BlockingQueue<Runnable::sptr>& commands, bool core) {
+    BlockingQueue<Task> queue;
+    transferTasks(commands, queue);
+    std::vector<Task> tasks;
+    Task task;
+    while (queue.try_pop(task)) {
+        tasks.push_back(std::move(task));
+    }
+    return executeBatch(tasks, core);
+}
+
+bool ThreadPoolExecutor::executeBatch(std::vector<Task>& tasks, bool core) {
+    if (tasks.empty())
+        return true;
     int32_t c = ctl_.load();
-    if (core) {
-        for (unsigned int i = 0; i < commands.size(); ++i) {
-            c = ctl_.load();
-            auto command = commands.take();
-            if(addWorker(command, core)) {
-                return true;
-            }
-            c = ctl_.load();
-            if (!isRunning(c)) {
-                reject(command);
-                return false;
-            }
+    WorkStealingQueue<LocalTask*>* local = workerLocalQueue();
+    if (runStateOf(c) > SHUTDOWN || (!isRunning(c) && local == nullptr)) {
+        for (auto& e : tasks) {
+            reject(e);
         }
-    } else {
-        c = ctl_.load();
+        return false;
+    }
+    if (local != nullptr) {
+        size_t count = tasks.size();
+        size_t index = currentLocal().index;
+        WorkerMetrics::increment(workerMetrics_[index]->submitted, count);
+        int64_t now = metricsEnabled_.load(std::memory_order_relaxed) ? metricsNow() : 0;
+        for (auto& e : tasks) {
+            e.setEnqueueTime(now);
+            THREADPOOL_TRACE_SUBMIT(e);
+            pushLocalTask(index, std::move(e));
+        }
+        tasks.clear();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        signalLocalPush(count);
+        bool all = true;
+        Task task;
+        while (revokeLocalPush(local, task)) {
+            reject(task);
+            all = false;
+        }
+        return all;
+    }
+    SubmitGuard guard(submitters_);
+    if (!isRunning(ctl_.load())) {
+        for (auto& e : tasks) {
+            reject(e);
+        }
+        return false;
+    }
+    if (corePoolSize_ == 0 || !admit(tasks.size())) {
+        //整批放不下时逐个提交,放不下的任务交给拒绝策略
+        bool all = true;
+        for (auto& e : tasks) {
+            all = execute(std::move(e), core) && all;
+        }
+        tasks.clear();
+        return all;
+    }
+    int64_t now = metricsEnabled_.load(std::memory_order_relaxed) ? metricsNow() : 0;
+    for (auto& e : tasks) {
+        e.setEnqueueTime(now);
+        THREADPOOL_TRACE_SUBMIT(e);
+    }
+    if (!core && !elastic_.load(std::memory_order_relaxed)) {
         int wc = workerCountOf(c);
-        if (wc >= CAPACITY || wc >= maxPoolSize_)
-            return false;
-        if (compareAndIncrementWorkerCount(c)) {
+        if (wc >= corePoolSize_ && wc < maxPoolSize_ && compareAndIncrementWorkerCount(c)) {
             std::lock_guard<std::mutex> lock(mutex_);
-            workQueues_.emplace_back(commands);
+            size_t index = acquireSlot();
+            workQueues_[index].put_all(tasks.begin(), tasks.end());
             threads_.emplace_back(new Thread(std::bind(&ThreadPoolExecutor::workerThread,
-                                             this, workQueues_.size() - 1), prefix_));
+                                             this, index), prefix_));
             threads_.back()->start();
             everPoolSize_++;
+            tasks.clear();
+            return true;
         }
-        notEmpty_.notify_one();
+    }
+    size_t queues = static_cast<size_t>(corePoolSize_);
+    startCoreThreads(static_cast<int>(std::min(tasks.size(), queues)));
+    //每个队列分到连续的一段,前n % queues个队列多分一个
+    size_t n = tasks.size();
+    size_t chunk = n / queues;
+    size_t extra = n % queues;
+    size_t first = submitId_.fetch_add(static_cast<unsigned int>(queues), std::memory_order_relaxed);
+    auto it = tasks.begin();
+    for (size_t i = 0; i < queues && it != tasks.end(); ++i) {
+        size_t count = chunk + (i < extra ? 1 : 0);
+        workQueues_[(first + i) % queues].put_all(it, it + count);
+        it += count;
+    }
+    tasks.clear();
+    //只唤醒收到任务的线程
+    for (size_t i = 0; i < std::min(n, queues); ++i) {
+        signalWorker((first + i) % queues);
     }
     return true;
 }
 
-void ThreadPoolExecutor::setRejectedExecutionHandler(RejectedExecutionHandler handler) {
-    rejectHandler_.reset(new RejectedExecutionHandler(handler));
+void ThreadPoolExecutor::setElastic(bool enabled, const ElasticPolicy& policy) {
+    if (enabled && corePoolSize_ == 0)
+        return;
+    growThresholdNs_.store(policy.growThreshold.count());
+    keepAliveNs_.store(policy.keepAlive.count());
+    growIntervalNs_.store(policy.growInterval.count());
+    if (enabled)
+        setMetricsEnabled(true);
+    elastic_.store(enabled);
+    //关闭时唤醒休眠的非核心线程,让它们退出
+    if (!enabled)
+        signalNotEmpty();
+}
+
+bool ThreadPoolExecutor::isElastic() const {
+    return elastic_.load(std::memory_order_relaxed);
+}
+
+ElasticPolicy ThreadPoolExecutor::getElasticPolicy() const {
+    ElasticPolicy policy;
+    policy.growThreshold = std::chrono::nanoseconds(growThresholdNs_.load());
+    policy.keepAlive = std::chrono::nanoseconds(keepAliveNs_.load());
+    policy.growInterval = std::chrono::nanoseconds(growIntervalNs_.load());
+    return policy;
+}
+
+uint64_t ThreadPoolExecutor::getGrowCount() const {
+    return growCount_.load(std::memory_order_relaxed);
+}
+
+uint64_t ThreadPoolExecutor::getShrinkCount() const {
+    return shrinkCount_.load(std::memory_order_relaxed);
+}
+
+int ThreadPoolExecutor::getPoolSize() const {
+    return workerCountOf(ctl_.load());
+}
+
+void ThreadPoolExecutor::maybeGrow(int64_t delay, int64_t now) {
+    if (delay <= growThresholdNs_.load(std::memory_order_relaxed))
+        return;
+    //同一时间只有一个线程尝试增加线程
+    int64_t last = lastGrowTime_.load(std::memory_order_relaxed);
+    if (now - last < growIntervalNs_.load(std::memory_order_relaxed) ||
+            !lastGrowTime_.compare_exchange_strong(last, now))
+        return;
+    addElasticWorker();
+}
+
+bool ThreadPoolExecutor::addElasticWorker() {
+    //已经退出的线程在锁外join,不会阻塞
+    std::vector<Thread::sptr> retired;
+    std::lock_guard<std::mutex> lock(mutex_);
+    //先唤醒休眠的非核心线程,提交任务时只唤醒核心线程,它们不会自己醒来
+    for (size_t i = static_cast<size_t>(corePoolSize_); i < slotCount_.load(std::memory_order_relaxed); ++i) {
+        if (parkers_[i]->unpark())
+            return false;
+    }
+    retired.swap(retiredThreads_);
+    int32_t c = ctl_.load();
+    int wc = workerCountOf(c);
+    //核心线程全部启动后才增加,addWorker用线程数作为核心线程的队列位置
+    if (!isRunning(c) || wc < corePoolSize_ || wc >= maxPoolSize_)
+        return false;
+    bool reuse = !freeSlots_.empty();
+    if (!reuse && slotCount_.load(std::memory_order_relaxed) >= workQueues_.size())
+        return false;
+    if (!compareAndIncrementWorkerCount(c))
+        return false;
+    size_t index = acquireSlot();
+    threads_.emplace_back(new Thread(std::bind(&ThreadPoolExecutor::elasticWorkerThread,
+                                     this, index), prefix_));
+    threads_.back()->start();
+    everPoolSize_++;
+    growCount_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+Thread* ThreadPoolExecutor::attachElasticWorker() {
+    //创建线程时持有mutex_,这里拿到锁时Thread已经start完成
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::thread::id id = std::this_thread::get_id();
+    for (auto& e : threads_) {
+        if (e->stdId() == id)
+            return e.get();
+    }
+    return nullptr;
+}
+
+void ThreadPoolExecutor::retireElasticWorker(size_t queueIdex) {
+    if (isRunning(ctl_.load()))
+        shrinkCount_.fetch_add(1, std::memory_order_relaxed);
+    retireWorker(queueIdex);
+}
+
+void ThreadPoolExecutor::retireWorker(size_t queueIdex) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        //stop时releaseWorkers已经取走threads_,由它join
+        std::thread::id id = std::this_thread::get_id();
+        for (auto it = threads_.begin(); it != threads_.end(); ++it) {
+            if ((*it)->stdId() == id) {
+                //不能在自己的线程中析构Thread(析构时join),留给之后增加线程时释放
+                retiredThreads_.push_back(std::move(*it));
+                threads_.erase(it);
+                break;
+            }
+        }
+        if (isRunning(ctl_.load()))
+            freeSlots_.push_back(queueIdex);
+    }
+    processWorkerExit();
+}
+
+size_t ThreadPoolExecutor::acquireSlot() {
+    if (freeSlots_.empty())
+        return addWorkQueue();
+    size_t index = freeSlots_.back();
+    freeSlots_.pop_back();
+    return index;
+}
+
+std::chrono::nanoseconds ThreadPoolExecutor::elasticIdleTimeout(const Thread* self) const {
+    auto idle = std::chrono::steady_clock::now() - self->getLastActiveTime();
+    return std::chrono::nanoseconds(keepAliveNs_.load(std::memory_order_relaxed)) -
+           std::chrono::duration_cast<std::chrono::nanoseconds>(idle);
+}
+
+void ThreadPoolExecutor::setRejectedExecutionHandler(const RejectedExecutionHandler& handler) {
+    setRejectedExecutionHandler(cloneHandler(handler));
+}
+
+void ThreadPoolExecutor::setRejectedExecutionHandler(RejectedExecutionHandler* handler) {
+    setRejectedExecutionHandler(std::shared_ptr<RejectedExecutionHandler>(handler));
+}
+
+void ThreadPoolExecutor::setRejectedExecutionHandler(std::shared_ptr<RejectedExecutionHandler> handler) {
+    if (handler == nullptr)
+        handler = std::make_shared<RejectedExecutionHandler>();
+    checksAdmission_.store(handler->checksAdmission());
+    std::atomic_store(&rejectHandler_, handler);
+}
+
+void ThreadPoolExecutor::setTaskCapacity(size_t capacity) {
+    taskCapacity_.store(capacity);
+    signalAdmission();
+}
+
+size_t ThreadPoolExecutor::getTaskCapacity() const {
+    return taskCapacity_.load();
+}
+
+size_t ThreadPoolExecutor::getPendingTaskCount() const {
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    collectWorkerTasks(submitted, completed);
+    for (;;) {
+        //线程的计数只增不减,前后两次读到的相同时中间没有变化,和pendingTasks_是同一时刻的值
+        uint64_t pending = pendingTasks_.load();
+        uint64_t lastSubmitted = submitted;
+        uint64_t lastCompleted = completed;
+        collectWorkerTasks(submitted, completed);
+        if (submitted == lastSubmitted && completed == lastCompleted) {
+            int64_t n = static_cast<int64_t>(pending + submitted - completed);
+            return n > 0 ? static_cast<size_t>(n) : 0;
+        }
+    }
+}
+
+void ThreadPoolExecutor::collectWorkerTasks(uint64_t& submitted, uint64_t& completed) const {
+    submitted = 0;
+    completed = 0;
+    for (auto& e : workerMetrics_) {
+        submitted += e->submitted.load(std::memory_order_acquire);
+        completed += e->completed.load(std::memory_order_acquire);
+    }
+}
+
+bool ThreadPoolExecutor::admit(size_t count) {
+    if (checksAdmission_.load(std::memory_order_relaxed) && !handler()->admit(*this))
+        return false;
+    size_t capacity = taskCapacity_.load(std::memory_order_relaxed);
+    if (capacity == 0) {
+        acquireTasks(count);
+        return true;
+    }
+    //线程池的线程提交和执行的任务记在各自的计数中,只在检查上限时求和
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    collectWorkerTasks(submitted, completed);
+    size_t pending = pendingTasks_.load();
+    do {
+        int64_t total = std::max<int64_t>(static_cast<int64_t>(pending + submitted - completed), 0);
+        if (static_cast<size_t>(total) + count > capacity)
+            return false;
+    } while (!pendingTasks_.compare_exchange_weak(pending, pending + count));
+    return true;
+}
+
+bool ThreadPoolExecutor::revokeLocalPush(WorkStealingQueue<LocalTask*>* queue, Task& task) {
+    if (!runStateAtLeast(ctl_.load(), STOP))
+        return false;
+    //只有自己从底部压入,底部的任务就是刚压入的
+    LocalTask* local = nullptr;
+    if (!queue->pop(local))
+        return false;
+    LocalTaskPool::take(local, task, true);
+    releaseTasks(1);
+    return true;
+}
+
+void ThreadPoolExecutor::signalAdmission() {
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex_);
+    }
+    admissionCond_.notify_all();
+}
+
+bool ThreadPoolExecutor::offer(Task&& task) {
+    return addWorker(std::move(task), true);
+}
+
+bool ThreadPoolExecutor::offer(Task&& task, const std::chrono::nanoseconds& timeout) {
+    if (offer(std::move(task)))
+        return true;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(admissionMutex_);
+    //先登记再检查,releaseTasks看到等待者时会通过admissionMutex_唤醒,不会丢失
+    admissionWaiters_.fetch_add(1);
+    bool accepted = false;
+    while (isRunning(ctl_.load())) {
+        if (offer(std::move(task))) {
+            accepted = true;
+            break;
+        }
+        if (admissionCond_.wait_until(lock, deadline) == std::cv_status::timeout) {
+            accepted = offer(std::move(task));
+            break;
+        }
+    }
+    admissionWaiters_.fetch_sub(1);
+    return accepted;
+}
+
+bool ThreadPoolExecutor::discardOldestTask() {
+    Task task;
+    size_t core = static_cast<size_t>(corePoolSize_);
+    const int high = static_cast<int>(TaskPriority::HIGH);
+    const int normal = static_cast<int>(TaskPriority::NORMAL);
+    for (int level = static_cast<int>(TaskPriority::LOW); level >= high; --level) {
+        for (size_t i = 0; i < core; ++i) {
+            PriorityQueues& queues = *priorityQueues_[i];
+            if (level != normal && queues.pending.load(std::memory_order_relaxed) == 0)
+                continue;
+            if (levelQueue(i, level).try_pop(task)) {
+                if (level != normal)
+                    queues.pending.fetch_sub(1);
+                task.reset();
+                releaseTasks(1);
+                return true;
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = core; i < slotCount_.load(std::memory_order_relaxed) && task.empty(); ++i) {
+            workQueues_[i].try_pop(task);
+        }
+    }
+    //最后从本地队列的窃取端丢弃
+    LocalTask* local = nullptr;
+    for (size_t i = 0; i < localQueues_.size() && task.empty(); ++i) {
+        if (localQueues_[i]->steal(local))
+            LocalTaskPool::take(local, task, false);
+    }
+    if (task.empty())
+        return false;
+    task.reset();
+    releaseTasks(1);
+    return true;
+}
+
+std::chrono::nanoseconds ThreadPoolExecutor::getQueueDelay() const {
+    //只统计最近执行过任务的线程,队列排空后旧的估计不再影响准入
+    const int64_t window = 100 * 1000 * 1000;
+    int64_t now = metricsNow();
+    int64_t delay = 0;
+    size_t count = slotCount_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        const WorkerMetrics& e = *workerMetrics_[i];
+        if (now - e.queueDelayTime.load(std::memory_order_relaxed) <= window)
+            delay = std::max(delay, e.queueDelay.load(std::memory_order_relaxed));
+    }
+    return std::chrono::nanoseconds(delay);
 }
 
 std::string ThreadPoolExecutor::toString() const {
@@ -276,27 +777,293 @@ std::string ThreadPoolExecutor::toString() const {
 }
 
 int ThreadPoolExecutor::getActiveCount() const {
-    int count = 0;
-    for (auto& e : threads_) {
-        if(!e->isIdle())
-            count++;
+    //每个线程只写自己的计数,这里不加锁,O(线程数)
+    size_t count = slotCount_.load(std::memory_order_acquire);
+    int active = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (workerMetrics_[i]->active.load(std::memory_order_relaxed) != 0)
+            active++;
     }
-    return count;
+    return active;
 }
 
 long ThreadPoolExecutor::getTaskCount()const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    //workQueues_只增加不减少,slotCount_和它的大小相同;各队列的大小都是原子计数,不加锁
+    size_t count = slotCount_.load(std::memory_order_acquire);
     long size = 0;
-    for (auto e : workQueues_) {
-        size += e.size();
+    for (size_t i = 0; i < count; ++i) {
+        size += static_cast<long>(workQueues_[i].size());
+    }
+    for (auto& e : priorityQueues_) {
+        size += static_cast<long>(e->high.size() + e->low.size());
+    }
+    for (auto& e : localQueues_) {
+        size += static_cast<long>(e->size());
     }
     return size;
 }
 
+void ThreadPoolExecutor::setCpuAffinity(const std::vector<int>& cpus, bool pinEachWorker) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkNoWorkers();
+    cpuSet_ = cpus;
+    std::sort(cpuSet_.begin(), cpuSet_.end());
+    cpuSet_.erase(std::unique(cpuSet_.begin(), cpuSet_.end()), cpuSet_.end());
+    pinEachWorker_ = pinEachWorker;
+    if (topology_ == nullptr)
+        topology_.reset(new CpuTopology());
+    updatePlacement();
+}
+
+void ThreadPoolExecutor::setNumaAware(bool enabled, const CpuTopology& topology) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkNoWorkers();
+    numaAware_ = enabled;
+    topology_.reset(new CpuTopology(topology));
+    updatePlacement();
+}
+
+std::vector<int> ThreadPoolExecutor::getWorkerCpus(size_t queueIdex) const {
+    if (topology_ == nullptr)
+        return cpuSet_;
+    std::vector<int> cpus;
+    size_t slot = queueIdex;
+    if (numaAware_) {
+        //线程轮流分配到各个节点,节点内再轮流分配CPU
+        int nodes = topology_->nodeCount();
+        const std::vector<int>& nodeCpus = topology_->cpusOfNode(static_cast<int>(queueIdex % nodes));
+        slot = queueIdex / nodes;
+        for (int cpu : nodeCpus) {
+            if (cpuSet_.empty() || std::binary_search(cpuSet_.begin(), cpuSet_.end(), cpu))
+                cpus.push_back(cpu);
+        }
+        //节点和cpuSet_没有交集时只使用cpuSet_
+        if (cpus.empty()) {
+            cpus = cpuSet_;
+            slot = queueIdex;
+        }
+    } else {
+        cpus = cpuSet_;
+    }
+    if (pinEachWorker_ && !cpus.empty())
+        return std::vector<int>(1, cpus[slot % cpus.size()]);
+    return cpus;
+}
+
+int ThreadPoolExecutor::getWorkerNode(size_t queueIdex) const {
+    return queueIdex < workerNodes_.size() ? workerNodes_[queueIdex] : 0;
+}
+
+void ThreadPoolExecutor::checkNoWorkers() const {
+    //线程都在mutex_下启动,启动后不加锁读取placement,之后不能再修改
+    if (everPoolSize_.load() != 0)
+        throw std::logic_error("placement must be set before any worker starts");
+}
+
+void ThreadPoolExecutor::updatePlacement() {
+    workerNodes_.clear();
+    if (topology_ == nullptr)
+        return;
+    for (size_t i = 0; i < workQueues_.size(); ++i) {
+        std::vector<int> cpus = getWorkerCpus(i);
+        workerNodes_.push_back(cpus.empty() ? 0 : topology_->nodeOfCpu(cpus.front()));
+    }
+}
+
+void ThreadPoolExecutor::bindWorker(size_t queueIdex) {
+    if (topology_ != nullptr)
+        setCurrentThreadAffinity(getWorkerCpus(queueIdex));
+}
+
+void ThreadPoolExecutor::setIdleStrategy(const IdleStrategy& strategy) {
+    idleSpinNs_.store(strategy.maxSpin.count(), std::memory_order_relaxed);
+    idleYields_.store(strategy.yields, std::memory_order_relaxed);
+    idleAdaptive_.store(strategy.adaptive, std::memory_order_relaxed);
+}
+
+IdleStrategy ThreadPoolExecutor::getIdleStrategy() const {
+    IdleStrategy strategy;
+    strategy.maxSpin = std::chrono::nanoseconds(idleSpinNs_.load(std::memory_order_relaxed));
+    strategy.yields = idleYields_.load(std::memory_order_relaxed);
+    strategy.adaptive = idleAdaptive_.load(std::memory_order_relaxed);
+    return strategy;
+}
+
+void ThreadPoolExecutor::setPriorityAging(unsigned aging) {
+    if (aging > 0)
+        priorityAging_.store(aging, std::memory_order_relaxed);
+}
+
+unsigned ThreadPoolExecutor::getPriorityAging() const {
+    return priorityAging_.load(std::memory_order_relaxed);
+}
+
+bool ThreadPoolExecutor::pollTask(size_t queueIdex, Task& task) {
+    if (queueIdex >= priorityQueues_.size() ||
+            priorityQueues_[queueIdex]->pending.load(std::memory_order_relaxed) == 0)
+        return workQueues_[queueIdex].try_pop(task);
+
+    PriorityQueues& queues = *priorityQueues_[queueIdex];
+    const int high = static_cast<int>(TaskPriority::HIGH);
+    const int normal = static_cast<int>(TaskPriority::NORMAL);
+    const int low = static_cast<int>(TaskPriority::LOW);
+    //老化:被跳过太多次的低优先级队列先执行一次,从最低优先级开始检查
+    unsigned aging = priorityAging_.load(std::memory_order_relaxed);
+    for (int level = low; level > high; --level) {
+        if (queues.skipped[level] >= aging && levelQueue(queueIdex, level).try_pop(task)) {
+            queues.skipped[level] = 0;
+            if (level != normal)
+                queues.pending.fetch_sub(1);
+            return true;
+        }
+    }
+    for (int level = high; level <= low; ++level) {
+        if (!levelQueue(queueIdex, level).try_pop(task))
+            continue;
+        queues.skipped[level] = 0;
+        if (level != normal)
+            queues.pending.fetch_sub(1);
+        for (int lower = level + 1; lower <= low; ++lower) {
+            if (!levelQueue(queueIdex, lower).is_empty())
+                ++queues.skipped[lower];
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPoolExecutor::stealTask(size_t queueIdex, Task& task) {
+    if (queueIdex >= priorityQueues_.size() ||
+            priorityQueues_[queueIdex]->pending.load(std::memory_order_relaxed) == 0)
+        return workQueues_[queueIdex].try_pop(task);
+    PriorityQueues& queues = *priorityQueues_[queueIdex];
+    if (queues.high.try_pop(task)) {
+        queues.pending.fetch_sub(1);
+        return true;
+    }
+    if (workQueues_[queueIdex].try_pop(task))
+        return true;
+    if (queues.low.try_pop(task)) {
+        queues.pending.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPoolExecutor::signalLocalPush(size_t count) {
+    //调用者压入任务后的fence和idleWait中Parker标记休眠后的fence配对,
+    //要么休眠的线程看到新任务,要么这里看到它在休眠
+    for (size_t i = 0; i < count && parkedWorkers_.load(std::memory_order_relaxed) > 0; ++i) {
+        if (!signalParkedWorker(currentLocal().index))
+            break;
+    }
+}
+
+bool ThreadPoolExecutor::signalParkedWorker(size_t self) {
+    size_t n = slotCount_.load(std::memory_order_acquire);
+    for (size_t i = 1; i < n; ++i) {
+        if (parkers_[(self + i) % n]->unpark())
+            return true;
+    }
+    return false;
+}
+
+bool ThreadPoolExecutor::popLocalTask(size_t queueIdex, Task& task) {
+    LocalTask* local = nullptr;
+    if (queueIdex >= localQueues_.size() || !localQueues_[queueIdex]->pop(local))
+        return false;
+    LocalTaskPool::take(local, task, true);
+    return true;
+}
+
+bool ThreadPoolExecutor::stealLocalTask(size_t queueIdex, Task& task) {
+    LocalTask* local = nullptr;
+    size_t n = localQueues_.size();
+    for (size_t i = 1; i < n; ++i) {
+        if (localQueues_[(queueIdex + i) % n]->steal(local)) {
+            LocalTaskPool::take(local, task, false);
+            THREADPOOL_TRACE_TASK(STEAL, task, static_cast<uint32_t>((queueIdex + i) % n));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPoolExecutor::hasLocalTask() const {
+    for (auto& e : localQueues_) {
+        if (!e->is_empty())
+            return true;
+    }
+    return false;
+}
+
+bool ThreadPoolExecutor::hasQueuedTask(size_t queueIdex) const {
+    if (queueIdex < priorityQueues_.size() &&
+            priorityQueues_[queueIdex]->pending.load(std::memory_order_relaxed) > 0)
+        return true;
+    return !workQueues_[queueIdex].is_empty();
+}
+
+void ThreadPoolExecutor::setMetricsEnabled(bool enabled) {
+    metricsEnabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool ThreadPoolExecutor::isMetricsEnabled() const {
+    return metricsEnabled_.load(std::memory_order_relaxed);
+}
+
+ExecutorMetrics ThreadPoolExecutor::getMetrics() const {
+    ExecutorMetrics metrics;
+    size_t count = slotCount_.load(std::memory_order_acquire);
+    metrics.workers.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const WorkerMetrics& e = *workerMetrics_[i];
+        WorkerMetricsSnapshot& s = metrics.workers[i];
+        s.completed = e.completed.load(std::memory_order_relaxed);
+        s.stolen = e.stolen.load(std::memory_order_relaxed);
+        s.queueWait = e.queueWait.snapshot();
+        s.execution = e.execution.snapshot();
+    }
+    metrics.rejected = rejected_.load(std::memory_order_relaxed);
+    metrics.grown = growCount_.load(std::memory_order_relaxed);
+    metrics.shrunk = shrinkCount_.load(std::memory_order_relaxed);
+    return metrics;
+}
+
+void ThreadPoolExecutor::runWorkerTask(Task& task, WorkerMetrics* metrics) {
+    THREADPOOL_TRACE_TASK(START, task, UINT32_MAX);
+    if (metrics == nullptr) {
+        task();
+        THREADPOOL_TRACE_TASK(END, task, UINT32_MAX);
+        releaseTasks(1);
+        return;
+    }
+    metrics->active.store(metrics->active.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    //开启统计后提交的任务才有入队时间
+    int64_t enqueueTime = task.enqueueTime();
+    if (enqueueTime == 0) {
+        task();
+        THREADPOOL_TRACE_TASK(END, task, UINT32_MAX);
+    } else {
+        int64_t start = metricsNow();
+        metrics->queueWait.record(start - enqueueTime);
+        metrics->recordQueueDelay(start - enqueueTime, start);
+        //移动平均在空闲一段时间后仍然保留突发时的值,同时要求这个任务的排队时间也超过阈值
+        if (elastic_.load(std::memory_order_relaxed))
+            maybeGrow(std::min(start - enqueueTime, metrics->queueDelay.load(std::memory_order_relaxed)), start);
+        task();
+        THREADPOOL_TRACE_TASK(END, task, UINT32_MAX);
+        metrics->execution.record(metricsNow() - start);
+    }
+    metrics->active.store(metrics->active.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    releaseWorkerTask(metrics);
+}
+
 void ThreadPoolExecutor::setMaxPoolSize(int32_t maxPoolSize) {
     if (maxPoolSize <= 0 || maxPoolSize < corePoolSize_)
         return;
-    this->maxPoolSize_ = maxPoolSize;
+    //队列位置在构造时分配,运行中的线程不加锁访问,不能重新分配,只能在构造时的范围内调整
+    this->maxPoolSize_ = std::min(maxPoolSize, maxPoolSizeLimit_);
     if (workerCountOf(ctl_.load()) > maxPoolSize_) {
         releaseNonCoreThreads();
     }
@@ -307,47 +1074,160 @@ int ThreadPoolExecutor::getEverPoolSize() const {
 }
 
 int ThreadPoolExecutor::preStartCoreThreads() {
+    return startCoreThreads(corePoolSize_);
+}
+
+int ThreadPoolExecutor::startCoreThreads(int count) {
+    count = std::min(count, corePoolSize_);
     int32_t c = ctl_.load();
-    for (int i = 0; i < corePoolSize_; ++i) {
+    while (workerCountOf(c) < count) {
         if (compareAndIncrementWorkerCount(c)) {
-            threads_.emplace_back(new Thread(std::bind(&ThreadPoolExecutor::coreWorkerThread, this, i), prefix_));
+            std::lock_guard<std::mutex> lock(mutex_);
+            threads_.emplace_back(new Thread(std::bind(&ThreadPoolExecutor::coreWorkerThread,
+                                             this, workerCountOf(c)), prefix_));
+            threads_.back()->start();
+            everPoolSize_++;
         }
         c = ctl_.load();
-        threads_[i]->start();
-        everPoolSize_++;
     }
     return everPoolSize_;
 }
 
+size_t ThreadPoolExecutor::getQueueCapacity() const {
+    return queueCapacity_;
+}
+
 int ThreadPoolExecutor::getCorePoolSize() const {
     return corePoolSize_;
 }
 
 void ThreadPoolExecutor::shutdown() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    advanceRunState(SHUTDOWN);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        advanceRunState(SHUTDOWN);
+    }
+    onShutdown();
+    signalAdmission();
+    //唤醒休眠的线程,它们排空队列后退出
+    signalNotEmpty();
+    tryTerminate();
 }
 
-void ThreadPoolExecutor::stop() {
+std::vector<Task> ThreadPoolExecutor::shutdownNow() {
     {
         std::lock_guard<std::mutex> lock(mutex_);
         advanceRunState(STOP);
     }
-    int32_t c = ctl_.load();
-    if (workerCountOf(ctl_.load()) != 0) {
-        //释放所有线程资源
-        releaseWorkers();
+    onShutdown();
+    signalAdmission();
+    signalNotEmpty();
+    //和线程一样通过try_pop/steal取出,同一个任务不会既被执行又被返回;
+    //等待已经通过状态检查的提交者放入任务,有界队列满时它们可能在等待空位,边取边等
+    std::vector<Task> tasks;
+    Task task;
+    for (;;) {
+        bool done = submitters_.load() == 0;
+        while (takeAnyTask(task)) {
+            tasks.push_back(std::move(task));
+            task.reset();
+        }
+        if (done)
+            break;
+        std::this_thread::yield();
     }
+    releaseTasks(tasks.size());
+    tryTerminate();
+    return tasks;
+}
+
+std::vector<Task> ThreadPoolExecutor::shutdownGracefully(const std::chrono::nanoseconds& drainTimeout) {
+    shutdown();
+    if (awaitTermination(drainTimeout))
+        return std::vector<Task>();
+    return shutdownNow();
+}
 
-    if (ctl_.compare_exchange_strong(c, ctlOf(TIDYING, 0))) {
+bool ThreadPoolExecutor::awaitTermination(const std::chrono::nanoseconds& timeout) {
+    std::unique_lock<std::mutex> lock(terminationMutex_);
+    return terminationCond_.wait_for(lock, timeout, [this] {
+        return runStateAtLeast(ctl_.load(), TERMINATED);
+    });
+}
+
+void ThreadPoolExecutor::stop() {
+    shutdownNow();
+    //释放所有线程资源
+    releaseWorkers();
+    //线程都已经join,还没有减少线程数的在这里清零
+    int32_t c = ctl_.load();
+    while (workerCountOf(c) != 0 &&
+            !ctl_.compare_exchange_weak(c, ctlOf(runStateOf(c), 0))) {}
+    tryTerminate();
+}
+
+void ThreadPoolExecutor::tryTerminate() {
+    for (;;) {
+        int32_t c = ctl_.load();
+        if (isRunning(c) || runStateAtLeast(c, TIDYING) || workerCountOf(c) != 0)
+            return;
+        if (getPendingTaskCount() != 0) {
+            //STOP时剩下的任务由shutdownNow取出,它最后会再调用一次
+            if (runStateOf(c) != SHUTDOWN)
+                return;
+            //没有线程了,正在提交的任务可能刚放入队列,由最后一个线程执行
+            Task task;
+            if (takeAnyTask(task)) {
+                runWorkerTask(task, nullptr);
+            } else {
+                //任务正在被放入队列或在线程池外执行(如tryExecuteOne)
+                std::this_thread::yield();
+            }
+            continue;
+        }
+        if (!ctl_.compare_exchange_strong(c, ctlOf(TIDYING, 0)))
+            continue;
         terminated();
+        {
+            //持有锁通知,awaitTermination返回后线程池可能马上析构
+            std::lock_guard<std::mutex> lock(terminationMutex_);
+            ctl_.store(ctlOf(TERMINATED, 0));
+            terminationCond_.notify_all();
+        }
+        return;
+    }
+}
+
+void ThreadPoolExecutor::processWorkerExit() {
+    int32_t c = ctl_.load();
+    while (workerCountOf(c) != 0 && !ctl_.compare_exchange_weak(c, c - 1)) {}
+    tryTerminate();
+}
+
+bool ThreadPoolExecutor::takeAnyTask(Task& task) {
+    size_t core = static_cast<size_t>(corePoolSize_);
+    for (size_t i = 0; i < core; ++i) {
+        if (stealTask(i, task))
+            return true;
+    }
+    {
         std::lock_guard<std::mutex> lock(mutex_);
-        ctl_ = ctlOf(TERMINATED, 0);
+        for (size_t i = core; i < slotCount_.load(std::memory_order_relaxed); ++i) {
+            if (workQueues_[i].try_pop(task))
+                return true;
+        }
     }
+    LocalTask* local = nullptr;
+    for (auto& e : localQueues_) {
+        if (e->steal(local)) {
+            LocalTaskPool::take(local, task, false);
+            return true;
+        }
+    }
+    return false;
 }
 
 bool ThreadPoolExecutor::isShutDown() {
-    return runStateOf(ctl_.load()) == SHUTDOWN;
+    return !isRunning(ctl_.load());
 }
 
 bool ThreadPoolExecutor::isTerminated() {
@@ -364,30 +1244,121 @@ void ThreadPoolExecutor::advanceRunState(int32_t targetState) {
 }
 
 void ThreadPoolExecutor::coreWorkerThread(size_t queueIdex) {
-    Runnable::sptr task;
-    std::unique_lock<std::mutex> lk(mutex_);
+    bindWorker(queueIdex);
+    currentLocal() = LocalWorker{this, queueIdex, 0};
+    WorkerMetrics* metrics = workerMetrics_[queueIdex].get();
+    Task task;
     while(runStateOf(ctl_.load()) <= SHUTDOWN) {
-        if (workQueues_[queueIdex].is_empty()) {
-            notEmpty_.wait(lk);
+        //先执行自己提交的任务,递归任务留在同一个核心上
+        if(popLocalTask(queueIdex, task) || pollTask(queueIdex, task)) {
+            runWorkerTask(task, metrics);
+            task.reset();
+            continue;
+        }
+        if (stealLocalTask(queueIdex, task)) {
+            WorkerMetrics::increment(metrics->stolen);
+            runWorkerTask(task, metrics);
+            task.reset();
+            continue;
         }
-        if(workQueues_[queueIdex].try_pop(task)) {
-            task->operator()();
+        //关闭后帮助排空其他线程的队列,没有任务时退出
+        if (!isRunning(ctl_.load())) {
+            if (!takeAnyTask(task))
+                break;
+            runWorkerTask(task, metrics);
+            task.reset();
+            continue;
         }
+        //每个线程在自己的Parker上休眠,提交任务时只唤醒队列所属的线程
+        idleWait(queueIdex, [this, queueIdex] {
+            return hasQueuedTask(queueIdex) || hasLocalTask() ||
+                   !isRunning(ctl_.load());
+        });
     }
+    currentLocal() = LocalWorker{nullptr, 0, 0};
+    processWorkerExit();
 }
 
 void ThreadPoolExecutor::workerThread(size_t queueIdex) {
-    Runnable::sptr task;
-    std::unique_lock<std::mutex> lk(mutex_);
+    bindWorker(queueIdex);
+    currentLocal() = LocalWorker{this, queueIdex, 0};
+    Task task;
     while(runStateOf(ctl_.load()) <= SHUTDOWN) {
-        if(workQueues_[queueIdex].is_empty()) {
-            notEmpty_.wait(lk);
+        if(popLocalTask(queueIdex, task) || workQueues_[queueIdex].try_pop(task) ||
+                (!isRunning(ctl_.load()) && takeAnyTask(task))) {
+            runWorkerTask(task, workerMetrics_[queueIdex].get());
+            task.reset();
+            continue;
         }
-        if(workQueues_[queueIdex].try_pop(task)) {
-            task->operator()();
+        if(!keepNonCoreThreadAlive_ || !isRunning(ctl_.load())) {
+            break;
         }
-        if(!keepNonCoreThreadAlive_) {
-            return;
+        idleWait(queueIdex, [this, queueIdex] {
+            return !workQueues_[queueIdex].is_empty() ||
+                   (queueIdex < localQueues_.size() && !localQueues_[queueIdex]->is_empty()) ||
+                   !keepNonCoreThreadAlive_ ||
+                   !isRunning(ctl_.load());
+        });
+    }
+    currentLocal() = LocalWorker{nullptr, 0, 0};
+    retireWorker(queueIdex);
+}
+
+void ThreadPoolExecutor::elasticWorkerThread(size_t queueIdex) {
+    bindWorker(queueIdex);
+    Thread* self = attachElasticWorker();
+    if (self == nullptr) {
+        processWorkerExit();
+        return;
+    }
+    currentLocal() = LocalWorker{this, queueIdex, 0};
+    WorkerMetrics* metrics = workerMetrics_[queueIdex].get();
+    size_t core = static_cast<size_t>(corePoolSize_);
+    size_t victim = queueIdex;
+    auto ready = [this, queueIdex, core] {
+        if (hasQueuedTask(queueIdex) || hasLocalTask() || !isRunning(ctl_.load()) ||
+                !elastic_.load(std::memory_order_relaxed))
+            return true;
+        for (size_t i = 0; i < core; ++i) {
+            if (hasQueuedTask(i))
+                return true;
+        }
+        return false;
+    };
+    Task task;
+    while (runStateOf(ctl_.load()) <= SHUTDOWN) {
+        bool found = popLocalTask(queueIdex, task) || pollTask(queueIdex, task);
+        //从核心线程的队列和其他线程的本地队列窃取,每次从下一个队列开始
+        for (size_t i = 0; i < core && !found; ++i) {
+            found = stealTask(victim++ % core, task);
+            if (found) {
+                WorkerMetrics::increment(metrics->stolen);
+                THREADPOOL_TRACE_TASK(STEAL, task, static_cast<uint32_t>((victim - 1) % core));
+            }
         }
+        if (!found && stealLocalTask(queueIdex, task)) {
+            found = true;
+            WorkerMetrics::increment(metrics->stolen);
+        }
+        if (!found && !isRunning(ctl_.load())) {
+            //关闭后排空非核心线程的队列,没有任务时退出
+            if (!takeAnyTask(task))
+                break;
+            found = true;
+        }
+        if (found) {
+            runWorkerTask(task, metrics);
+            task.reset();
+            self->touch();
+            continue;
+        }
+        if (!elastic_.load(std::memory_order_relaxed) && !keepNonCoreThreadAlive_)
+            break;
+        std::chrono::nanoseconds timeout = elasticIdleTimeout(self);
+        if (timeout.count() <= 0)
+            break;
+        idleWait(queueIdex, ready, timeout);
     }
+    currentLocal() = LocalWorker{nullptr, 0, 0};
+    retireElasticWorker(queueIdex);
 }
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <random>
+
+#include "workstealingthreadpoolexecutor.hpp"
+
+WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(int32_t corePoolSize,
+        int32_t maxPoolSize,
+        const std::vector<BlockingQueue<Runnable::sptr>>& workQueue,
+        const RejectedExecutionHandler& handler,
+        const std::string& prefix)
+    : ThreadPoolExecutor(corePoolSize, maxPoolSize, workQueue, handler, prefix) {}
+
+WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(int32_t corePoolSize,
+        int32_t maxPoolSize,
+        const std::vector<BlockingQueue<Runnable::sptr>>& workQueue,
+        RejectedExecutionHandler* handler,
+        const std::string& prefix)
+    : ThreadPoolExecutor(corePoolSize, maxPoolSize, workQueue, handler, prefix) {}
+
+WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(int32_t corePoolSize,
+        int32_t maxPoolSize,
+        const std::string& prefix)
+    : ThreadPoolExecutor(corePoolSize, maxPoolSize, prefix) {}
+
+WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(int32_t corePoolSize,
+        int32_t maxPoolSize,
+        size_t queueCapacity,
+        const std::string& prefix)
+    : ThreadPoolExecutor(corePoolSize, maxPoolSize, queueCapacity, prefix) {}
+
+bool WorkStealingThreadPoolExecutor::steal(size_t self, LocalTask*& task, Task& shared) {
+    LocalWorker& local = currentLocal();
+    //xorshift随机选择开始窃取的线程,避免所有线程都从同一个队列窃取
+    uint32_t x = local.seed != 0 ? local.seed : static_cast<uint32_t>(std::random_device()()) | 1u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    local.seed = x;
+
+    size_t n = localQueues_.size();
+    size_t start = x % n;
+    size_t core = static_cast<size_t>(corePoolSize_);
+    //按NUMA节点分组时先从同一节点的线程窃取,再跨节点
+    bool grouped = self < n && !workerNodes_.empty();
+    int node = grouped ? getWorkerNode(self) : 0;
+    for (int pass = 0; pass < (grouped ? 2 : 1); ++pass) {
+        bool sameNode = pass == 0;
+        for (size_t i = 0; i < n; ++i) {
+            size_t victim = (start + i) % n;
+            if (victim == self || (grouped && (getWorkerNode(victim) == node) != sameNode))
+                continue;
+            if (localQueues_[victim]->steal(task)) {
+                if (self < n)
+                    WorkerMetrics::increment(workerMetrics_[self]->stolen);
+                THREADPOOL_TRACE_TASK(STEAL, task->task, static_cast<uint32_t>(victim));
+                return true;
+            }
+        }
+        //核心线程的任务队列一直存在,可以直接窃取外部提交的任务
+        for (size_t i = 0; i < core; ++i) {
+            size_t victim = (x + i) % core;
+            if (victim == self || (grouped && (getWorkerNode(victim) == node) != sameNode))
+                continue;
+            if (stealTask(victim, shared)) {
+                if (self < n)
+                    WorkerMetrics::increment(workerMetrics_[self]->stolen);
+                THREADPOOL_TRACE_TASK(STEAL, shared, static_cast<uint32_t>(victim));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void WorkStealingThreadPoolExecutor::runTask(size_t self, LocalTask* task, Task& shared) {
+    WorkerMetrics* metrics = self < localQueues_.size() ? workerMetrics_[self].get() : nullptr;
+    //窃取的节点先还给所属线程的池再执行
+    if (task != nullptr)
+        LocalTaskPool::take(task, shared, false);
+    runWorkerTask(shared, metrics);
+    shared.reset();
+}
+
+bool WorkStealingThreadPoolExecutor::runNextTask(size_t queueIdex) {
+    LocalTask* task = nullptr;
+    Task shared;
+    if (popLocalTask(queueIdex, shared) ||
+            pollTask(queueIdex, shared) ||
+            steal(queueIdex, task, shared)) {
+        runTask(queueIdex, task, shared);
+        return true;
+    }
+    return false;
+}
+
+bool WorkStealingThreadPoolExecutor::runRemainingTask(size_t queueIdex) {
+    Task task;
+    if (!takeAnyTask(task))
+        return false;
+    runTask(queueIdex, nullptr, task);
+    return true;
+}
+
+bool WorkStealingThreadPoolExecutor::tryExecuteOne() {
+    LocalWorker& local = currentLocal();
+    if (local.pool == this)
+        return runNextTask(local.index);
+    LocalTask* task = nullptr;
+    Task shared;
+    if (!steal(localQueues_.size(), task, shared))
+        return false;
+    runTask(localQueues_.size(), task, shared);
+    return true;
+}
+
+bool WorkStealingThreadPoolExecutor::hasWork(size_t queueIdex) const {
+    if (hasQueuedTask(queueIdex))
+        return true;
+    for (auto& e : localQueues_) {
+        if (!e->is_empty())
+            return true;
+    }
+    for (int i = 0; i < corePoolSize_; ++i) {
+        if (hasQueuedTask(static_cast<size_t>(i)))
+            return true;
+    }
+    return false;
+}
+
+bool WorkStealingThreadPoolExecutor::signalIdleWorker() {
+    std::lock_guard<std::mutex> lock(idleMutex_);
+    //unpark失败说明线程还没有真正休眠,它会在休眠前重新检查任务,保留在栈中
+    for (size_t i = idleWorkers_.size(); i > 0; --i) {
+        size_t index = idleWorkers_[i - 1];
+        if (parkers_[index]->unpark()) {
+            idleWorkers_.erase(idleWorkers_.begin() + (i - 1));
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingThreadPoolExecutor::signalWorker(size_t queueIdex) {
+    if (!parkers_[queueIdex]->unpark() && parked_.load() > 0)
+        signalIdleWorker();
+}
+
+void WorkStealingThreadPoolExecutor::signalLocalPush(size_t count) {
+    //调用者压入任务后的fence和park中的parked_递增配对,保证不会丢失唤醒
+    for (size_t i = 0; i < count && parked_.load(std::memory_order_relaxed) > 0; ++i) {
+        if (!signalIdleWorker())
+            break;
+    }
+}
+
+void WorkStealingThreadPoolExecutor::park(size_t queueIdex, bool core, std::chrono::nanoseconds timeout) {
+    auto ready = [this, queueIdex, core] {
+        return hasWork(queueIdex) ||
+               (!core && !keepNonCoreThreadAlive_ && !isElastic()) ||
+               !isRunning(ctl_.load());
+    };
+    //自旋阶段不进入空闲栈,提交任务的线程不需要为它加锁唤醒
+    Parker& parker = *parkers_[queueIdex];
+    if (parker.spinWait(ready, getIdleStrategy()))
+        return;
+    parked_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(idleMutex_);
+        idleWorkers_.push_back(queueIdex);
+    }
+    THREADPOOL_TRACE_EVENT(PARK, 0, static_cast<uint32_t>(queueIdex));
+    if (timeout.count() > 0)
+        parker.parkFor(ready, timeout);
+    else
+        parker.park(ready);
+    THREADPOOL_TRACE_EVENT(UNPARK, 0, static_cast<uint32_t>(queueIdex));
+    {
+        //没有通过空闲栈唤醒时自己移出
+        std::lock_guard<std::mutex> lock(idleMutex_);
+        auto it = std::find(idleWorkers_.begin(), idleWorkers_.end(), queueIdex);
+        if (it != idleWorkers_.end())
+            idleWorkers_.erase(it);
+    }
+    parked_.fetch_sub(1);
+}
+
+void WorkStealingThreadPoolExecutor::coreWorkerThread(size_t queueIdex) {
+    setCurrentThreadName(prefix_);
+    bindWorker(queueIdex);
+    currentLocal() = LocalWorker{this, queueIdex, 0};
+    while(runStateOf(ctl_.load()) <= SHUTDOWN) {
+        if (runNextTask(queueIdex))
+            continue;
+        //关闭后排空所有队列,没有任务时退出
+        if (!isRunning(ctl_.load())) {
+            if (!runRemainingTask(queueIdex))
+                break;
+            continue;
+        }
+        park(queueIdex, true);
+    }
+    currentLocal() = LocalWorker{nullptr, 0, 0};
+    processWorkerExit();
+}
+
+void WorkStealingThreadPoolExecutor::workerThread(size_t queueIdex) {
+    setCurrentThreadName(prefix_);
+    bindWorker(queueIdex);
+    currentLocal() = LocalWorker{this, queueIdex, 0};
+    while(runStateOf(ctl_.load()) <= SHUTDOWN) {
+        if (runNextTask(queueIdex) || (!isRunning(ctl_.load()) && runRemainingTask(queueIdex)))
+            continue;
+        if(keepNonCoreThreadAlive_ && isRunning(ctl_.load())) {
+            park(queueIdex, false);
+        } else {
+            break;
+        }
+    }
+    //退出前把自己队列中剩下的任务交给其他线程窃取
+    if (queueIdex < localQueues_.size() && !localQueues_[queueIdex]->is_empty())
+        signalIdleWorker();
+    currentLocal() = LocalWorker{nullptr, 0, 0};
+    retireWorker(queueIdex);
+}
+
+void WorkStealingThreadPoolExecutor::elasticWorkerThread(size_t queueIdex) {
+    setCurrentThreadName(prefix_);
+    bindWorker(queueIdex);
+    Thread* self = attachElasticWorker();
+    if (self == nullptr) {
+        processWorkerExit();
+        return;
+    }
+    currentLocal() = LocalWorker{this, queueIdex, 0};
+    while(runStateOf(ctl_.load()) <= SHUTDOWN) {
+        if (runNextTask(queueIdex) || (!isRunning(ctl_.load()) && runRemainingTask(queueIdex))) {
+            self->touch();
+            continue;
+        }
+        if ((!isElastic() && !keepNonCoreThreadAlive_) || !isRunning(ctl_.load()))
+            break;
+        std::chrono::nanoseconds timeout = elasticIdleTimeout(self);
+        if (timeout.count() <= 0)
+            break;
+        park(queueIdex, false, timeout);
+    }
+    currentLocal() = LocalWorker{nullptr, 0, 0};
+    retireElasticWorker(queueIdex);
+}